@@ -0,0 +1,289 @@
+/*
+  Round-trip self-check for the storage codecs.
+
+  record    v2 records with NULLs, BOOL header bits, DICT codes and long
+            TEXT: encode, then decode (all columns and a wanted subset)
+            must give back the input text
+  lz        LZ blocks of empty, tiny, repetitive, incompressible and far
+            matching input: decompress(compress(x)) == x, and a cut block
+            is refused
+  seal      three tables fed the same rows, updates and deletes; one stays
+            plain, one is sealed as rows then column groups, one the other
+            way round, with a tail after both. SHOW, projections, filters
+            and aggregates must give the same rows on all three
+
+  Prints one line per failed check, exits 1 if there was any.
+
+  Usage: ./picodb_codec_check [rows]
+*/
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include "commands.h"
+#include "parser.h"
+#include "result_set.h"
+#include "file_manager.h"
+#include "record_codec.h"
+#include "lz_codec.h"
+
+namespace fs = std::filesystem;
+
+static size_t failures = 0;
+
+static void fail(const std::string &check, const std::string &detail) {
+    std::cerr << "[ERROR] " << check << ": " << detail << std::endl;
+    failures++;
+}
+
+static std::string randomText(std::mt19937_64 &rng, size_t length) {
+    static const char LETTERS[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::string text(length, ' ');
+    for (char &c : text) c = LETTERS[rng() % (sizeof(LETTERS) - 1)];
+    return text;
+}
+
+static std::string floatText(float value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%g", value);
+    return text;
+}
+
+static void execute(const std::string &query) {
+    ParsedCommand cmd = Parser::parse(query);
+    if (!cmd.isValid) {
+        fail("parse", query + ": " + cmd.error);
+        return;
+    }
+    Commands::execute(cmd);
+}
+
+// rows of a query as text, one string per row
+static std::vector<std::string> queryRows(const std::string &query) {
+    ResultSet resultSet;
+    Commands::setResultCapture(&resultSet);
+    execute(query);
+    Commands::setResultCapture(nullptr);
+
+    std::vector<std::string> rows;
+    std::vector<std::string> values;
+    std::vector<bool> nulls;
+    for (const auto &record : resultSet.records) {
+        RecordCodec::decodeValues(resultSet.schema, record, values, nulls);
+        std::string row;
+        for (size_t i = 0; i < values.size(); i++) row += (nulls[i] ? std::string("NULL") : values[i]) + "|";
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+static const char* DEPARTMENTS[] = {"IIT", "CSE", "EEE", "ME", "CE", "BBA", "LAW", "MATH"};
+
+// one row of the check tables: id n f b t d flag, NULL in some columns
+static void makeRow(std::mt19937_64 &rng, uint64_t id, std::vector<std::string> &values, std::vector<bool> &nulls) {
+    values = {std::to_string(id),
+              std::to_string(rng() % 3 == 0 ? rng() : rng() % 1000),
+              floatText(static_cast<float>(rng() % 100000) / 8),
+              rng() % 2 ? "true" : "false",
+              randomText(rng, rng() % 4 == 0 ? 300 + rng() % 200 : rng() % 40),
+              DEPARTMENTS[rng() % 8],
+              rng() % 2 ? "true" : "false"};
+    nulls.assign(values.size(), false);
+    for (size_t i = 1; i < values.size(); i++) nulls[i] = rng() % 7 == 0;
+}
+
+static void checkRecords(std::mt19937_64 &rng) {
+    execute("CREATE TABLE codec (id INT PRIMARY KEY, n INT, f FLOAT, b BOOL, t TEXT, d TEXT DICT, flag BOOL);");
+    std::vector<std::pair<std::string, std::string>> metaInfo;
+    std::string primary;
+    int format = RecordCodec::FORMAT_TAGGED;
+    if (!FileManager::readMeta("codec", metaInfo, primary, format) || format != RecordCodec::FORMAT_BITMAP) {
+        fail("record", "codec table missing or not format 2");
+        return;
+    }
+    RecordCodec::Schema schema = RecordCodec::makeSchema(metaInfo, format, "codec");
+
+    std::vector<std::string> values, decoded;
+    std::vector<bool> nulls, decodedNulls;
+    std::vector<uint8_t> record;
+    std::vector<RecordCodec::Field> fields;
+    for (uint64_t id = 0; id < 2000; id++) {
+        makeRow(rng, id, values, nulls);
+        // every NULL / BOOL pattern of the first rows, random after that
+        if (id < 64) {
+            for (size_t i = 1; i < values.size(); i++) nulls[i] = (id >> (i - 1)) & 1;
+            values[3] = id & 1 ? "true" : "false";
+            values[6] = id & 2 ? "true" : "false";
+        }
+        if (!RecordCodec::encode(schema, values, nulls, record)) {
+            fail("record", "encode failed for row " + std::to_string(id));
+            continue;
+        }
+
+        RecordCodec::decodeValues(schema, record, decoded, decodedNulls);
+        for (size_t i = 0; i < values.size(); i++) {
+            if (decodedNulls[i] != nulls[i] || (!nulls[i] && decoded[i] != values[i])) {
+                fail("record", "row " + std::to_string(id) + " column " + std::to_string(i) + " gave "
+                     + (decodedNulls[i] ? "NULL" : decoded[i]) + ", stored " + (nulls[i] ? "NULL" : values[i]));
+            }
+        }
+
+        // a wanted subset decodes the same fields and leaves the others NULL
+        std::vector<bool> wanted(values.size());
+        for (size_t i = 0; i < wanted.size(); i++) wanted[i] = (rng() >> i) & 1;
+        if (!RecordCodec::decode(schema, record, fields, wanted)) {
+            fail("record", "partial decode failed for row " + std::to_string(id));
+            continue;
+        }
+        for (size_t i = 0; i < values.size(); i++) {
+            std::string text = fields[i].isNull ? "" : RecordCodec::toString(schema, record, fields[i], i);
+            bool ok = wanted[i] ? fields[i].isNull == nulls[i] && (nulls[i] || text == values[i]) : fields[i].isNull;
+            if (!ok) fail("record", "partial decode of row " + std::to_string(id) + " column " + std::to_string(i));
+        }
+    }
+}
+
+static void checkLZ(const std::string &name, const std::vector<uint8_t> &input) {
+    std::vector<uint8_t> packed;
+    LZ::compress(input.data(), input.size(), packed);
+    std::vector<uint8_t> output(input.size());
+    if (!LZ::decompress(packed.data(), packed.size(), output.data(), output.size()) || output != input) {
+        fail("lz", name + " (" + std::to_string(input.size()) + " bytes) does not round trip");
+    }
+    if (!input.empty() && LZ::decompress(packed.data(), packed.size() - 1, output.data(), output.size())) {
+        fail("lz", name + " cut by one byte still decompresses");
+    }
+}
+
+static void checkLZBlocks(std::mt19937_64 &rng) {
+    checkLZ("empty", {});
+    checkLZ("one byte", {7});
+    checkLZ("four bytes", {1, 2, 3, 4});
+    checkLZ("zeros", std::vector<uint8_t>(200000, 0));
+
+    std::vector<uint8_t> noise(70000);
+    for (uint8_t &byte : noise) byte = static_cast<uint8_t>(rng());
+    checkLZ("random", noise);
+
+    // the same 70000 bytes twice: the repeat lies past the 64 KB offset limit
+    std::vector<uint8_t> twice = noise;
+    twice.insert(twice.end(), noise.begin(), noise.end());
+    checkLZ("far repeat", twice);
+
+    // short period, matches overlap their own output
+    std::vector<uint8_t> period;
+    for (size_t i = 0; i < 100000; i++) period.push_back(static_cast<uint8_t>(i % 3));
+    checkLZ("period 3", period);
+
+    // literal runs and match lengths around the 15 / 255 length byte steps
+    std::vector<uint8_t> steps;
+    for (size_t length : {14, 15, 16, 18, 19, 20, 269, 270, 271, 524, 525}) {
+        for (size_t i = 0; i < length; i++) steps.push_back(static_cast<uint8_t>(rng()));
+        steps.insert(steps.end(), length, 'x');
+    }
+    checkLZ("length steps", steps);
+}
+
+static const std::vector<std::string> SEAL_TABLES = {"plain", "rowfirst", "paxfirst"};
+
+static void checkSeal(std::mt19937_64 &rng, size_t rows) {
+    for (const auto &table : SEAL_TABLES) {
+        execute("CREATE TABLE " + table + " (id INT PRIMARY KEY, n INT, f FLOAT, b BOOL, t TEXT, d TEXT DICT, flag BOOL);");
+    }
+
+    std::vector<std::string> values;
+    std::vector<bool> nulls;
+    for (uint64_t id = 0; id < rows; id++) {
+        makeRow(rng, id, values, nulls);
+        std::string row;
+        for (size_t i = 0; i < values.size(); i++) {
+            bool quoted = i == 4 || i == 5;
+            row += (i ? ", " : "") + (nulls[i] ? std::string("NULL") : quoted ? "\"" + values[i] + "\"" : values[i]);
+        }
+        for (const auto &table : SEAL_TABLES) execute("INSERT INTO " + table + " VALUES (" + row + ");");
+
+        if (id == rows / 3) {
+            execute("SEAL TABLE rowfirst;");
+            execute("SEAL TABLE paxfirst COLUMNAR;");
+        } else if (id == rows * 2 / 3) {
+            execute("SEAL TABLE rowfirst COLUMNAR;");
+            execute("SEAL TABLE paxfirst;");
+        }
+    }
+
+    // updates and deletes over the sealed parts and the tail
+    for (const auto &table : SEAL_TABLES) {
+        execute("UPDATE " + table + " SET t = \"" + std::string(600, 'u') + "\" WHERE id BETWEEN 10 AND 20;");
+        execute("UPDATE " + table + " SET n = 5 WHERE d = CSE;");
+        execute("DELETE FROM " + table + " WHERE id BETWEEN " + std::to_string(rows / 2) + " AND " + std::to_string(rows / 2 + 30) + ";");
+        execute("DELETE FROM " + table + " WHERE id = " + std::to_string(rows - 1) + ";");
+    }
+
+    const std::vector<std::string> queries = {
+        "SHOW TABLE %;",
+        "SELECT t, id FROM %;",
+        "SELECT id, flag FROM % WHERE b = true;",
+        "SELECT * FROM % WHERE n BETWEEN 100 AND 600;",
+        "SELECT id, f FROM % WHERE d = LAW;",
+        "SELECT COUNT(*), SUM(n), AVG(f), MIN(t), MAX(id) FROM %;",
+        "SELECT d, COUNT(*), SUM(n) FROM % GROUP BY d ORDER BY d;",
+        "SELECT id, n FROM % ORDER BY n DESC LIMIT 25;",
+    };
+    for (const auto &query : queries) {
+        std::vector<std::vector<std::string>> results;
+        for (const auto &table : SEAL_TABLES) {
+            std::string text = query;
+            text.replace(text.find('%'), 1, table);
+            results.push_back(queryRows(text));
+        }
+        if (results[0].empty()) fail("seal", query + " returned no rows");
+        for (size_t i = 1; i < results.size(); i++) {
+            if (results[i] != results[0]) {
+                fail("seal", query + " on " + SEAL_TABLES[i] + " gave " + std::to_string(results[i].size())
+                     + " row(s), the plain table " + std::to_string(results[0].size()) + " (or rows differ)");
+            }
+        }
+    }
+}
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+int main(int argc, char* argv[]) {
+    size_t rows = argc > 1 ? std::stoull(argv[1]) : 3000;
+
+    char dirTemplate[] = "/tmp/picodb_codec_check_XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::cerr << "FATAL: could not create a work directory" << std::endl;
+        return 1;
+    }
+    fs::path startDir = fs::current_path();
+    fs::current_path(dirTemplate);
+
+    // commands print their results, only the check lines are wanted
+    NullBuffer nullBuffer;
+    std::streambuf* oldCout = std::cout.rdbuf(&nullBuffer);
+    Commands::setIndexMode(Commands::IndexMode::BPLUSTREE);
+
+    std::mt19937_64 rng(42);
+    checkRecords(rng);
+    checkLZBlocks(rng);
+    checkSeal(rng, rows);
+
+    std::cout.rdbuf(oldCout);
+    fs::current_path(startDir);
+    fs::remove_all(dirTemplate);
+
+    if (failures != 0) {
+        std::cout << "[ERROR] " << failures << " codec check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "[OK] record, LZ and seal round trips match" << std::endl;
+    return 0;
+}
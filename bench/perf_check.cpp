@@ -0,0 +1,251 @@
+#include "perf_check.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+namespace PerfCheck {
+
+    struct Scenario {
+        std::string mode;
+        std::string workload;
+        std::string metric;
+        double value = 0;
+        double tolerance = 0;
+    };
+
+    // scenario set written by --write-baseline; values are the best of
+    // suiteRepeats() runs, scaled by the calibration at check time. Checks of
+    // an unchanged tree on a shared one core machine still drift up to about
+    // 45% (p99 up to 90%) when the whole suite lands in a busy spell, so the
+    // bands sit just above that: they catch a change that makes a path half
+    // again as slow, not a few percent. Scans and index loads use p50 so one
+    // stalled run of a mode does not move them
+    static const std::vector<Scenario> SUITE = {
+        {"hash",   "seq_insert",       "ops_per_sec", 0, 0.50},
+        {"bptree", "seq_insert",       "ops_per_sec", 0, 0.50},
+        {"hash",   "point_select",     "p50_us",      0, 0.50},
+        {"hash",   "point_select",     "p99_us",      0, 1.00},
+        {"bptree", "point_select",     "p50_us",      0, 0.50},
+        {"bptree", "point_select",     "p99_us",      0, 1.00},
+        {"bptree", "between",          "p50_us",      0, 0.50},
+        {"hash",   "show_scan",        "p50_us",      0, 0.50},
+        {"bptree", "show_scan",        "p50_us",      0, 0.50},
+        {"hash",   "index_load",       "p50_us",      0, 0.50},
+        {"bptree", "index_load",       "p50_us",      0, 0.50},
+        {"hash",   "server_roundtrip", "p50_us",      0, 0.60},
+        {"bptree", "server_roundtrip", "p50_us",      0, 0.60},
+    };
+
+    std::vector<std::string> suiteWorkloads() {
+        return {"seq_insert", "point_select", "between", "show_scan", "index_load", "server_roundtrip"};
+    }
+
+    size_t suiteOps() {
+        return 2000;
+    }
+
+    size_t suiteRepeats() {
+        return 5;
+    }
+
+    double calibrationUs() {
+        // fixed mix of what the scenarios spend their time on: small strings, hashing, sorting
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> keys;
+        std::unordered_map<std::string, uint64_t> counts;
+        uint64_t x = 42;
+        for (int i = 0; i < 50000; i++) {
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+            keys.push_back("key" + std::to_string(x >> 44));
+        }
+        for (const auto& key : keys) counts[key]++;
+        std::sort(keys.begin(), keys.end());
+        volatile size_t sink = counts.size() + keys.front().size();
+        (void)sink;
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static bool metricValue(const BenchSummary& summary, const std::string& metric, double& value) {
+        if (metric == "ops_per_sec") value = summary.opsPerSec;
+        else if (metric == "mean_us") value = summary.meanUs;
+        else if (metric == "p50_us") value = summary.p50Us;
+        else if (metric == "p95_us") value = summary.p95Us;
+        else if (metric == "p99_us") value = summary.p99Us;
+        else if (metric == "p999_us") value = summary.p999Us;
+        else if (metric == "max_us") value = summary.maxUs;
+        else return false;
+        return true;
+    }
+
+    static const BenchSummary* findResult(const std::vector<BenchSummary>& results, const std::string& mode, const std::string& workload) {
+        for (const auto& result : results) {
+            if (result.mode == mode && result.workload == workload) return &result;
+        }
+        return nullptr;
+    }
+
+    std::vector<BenchSummary> bestOfRuns(const std::vector<std::vector<BenchSummary>>& runs, double calibration) {
+        std::vector<BenchSummary> merged;
+        if (runs.empty()) return merged;
+
+        for (const auto& first : runs[0]) {
+            std::vector<const BenchSummary*> same;
+            for (const auto& run : runs) {
+                const BenchSummary* result = findResult(run, first.mode, first.workload);
+                if (result) same.push_back(result);
+            }
+
+            // every metric on its own: other load on the machine only ever slows
+            // a run down, so the best run is the closest to what the code costs
+            auto metric = [&](double BenchSummary::*field) {
+                bool higherIsBetter = field == &BenchSummary::opsPerSec;
+                double best = 0;
+                for (size_t i = 0; i < same.size(); i++) {
+                    const BenchSummary* result = same[i];
+                    double slower = calibration > 0 && result->calibrationUs > 0 ? result->calibrationUs / calibration : 1.0;
+                    double value = higherIsBetter ? result->*field * slower : result->*field / slower;
+                    if (i == 0) best = value;
+                    best = higherIsBetter ? std::max(best, value) : std::min(best, value);
+                }
+                return best;
+            };
+            BenchSummary summary = first;
+            summary.calibrationUs = calibration;
+            summary.opsPerSec = metric(&BenchSummary::opsPerSec);
+            summary.meanUs = metric(&BenchSummary::meanUs);
+            summary.p50Us = metric(&BenchSummary::p50Us);
+            summary.p95Us = metric(&BenchSummary::p95Us);
+            summary.p99Us = metric(&BenchSummary::p99Us);
+            summary.p999Us = metric(&BenchSummary::p999Us);
+            summary.maxUs = metric(&BenchSummary::maxUs);
+            merged.push_back(summary);
+        }
+        return merged;
+    }
+
+    // value of "key" inside one flat JSON object (string or number)
+    static std::string jsonField(const std::string& object, const std::string& key) {
+        size_t keyPos = object.find("\"" + key + "\"");
+        if (keyPos == std::string::npos) return "";
+        size_t colon = object.find(':', keyPos);
+        if (colon == std::string::npos) return "";
+        size_t start = object.find_first_not_of(" \t\r\n", colon + 1);
+        if (start == std::string::npos) return "";
+
+        if (object[start] == '"') {
+            size_t end = object.find('"', start + 1);
+            return end == std::string::npos ? "" : object.substr(start + 1, end - start - 1);
+        }
+        size_t end = object.find_first_of(",} \t\r\n", start);
+        return object.substr(start, end - start);
+    }
+
+    static bool readBaseline(const std::string& path, size_t& ops, double& calibration, std::vector<Scenario>& scenarios) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::stringstream content;
+        content << in.rdbuf();
+        std::string text = content.str();
+
+        size_t list = text.find("\"scenarios\"");
+        if (list == std::string::npos) return false;
+        ops = std::strtoull(jsonField(text.substr(0, list), "ops").c_str(), nullptr, 10);
+        calibration = std::atof(jsonField(text.substr(0, list), "calibration_us").c_str());
+
+        size_t pos = text.find('[', list);
+        while (pos != std::string::npos) {
+            size_t open = text.find('{', pos);
+            size_t close = text.find('}', open);
+            if (open == std::string::npos || close == std::string::npos) break;
+
+            std::string object = text.substr(open, close - open + 1);
+            Scenario scenario;
+            scenario.mode = jsonField(object, "mode");
+            scenario.workload = jsonField(object, "workload");
+            scenario.metric = jsonField(object, "metric");
+            scenario.value = std::atof(jsonField(object, "value").c_str());
+            scenario.tolerance = std::atof(jsonField(object, "tolerance").c_str());
+            scenarios.push_back(scenario);
+            pos = close + 1;
+        }
+        return !scenarios.empty();
+    }
+
+    bool writeBaseline(const std::string& path, size_t ops, double calibration, const std::vector<BenchSummary>& results) {
+        std::ofstream out(path);
+        if (!out) return false;
+
+        out << std::fixed << std::setprecision(2);
+        out << "{\n";
+        out << "  \"ops\": " << ops << ",\n";
+        out << "  \"calibration_us\": " << calibration << ",\n";
+        out << "  \"scenarios\": [\n";
+        bool first = true;
+        for (const auto& scenario : SUITE) {
+            const BenchSummary* result = findResult(results, scenario.mode, scenario.workload);
+            double value = 0;
+            if (!result || !metricValue(*result, scenario.metric, value)) continue;
+
+            if (!first) out << ",\n";
+            first = false;
+            out << "    {\"mode\": \"" << scenario.mode << "\", \"workload\": \"" << scenario.workload
+                << "\", \"metric\": \"" << scenario.metric << "\", \"value\": " << value
+                << ", \"tolerance\": " << scenario.tolerance << "}";
+        }
+        out << "\n  ]\n";
+        out << "}\n";
+        return true;
+    }
+
+    int check(const std::string& path, size_t ops, double calibration, const std::vector<BenchSummary>& results, std::ostream& out) {
+        size_t baselineOps = 0;
+        double baselineCalibration = 0;
+        std::vector<Scenario> scenarios;
+        if (!readBaseline(path, baselineOps, baselineCalibration, scenarios)) {
+            out << "ERROR: cannot read baseline " << path << "\n";
+            return -1;
+        }
+        if (baselineOps != ops) {
+            out << "ERROR: baseline was recorded with " << baselineOps << " ops, this run used " << ops << "\n";
+            return -1;
+        }
+
+        // the baseline is wall clock time on the machine that recorded it: scale it
+        // by how much slower this machine (or this moment) runs the calibration
+        double slower = baselineCalibration > 0 && calibration > 0 ? calibration / baselineCalibration : 1.0;
+        int regressions = 0;
+        out << std::fixed << std::setprecision(2);
+        out << "calibration " << calibration << " us, baseline " << baselineCalibration << " us, limits x" << slower << "\n";
+        for (const auto& scenario : scenarios) {
+            std::string name = scenario.mode + "/" + scenario.workload + " " + scenario.metric;
+            const BenchSummary* result = findResult(results, scenario.mode, scenario.workload);
+            double actual = 0;
+            if (!result || !metricValue(*result, scenario.metric, actual)) {
+                out << "MISSING     " << name << "\n";
+                regressions++;
+                continue;
+            }
+
+            bool higherIsBetter = scenario.metric == "ops_per_sec";
+            double expected = higherIsBetter ? scenario.value / slower : scenario.value * slower;
+            double limit = higherIsBetter ? expected * (1.0 - scenario.tolerance)
+                                          : expected * (1.0 + scenario.tolerance);
+            bool regressed = higherIsBetter ? actual < limit : actual > limit;
+            bool muchBetter = higherIsBetter ? actual > expected * (1.0 + scenario.tolerance)
+                                             : actual < expected * (1.0 - scenario.tolerance);
+
+            out << (regressed ? "REGRESSION  " : muchBetter ? "IMPROVED    " : "ok          ")
+                << std::left << std::setw(40) << name << std::right
+                << " baseline " << std::setw(10) << scenario.value
+                << "  now " << std::setw(10) << actual
+                << "  limit " << std::setw(10) << limit << "\n";
+            if (regressed) regressions++;
+        }
+        return regressions;
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+
+/*
+  Baseline comparison for make perf-check.
+
+  A baseline file lists scenarios as
+    {"mode": "bptree", "workload": "point_select", "metric": "p50_us", "value": 12.5, "tolerance": 0.5}
+  ops_per_sec must not drop below value * (1 - tolerance); latency metrics
+  (*_us) must not rise above value * (1 + tolerance). Both sides use the
+  best of suiteRepeats() runs of every scenario. The file also keeps
+  "calibration_us", the best calibrationUs() of the recording run; values
+  are scaled by how much slower the calibration runs at check time, so a
+  slower machine or a busy moment does not count as a regression.
+*/
+
+struct BenchSummary {
+    std::string mode;
+    std::string workload;
+    size_t ops = 0;
+    double opsPerSec = 0;
+    double meanUs = 0;
+    double p50Us = 0;
+    double p95Us = 0;
+    double p99Us = 0;
+    double p999Us = 0;
+    double maxUs = 0;
+    double calibrationUs = 0;   // PerfCheck::calibrationUs() around the run, 0 when not taken
+};
+
+namespace PerfCheck {
+
+    // workloads and run size used by --suite perf
+    std::vector<std::string> suiteWorkloads();
+    size_t suiteOps();
+    size_t suiteRepeats();
+
+    // per scenario and metric, the best value over runs of the same workloads
+    // (highest ops_per_sec, lowest latency); each run is first scaled from its
+    // own calibration to the given one, so a run during a busy spell compares fairly
+    std::vector<BenchSummary> bestOfRuns(const std::vector<std::vector<BenchSummary>>& runs, double calibration);
+
+    // microseconds of a fixed CPU and memory workload, the machine's speed right now
+    double calibrationUs();
+
+    bool writeBaseline(const std::string& path, size_t ops, double calibration, const std::vector<BenchSummary>& results);
+
+    // prints one line per scenario, returns the number of regressions (-1 if the baseline is unusable)
+    int check(const std::string& path, size_t ops, double calibration, const std::vector<BenchSummary>& results, std::ostream& out);
+
+}
@@ -0,0 +1,913 @@
+/*
+  picodb_bench: in-process workload harness for the command layer.
+
+  Every workload runs against a fresh data directory (under /tmp) once per
+  index mode. Commands are built as ParsedCommand directly, so the numbers
+  cover Commands::execute (index load/probe, record I/O, index save) and
+  not the SQL parser. Command output is discarded while timing.
+
+  Workloads:
+    seq_insert     INSERT with increasing ids
+    random_insert  INSERT with shuffled ids into a second table
+    point_select   SELECT ... WHERE id = k, uniform random k
+    between        SELECT ... WHERE id BETWEEN k AND k+9 (hash mode: zone map scan)
+    in_list        SELECT ... WHERE id IN (100 random ids), one batched index probe
+                   and a fetch in offset order (ops / 100 runs, compare with
+                   100 point_select ops)
+    show_scan        SHOW TABLE over the whole table (ops / 100 runs)
+    index_load       index file load into a fresh index (ops / 20 runs)
+    server_roundtrip SELECT ... WHERE id = k through an in-process server
+                     over loopback TCP, including parsing and the protocol
+    sealed_scan      SHOW TABLE over a table after SEAL TABLE (ops / 100 runs),
+                     compare with show_scan; the seal logs raw vs stored bytes
+    sealed_select    SELECT ... WHERE id = k on the sealed table, one block
+                     decompress per read, compare with point_select
+    column_scan      sum of the score column through FileManager::scanColumns
+                     over the row format table (ops / 100 runs)
+    pax_column_scan  same over a copy sealed with SEAL TABLE ... COLUMNAR, which
+                     reads only the score chunks
+    aggregate        SELECT COUNT(*), SUM(score), AVG(score), MIN(id), MAX(id)
+                     over the whole table (ops / 100 runs)
+    count_star       SELECT COUNT(*) over the whole table, from the row counts
+    group_by         SELECT dept, COUNT(*), AVG(score) ... GROUP BY dept (ops / 100 runs)
+    group_by_index   SELECT dept, COUNT(*) ... GROUP BY dept, hash mode reads the
+                     counts from the index lists
+    group_by_spill   SELECT name, COUNT(*), SUM(score) ... GROUP BY name (one group
+                     per row) with a 256 KB memory budget, so groups spill to disk
+    order_limit      SELECT * ... ORDER BY score DESC LIMIT 10, top-k heap over the
+                     score column (ops / 100 runs)
+    order_name       SELECT * ... ORDER BY name LIMIT 10, a B+ tree leaf walk in
+                     bptree mode and the heap in hash mode
+    join             SELECT seq.id, depts.floor FROM seq JOIN depts ON seq.dept =
+                     depts.name (8 rows): index nested loop join in hash mode, hash
+                     join in bptree mode (ops / 100 runs); also checks a 64 byte
+                     budget (one pass per build row) gives the same rows
+    cold_io          in_list and column_scan over a table with 2 KB rows, its data
+                     file dropped from the page cache before every run
+                     (posix_fadvise), once through io_uring at --io-depth
+                     (cold_in_list, cold_column_scan) and once with plain
+                     pread (the same names with _sync)
+    parallel_scan    SHOW, SELECT SUM(score) and SELECT ... WHERE score BETWEEN over
+                     the 2 KB row table of cold_io (ops / 100 runs each), once
+                     with --scan-threads workers (parallel_show, parallel_sum,
+                     parallel_filter) and once on one thread (..._1t); the bench
+                     fails if the two give different rows
+    grow_update    UPDATE that makes the name longer, so records move
+    delete         DELETE ... WHERE id = k, distinct random k
+
+  Usage: ./picodb_bench [--ops N] [--seed N] [--mode hash|bptree|both]
+                        [--workloads a,b,...] [--out file.json] [--keep]
+                        [--suite perf] [--check baseline.json]
+                        [--write-baseline baseline.json] [--io-depth N]
+                        [--scan-threads N] [--repeat N]
+  Results are printed as JSON (and written to --out when given). With
+  --repeat N every workload runs N times on fresh data and each metric is
+  the best of the N runs (highest ops_per_sec, lowest latency).
+  --suite perf runs the fixed perf-check scenarios (5 repeats); --check
+  compares them with a baseline (see perf_check.h) and exits 1 on any
+  regression.
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <unistd.h>
+#include <fcntl.h>
+#include "commands.h"
+#include "parser.h"
+#include "hash_index.h"
+#include "bplusTree_index.h"
+#include "server_socket.h"
+#include "client_handler.h"
+#include "lock_manager.h"
+#include "output_capture.h"
+#include "picodb_client.h"
+#include "perf_check.h"
+#include "file_manager.h"
+#include "result_set.h"
+#include "aggregate.h"
+#include "join.h"
+#include "async_io.h"
+
+namespace fs = std::filesystem;
+
+static const std::vector<std::string> ALL_WORKLOADS = {
+    "seq_insert", "random_insert", "point_select", "between", "in_list",
+    "show_scan", "index_load", "server_roundtrip", "sealed_scan", "sealed_select",
+    "column_scan", "pax_column_scan", "aggregate", "count_star", "group_by", "group_by_index", "group_by_spill",
+    "order_limit", "order_name", "join", "cold_io", "parallel_scan",
+    "grow_update", "delete"
+};
+
+static const char* DEPARTMENTS[] = {"IIT", "CSE", "EEE", "ME", "CE", "BBA", "LAW", "MATH"};
+
+struct BenchConfig {
+    size_t ops = 2000;
+    size_t repeats = 1;
+    uint64_t seed = 42;
+    std::vector<Commands::IndexMode> modes = {Commands::IndexMode::HASH, Commands::IndexMode::BPLUSTREE};
+    std::vector<std::string> workloads = ALL_WORKLOADS;
+    std::string outPath;
+    std::string checkPath;
+    std::string baselineOutPath;
+    bool keepData = false;
+};
+
+struct WorkloadResult {
+    std::string mode;
+    std::string workload;
+    double seconds = 0;
+    std::vector<double> latenciesUs;
+    double calibrationUs = 0;
+};
+
+// swallows everything the commands print
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+static const char* modeName(Commands::IndexMode mode) {
+    return mode == Commands::IndexMode::HASH ? "hash" : "bptree";
+}
+
+// HASH mode answers BETWEEN with an error, timing that would mean nothing
+static ParsedCommand makeShow(const std::string& table) {
+    ParsedCommand cmd;
+    cmd.type = "SHOW";
+    cmd.table = table;
+    return cmd;
+}
+
+static ParsedCommand makeSeal(const std::string& table, bool columnar = false) {
+    ParsedCommand cmd;
+    cmd.type = "SEAL";
+    cmd.table = table;
+    cmd.columnar = columnar;
+    return cmd;
+}
+
+static ParsedCommand makeCreate(const std::string& table) {
+    return Parser::parse("CREATE TABLE " + table + "(id INT PRIMARY, name TEXT, score FLOAT, dept TEXT);");
+}
+
+static ParsedCommand makeInsert(const std::string& table, uint64_t id) {
+    ParsedCommand cmd;
+    cmd.type = "INSERT";
+    cmd.table = table;
+    cmd.values = {
+        std::to_string(id),
+        "name_" + std::to_string(id),
+        std::to_string((id * 37) % 1000) + ".5",
+        DEPARTMENTS[id % 8]
+    };
+    return cmd;
+}
+
+static ParsedCommand makeSelect(const std::string& table, uint64_t id) {
+    ParsedCommand cmd;
+    cmd.type = "SELECT";
+    cmd.table = table;
+    cmd.whereColumn = "id";
+    cmd.whereValue1 = std::to_string(id);
+    cmd.op = "=";
+    return cmd;
+}
+
+static ParsedCommand makeBetween(const std::string& table, uint64_t low, uint64_t high) {
+    ParsedCommand cmd = makeSelect(table, low);
+    cmd.whereValue2 = std::to_string(high);
+    cmd.op = "BETWEEN";
+    return cmd;
+}
+
+static ParsedCommand makeInList(const std::string& table, const std::vector<uint64_t>& ids) {
+    ParsedCommand cmd;
+    cmd.type = "SELECT";
+    cmd.table = table;
+    cmd.whereColumn = "id";
+    for (uint64_t id : ids) cmd.whereValues.push_back(std::to_string(id));
+    cmd.op = "IN";
+    return cmd;
+}
+
+static ParsedCommand makeAggregate(const std::string& table, const std::vector<AggregateCall>& calls) {
+    ParsedCommand cmd;
+    cmd.type = "SELECT";
+    cmd.table = table;
+    cmd.aggregates = calls;
+    return cmd;
+}
+
+static ParsedCommand makeGroupBy(const std::string& table, const std::string& column, const std::vector<AggregateCall>& calls) {
+    ParsedCommand cmd = makeAggregate(table, calls);
+    cmd.selectColumns = {column};
+    cmd.groupBy = {column};
+    return cmd;
+}
+
+static ParsedCommand makeOrderBy(const std::string& table, const std::string& column, bool descending, long long limit) {
+    ParsedCommand cmd;
+    cmd.type = "SELECT";
+    cmd.table = table;
+    cmd.orderBy = column;
+    cmd.orderDescending = descending;
+    cmd.limit = limit;
+    return cmd;
+}
+
+// seq JOIN depts on the department name
+static ParsedCommand makeJoin() {
+    return Parser::parse("SELECT seq.id, depts.floor FROM seq JOIN depts ON seq.dept = depts.name;");
+}
+
+// rows of one run, to check that spilled and in-memory GROUP BY agree
+static std::vector<std::vector<uint8_t>> resultRecords(const ParsedCommand& cmd) {
+    std::ostringstream discard;
+    ResultSet resultSet;
+    OutputCapture::Scope capture(discard, false);
+    Commands::setResultCapture(&resultSet);
+    Commands::execute(cmd);
+    Commands::setResultCapture(nullptr);
+    return std::move(resultSet.records);
+}
+
+static size_t resultRows(const ParsedCommand& cmd) {
+    return resultRecords(cmd).size();
+}
+
+// scenarios whose results disagreed between two ways of running them; any makes the bench fail
+static size_t resultMismatches = 0;
+
+static ParsedCommand makeGrowUpdate(const std::string& table, uint64_t id) {
+    ParsedCommand cmd;
+    cmd.type = "UPDATE";
+    cmd.table = table;
+    cmd.columns = {{"name", ""}};
+    cmd.values = {"renamed_with_a_much_longer_value_" + std::to_string(id)};
+    cmd.whereColumn = "id";
+    cmd.whereValue1 = std::to_string(id);
+    cmd.op = "=";
+    return cmd;
+}
+
+static ParsedCommand makeDelete(const std::string& table, uint64_t id) {
+    ParsedCommand cmd;
+    cmd.type = "DELETE";
+    cmd.table = table;
+    cmd.whereColumn = "id";
+    cmd.whereValue1 = std::to_string(id);
+    cmd.op = "=";
+    return cmd;
+}
+
+// before runs ahead of every command, outside the timing
+static void timeCommands(const std::vector<ParsedCommand>& commands, WorkloadResult& result,
+                         const std::function<void()>& before = nullptr) {
+    result.latenciesUs.reserve(commands.size());
+    auto begin = std::chrono::steady_clock::now();
+    for (const auto& cmd : commands) {
+        if (before) before();
+        auto start = std::chrono::steady_clock::now();
+        Commands::execute(cmd);
+        auto end = std::chrono::steady_clock::now();
+        result.latenciesUs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// single column aggregate over the whole table, only the score column is wanted
+static void timeColumnScans(const std::string& table, size_t runs, WorkloadResult& result,
+                            const std::function<void()>& before = nullptr) {
+    std::vector<std::pair<std::string, std::string>> metaInfo;
+    std::string primaryCol;
+    int format = RecordCodec::FORMAT_TAGGED;
+    FileManager::readMeta(table, metaInfo, primaryCol, format);
+    RecordCodec::Schema schema = RecordCodec::makeSchema(metaInfo, format, table);
+    std::vector<bool> wanted(metaInfo.size(), false);
+    wanted[2] = true;   // score FLOAT, see makeCreate
+
+    double checksum = 0.0;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        if (before) before();
+        auto start = std::chrono::steady_clock::now();
+        double sum = 0.0;
+        FileManager::scanColumns(table, schema, wanted,
+            [&](uint64_t, const std::vector<uint8_t>&, const std::vector<RecordCodec::Field>& fields) {
+                if (!fields[2].isNull) sum += fields[2].floatValue;
+            });
+        checksum += sum;
+        auto end = std::chrono::steady_clock::now();
+        result.latenciesUs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::clog << "[INFO] " << result.workload << " " << table << " sum " << std::fixed << std::setprecision(1)
+              << checksum / runs << std::endl;
+}
+
+// drop a table's data file from the page cache, so the next reads go to the disk
+static void evictData(const std::string& table) {
+    std::string path = "data/" + table + "/" + table + ".data";
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// load the index file into a fresh instance each time, so the file stamp cache never kicks in
+static void timeIndexLoads(Commands::IndexMode mode, size_t runs, WorkloadResult& result) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        HashIndex hashIndex;
+        BPlusTreeIndex treeIndex;
+        auto start = std::chrono::steady_clock::now();
+        if (mode == Commands::IndexMode::HASH) hashIndex.loadFromDisk("seq");
+        else treeIndex.loadFromDisk("seq");
+        auto end = std::chrono::steady_clock::now();
+        result.latenciesUs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/*
+  In-process server for the round trip workload, started on first use on a
+  kernel chosen port. It is never destroyed: the accept thread stays parked
+  in poll() until the process exits.
+*/
+struct BenchServer {
+    ServerSocket socket{0};
+    LockManager lockManager;
+    Parser parser;
+    std::atomic<int> activeHandlers{0};
+};
+
+static BenchServer* benchServer() {
+    static BenchServer* server = nullptr;
+    if (server) return server;
+
+    server = new BenchServer();
+    if (!server->socket.initializeServer()) {
+        std::clog << "[ERROR] could not start the bench server" << std::endl;
+        return nullptr;
+    }
+
+    std::thread([]() {
+        int clientCounter = 0;
+        while (server->socket.isRunning()) {
+            int clientFd = server->socket.acceptClientConnection();
+            if (clientFd < 0) continue;
+
+            server->activeHandlers++;
+            std::string clientId = "bench-" + std::to_string(++clientCounter);
+            std::thread([clientFd, clientId]() {
+                ClientHandler handler(clientFd, clientId, &server->socket, &server->lockManager, &server->parser);
+                handler.handleClientCommunication();
+                server->activeHandlers--;
+            }).detach();
+        }
+    }).detach();
+    return server;
+}
+
+static void timeRoundTrips(const std::vector<std::string>& queries, WorkloadResult& result) {
+    BenchServer* server = benchServer();
+    if (!server) return;
+
+    PicoDBClient client("127.0.0.1", server->socket.getPort());
+    if (!client.connect()) {
+        std::clog << "[ERROR] bench client: " << client.getLastError() << std::endl;
+        return;
+    }
+
+    Message response;
+    auto begin = std::chrono::steady_clock::now();
+    for (const auto& sql : queries) {
+        auto start = std::chrono::steady_clock::now();
+        client.query(sql, response);
+        auto end = std::chrono::steady_clock::now();
+        result.latenciesUs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    client.disconnect();
+
+    // the handler still touches std::cout while it winds down
+    while (server->activeHandlers > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static BenchSummary summarize(const WorkloadResult& r) {
+    std::vector<double> sorted = r.latenciesUs;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (double v : sorted) total += v;
+
+    BenchSummary summary;
+    summary.mode = r.mode;
+    summary.workload = r.workload;
+    summary.ops = sorted.size();
+    summary.opsPerSec = r.seconds > 0 ? sorted.size() / r.seconds : 0;
+    summary.meanUs = sorted.empty() ? 0 : total / sorted.size();
+    summary.p50Us = percentile(sorted, 0.50);
+    summary.p95Us = percentile(sorted, 0.95);
+    summary.p99Us = percentile(sorted, 0.99);
+    summary.p999Us = percentile(sorted, 0.999);
+    summary.maxUs = sorted.empty() ? 0 : sorted.back();
+    summary.calibrationUs = r.calibrationUs;
+    return summary;
+}
+
+static void writeJson(std::ostream& out, const BenchConfig& config, const std::vector<BenchSummary>& results) {
+    out << std::fixed << std::setprecision(2);
+    out << "{\n";
+    out << "  \"benchmark\": \"picodb_bench\",\n";
+    out << "  \"ops\": " << config.ops << ",\n";
+    out << "  \"seed\": " << config.seed << ",\n";
+    out << "  \"repeats\": " << config.repeats << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchSummary& r = results[i];
+        out << "    {\"mode\": \"" << r.mode << "\", \"workload\": \"" << r.workload << "\""
+            << ", \"ops\": " << r.ops
+            << ", \"ops_per_sec\": " << r.opsPerSec
+            << ", \"mean_us\": " << r.meanUs
+            << ", \"p50_us\": " << r.p50Us
+            << ", \"p95_us\": " << r.p95Us
+            << ", \"p99_us\": " << r.p99Us
+            << ", \"p999_us\": " << r.p999Us
+            << ", \"max_us\": " << r.maxUs << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static bool parseArguments(int argc, char** argv, BenchConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--keep") {
+            config.keepData = true;
+        } else if (arg == "--ops" && hasValue) {
+            config.ops = std::max(1L, std::atol(argv[++i]));
+        } else if (arg == "--repeat" && hasValue) {
+            config.repeats = std::max(1L, std::atol(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--out" && hasValue) {
+            config.outPath = argv[++i];
+        } else if (arg == "--check" && hasValue) {
+            config.checkPath = argv[++i];
+        } else if (arg == "--write-baseline" && hasValue) {
+            config.baselineOutPath = argv[++i];
+        } else if (arg == "--suite" && hasValue) {
+            std::string suite = argv[++i];
+            if (suite != "perf") {
+                std::cerr << "ERROR: unknown suite " << suite << std::endl;
+                return false;
+            }
+            config.ops = PerfCheck::suiteOps();
+            config.repeats = PerfCheck::suiteRepeats();
+            config.seed = 42;
+            config.workloads = PerfCheck::suiteWorkloads();
+            config.modes = {Commands::IndexMode::HASH, Commands::IndexMode::BPLUSTREE};
+        } else if (arg == "--mode" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode == "hash") config.modes = {Commands::IndexMode::HASH};
+            else if (mode == "bptree") config.modes = {Commands::IndexMode::BPLUSTREE};
+            else if (mode != "both") {
+                std::cerr << "ERROR: unknown mode " << mode << std::endl;
+                return false;
+            }
+        } else if (arg == "--scan-threads" && hasValue) {
+            FileManager::setScanThreads(static_cast<size_t>(std::max(1, std::atoi(argv[++i]))));
+        } else if (arg == "--io-depth" && hasValue) {
+            AsyncIO::setQueueDepth(static_cast<unsigned>(std::atoi(argv[++i])));
+        } else if (arg == "--workloads" && hasValue) {
+            config.workloads.clear();
+            std::stringstream list(argv[++i]);
+            std::string name;
+            while (std::getline(list, name, ',')) {
+                if (std::find(ALL_WORKLOADS.begin(), ALL_WORKLOADS.end(), name) == ALL_WORKLOADS.end()) {
+                    std::cerr << "ERROR: unknown workload " << name << std::endl;
+                    return false;
+                }
+                config.workloads.push_back(name);
+            }
+        } else {
+            std::cerr << "Usage: ./picodb_bench [--ops N] [--seed N] [--mode hash|bptree|both]\n"
+                      << "                      [--workloads a,b,...] [--out file.json] [--keep]\n"
+                      << "                      [--suite perf] [--check baseline.json] [--write-baseline baseline.json]\n"
+                      << "                      [--io-depth N] [--scan-threads N] [--repeat N]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool wants(const BenchConfig& config, const std::string& workload) {
+    return std::find(config.workloads.begin(), config.workloads.end(), workload) != config.workloads.end();
+}
+
+static void runMode(const BenchConfig& config, Commands::IndexMode mode, std::vector<WorkloadResult>& results) {
+    Commands::setIndexMode(mode);
+    std::mt19937_64 random(config.seed);
+
+    std::vector<uint64_t> ids(config.ops);
+    for (size_t i = 0; i < ids.size(); i++) ids[i] = i;
+
+    auto addResult = [&](const std::string& workload, const std::vector<ParsedCommand>& commands) {
+        WorkloadResult result;
+        result.mode = modeName(mode);
+        result.workload = workload;
+        timeCommands(commands, result);
+        results.push_back(std::move(result));
+    };
+
+    // "seq" is the table every read/update/delete workload runs against
+    Commands::execute(makeCreate("seq"));
+    std::vector<ParsedCommand> commands;
+    for (uint64_t id : ids) commands.push_back(makeInsert("seq", id));
+    if (wants(config, "seq_insert")) {
+        addResult("seq_insert", commands);
+    } else {
+        for (const auto& cmd : commands) Commands::execute(cmd);
+    }
+
+    if (wants(config, "random_insert")) {
+        Commands::execute(makeCreate("rnd"));
+        std::vector<uint64_t> shuffled = ids;
+        std::shuffle(shuffled.begin(), shuffled.end(), random);
+        commands.clear();
+        for (uint64_t id : shuffled) commands.push_back(makeInsert("rnd", id));
+        addResult("random_insert", commands);
+    }
+
+    std::uniform_int_distribution<uint64_t> anyId(0, config.ops - 1);
+
+    if (wants(config, "point_select")) {
+        commands.clear();
+        for (size_t i = 0; i < config.ops; i++) commands.push_back(makeSelect("seq", anyId(random)));
+        addResult("point_select", commands);
+    }
+
+    if (wants(config, "between")) {
+        commands.clear();
+        for (size_t i = 0; i < config.ops; i++) {
+            uint64_t low = anyId(random);
+            commands.push_back(makeBetween("seq", low, low + 9));
+        }
+        addResult("between", commands);
+    }
+
+    if (wants(config, "in_list")) {
+        commands.clear();
+        for (size_t i = 0; i < std::max<size_t>(5, config.ops / 100); i++) {
+            std::vector<uint64_t> listed;
+            for (size_t k = 0; k < 100; k++) listed.push_back(anyId(random));
+            commands.push_back(makeInList("seq", listed));
+        }
+        addResult("in_list", commands);
+    }
+
+    if (wants(config, "show_scan")) {
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeShow("seq"));
+        addResult("show_scan", commands);
+    }
+
+    if (wants(config, "index_load")) {
+        WorkloadResult result;
+        result.mode = modeName(mode);
+        result.workload = "index_load";
+        timeIndexLoads(mode, std::max<size_t>(10, config.ops / 20), result);
+        results.push_back(std::move(result));
+    }
+
+    if (wants(config, "server_roundtrip")) {
+        std::vector<std::string> queries;
+        for (size_t i = 0; i < config.ops; i++) {
+            queries.push_back("SELECT * FROM seq WHERE id = " + std::to_string(anyId(random)) + ";");
+        }
+        WorkloadResult result;
+        result.mode = modeName(mode);
+        result.workload = "server_roundtrip";
+        timeRoundTrips(queries, result);
+        results.push_back(std::move(result));
+    }
+
+    // "cold" holds the same rows as "seq", sealed into compressed blocks
+    if (wants(config, "sealed_scan") || wants(config, "sealed_select")) {
+        Commands::execute(makeCreate("cold"));
+        for (uint64_t id : ids) Commands::execute(makeInsert("cold", id));
+
+        std::uintmax_t rawBytes = fs::file_size("data/cold/cold.data");
+        Commands::execute(makeSeal("cold"));
+        std::uintmax_t storedBytes = fs::file_size("data/cold/cold.seg");
+        std::clog << "[INFO] seal: " << rawBytes << " -> " << storedBytes << " bytes ("
+                  << std::fixed << std::setprecision(2) << (storedBytes ? double(rawBytes) / storedBytes : 0.0)
+                  << "x)" << std::endl;
+    }
+
+    if (wants(config, "sealed_scan")) {
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeShow("cold"));
+        addResult("sealed_scan", commands);
+    }
+
+    if (wants(config, "sealed_select")) {
+        commands.clear();
+        for (size_t i = 0; i < config.ops; i++) commands.push_back(makeSelect("cold", anyId(random)));
+        addResult("sealed_select", commands);
+    }
+
+    if (wants(config, "column_scan")) {
+        WorkloadResult result;
+        result.mode = modeName(mode);
+        result.workload = "column_scan";
+        timeColumnScans("seq", std::max<size_t>(5, config.ops / 100), result);
+        results.push_back(std::move(result));
+    }
+
+    if (wants(config, "pax_column_scan")) {
+        Commands::execute(makeCreate("pax"));
+        for (uint64_t id : ids) Commands::execute(makeInsert("pax", id));
+        Commands::execute(makeSeal("pax", true));
+
+        WorkloadResult result;
+        result.mode = modeName(mode);
+        result.workload = "pax_column_scan";
+        timeColumnScans("pax", std::max<size_t>(5, config.ops / 100), result);
+        results.push_back(std::move(result));
+    }
+
+    if (wants(config, "aggregate")) {
+        std::vector<AggregateCall> calls = {{"COUNT", "*"}, {"SUM", "score"}, {"AVG", "score"}, {"MIN", "id"}, {"MAX", "id"}};
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeAggregate("seq", calls));
+        addResult("aggregate", commands);
+    }
+
+    if (wants(config, "count_star")) {
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeAggregate("seq", {{"COUNT", "*"}}));
+        addResult("count_star", commands);
+    }
+
+    if (wants(config, "group_by")) {
+        ParsedCommand cmd = makeGroupBy("seq", "dept", {{"COUNT", "*"}, {"AVG", "score"}});
+        commands.assign(std::max<size_t>(5, config.ops / 100), cmd);
+        addResult("group_by", commands);
+    }
+
+    if (wants(config, "group_by_index")) {
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeGroupBy("seq", "dept", {{"COUNT", "*"}}));
+        addResult("group_by_index", commands);
+    }
+
+    if (wants(config, "group_by_spill")) {
+        ParsedCommand cmd = makeGroupBy("seq", "name", {{"COUNT", "*"}, {"SUM", "score"}});
+        GroupAggregator::setMemoryBudget(256 * 1024);
+        commands.assign(std::max<size_t>(5, config.ops / 100), cmd);
+        addResult("group_by_spill", commands);
+        size_t spilledRows = resultRows(cmd);
+        GroupAggregator::setMemoryBudget(64 * 1024 * 1024);
+        std::clog << "[INFO] group_by_spill groups " << spilledRows << ", in memory " << resultRows(cmd) << std::endl;
+    }
+
+    if (wants(config, "order_limit")) {
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeOrderBy("seq", "score", true, 10));
+        addResult("order_limit", commands);
+    }
+
+    if (wants(config, "order_name")) {
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeOrderBy("seq", "name", false, 10));
+        addResult("order_name", commands);
+    }
+
+    if (wants(config, "join")) {
+        Commands::execute(Parser::parse("CREATE TABLE depts(name TEXT PRIMARY, floor INT);"));
+        for (size_t d = 0; d < 8; d++) {
+            Commands::execute(Parser::parse("INSERT INTO depts VALUES(\"" + std::string(DEPARTMENTS[d]) + "\", " + std::to_string(d + 1) + ");"));
+        }
+        commands.assign(std::max<size_t>(5, config.ops / 100), makeJoin());
+        addResult("join", commands);
+
+        size_t joinedRows = resultRows(makeJoin());
+        Join::setMemoryBudget(64);
+        size_t passRows = resultRows(makeJoin());
+        Join::setMemoryBudget(64 * 1024 * 1024);
+        std::clog << "[INFO] join rows " << joinedRows << ", with a 64 byte budget " << passRows << std::endl;
+    }
+
+    // 2 KB names: 100 listed rows lie far enough apart to be 100 reads, and a scan has megabytes to split
+    if (wants(config, "cold_io") || wants(config, "parallel_scan")) {
+        Commands::execute(makeCreate("wide"));
+        for (uint64_t id : ids) {
+            ParsedCommand insert = makeInsert("wide", id);
+            insert.values[1] += std::string(2048, 'w');
+            Commands::execute(insert);
+        }
+    }
+
+    if (wants(config, "cold_io")) {
+        commands.clear();
+        for (size_t i = 0; i < std::max<size_t>(5, config.ops / 100); i++) {
+            std::vector<uint64_t> listed;
+            for (size_t k = 0; k < 100; k++) listed.push_back(anyId(random));
+            commands.push_back(makeInList("wide", listed));
+        }
+        size_t scans = std::max<size_t>(5, config.ops / 100);
+        auto evict = []() { evictData("wide"); };
+
+        unsigned depth = AsyncIO::queueDepth();
+        std::clog << "[INFO] cold_io io_uring " << (AsyncIO::available() ? "available" : "unavailable")
+                  << ", queue depth " << depth << std::endl;
+        for (bool sync : {false, true}) {
+            AsyncIO::setQueueDepth(sync ? 0 : depth);
+            std::string suffix = sync ? "_sync" : "";
+
+            WorkloadResult inList;
+            inList.mode = modeName(mode);
+            inList.workload = "cold_in_list" + suffix;
+            timeCommands(commands, inList, evict);
+            results.push_back(std::move(inList));
+
+            WorkloadResult scan;
+            scan.mode = modeName(mode);
+            scan.workload = "cold_column_scan" + suffix;
+            timeColumnScans("wide", scans, scan, evict);
+            results.push_back(std::move(scan));
+        }
+        AsyncIO::setQueueDepth(depth);
+    }
+
+    if (wants(config, "parallel_scan")) {
+        size_t runs = std::max<size_t>(5, config.ops / 100);
+        ParsedCommand filter;
+        filter.type = "SELECT";
+        filter.table = "wide";
+        filter.selectColumns = {"id"};
+        filter.whereColumn = "score";
+        filter.whereValue1 = "100";
+        filter.whereValue2 = "199";
+        filter.op = "BETWEEN";
+        ParsedCommand sum = makeAggregate("wide", {{"SUM", "score"}});
+
+        size_t threads = FileManager::scanThreads();
+        std::clog << "[INFO] parallel_scan " << threads << " scan thread(s), "
+                  << std::thread::hardware_concurrency() << " core(s)" << std::endl;
+
+        // the parallel scan has to give the rows of the serial one, in the same order
+        std::vector<std::pair<std::string, ParsedCommand>> checks = {
+            {"show", makeShow("wide")}, {"sum", sum}, {"filter", filter}};
+        for (const auto& check : checks) {
+            auto parallel = resultRecords(check.second);
+            FileManager::setScanThreads(1);
+            auto serial = resultRecords(check.second);
+            FileManager::setScanThreads(threads);
+            if (parallel != serial) {
+                std::clog << "[ERROR] parallel_" << check.first << " gave " << parallel.size()
+                          << " row(s), the serial scan " << serial.size() << " (or rows differ)" << std::endl;
+                resultMismatches++;
+            }
+        }
+
+        for (bool single : {false, true}) {
+            FileManager::setScanThreads(single ? 1 : threads);
+            std::string suffix = single ? "_1t" : "";
+            commands.assign(runs, makeShow("wide"));
+            addResult("parallel_show" + suffix, commands);
+            commands.assign(runs, sum);
+            addResult("parallel_sum" + suffix, commands);
+            commands.assign(runs, filter);
+            addResult("parallel_filter" + suffix, commands);
+        }
+        FileManager::setScanThreads(threads);
+    }
+
+    std::vector<uint64_t> shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+
+    if (wants(config, "grow_update")) {
+        commands.clear();
+        for (uint64_t id : shuffled) commands.push_back(makeGrowUpdate("seq", id));
+        addResult("grow_update", commands);
+    }
+
+    if (wants(config, "delete")) {
+        commands.clear();
+        for (uint64_t id : shuffled) commands.push_back(makeDelete("seq", id));
+        addResult("delete", commands);
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        return 1;
+    }
+
+    char dirTemplate[] = "/tmp/picodb_bench_XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        std::cerr << "FATAL: could not create a work directory" << std::endl;
+        return 1;
+    }
+    fs::path workDir = dirTemplate;
+    fs::path startDir = fs::current_path();
+
+    // commands print to cout/cerr, progress goes to clog
+    NullBuffer nullBuffer;
+    std::streambuf* oldCout = std::cout.rdbuf(&nullBuffer);
+    std::streambuf* oldCerr = std::cerr.rdbuf(&nullBuffer);
+    // server handler threads capture their own output, the rest is dropped
+    OutputCapture::install();
+
+    std::vector<std::vector<BenchSummary>> runs;
+    double calibration = 0;   // best calibrationUs() taken around the modes' runs
+    for (size_t run = 0; run < config.repeats; run++) {
+        fs::path runDir = config.repeats > 1 ? workDir / ("run" + std::to_string(run)) : workDir;
+        std::vector<WorkloadResult> results;
+        for (auto mode : config.modes) {
+            fs::path modeDir = runDir / modeName(mode);
+            fs::create_directories(modeDir);
+            fs::current_path(modeDir);
+
+            std::clog << "[INFO] running " << modeName(mode) << " workloads (" << config.ops << " ops each)";
+            if (config.repeats > 1) std::clog << ", run " << run + 1 << " of " << config.repeats;
+            std::clog << std::endl;
+            // machine speed before and after, the mode's results are scaled by their mean
+            double before = PerfCheck::calibrationUs();
+            size_t firstResult = results.size();
+            runMode(config, mode, results);
+            double after = PerfCheck::calibrationUs();
+            for (size_t i = firstResult; i < results.size(); i++) results[i].calibrationUs = (before + after) / 2;
+            calibration = calibration == 0 ? std::min(before, after) : std::min({calibration, before, after});
+        }
+        fs::current_path(startDir);
+
+        runs.emplace_back();
+        for (const auto& result : results) runs.back().push_back(summarize(result));
+        // a later run starts on fresh data, this one's files are not needed any more
+        if (config.repeats > 1 && !config.keepData) fs::remove_all(runDir);
+    }
+
+    std::cout.rdbuf(oldCout);
+    std::cerr.rdbuf(oldCerr);
+
+    std::vector<BenchSummary> summaries = config.repeats > 1 ? PerfCheck::bestOfRuns(runs, calibration) : runs[0];
+
+    writeJson(std::cout, config, summaries);
+    if (!config.outPath.empty()) {
+        std::ofstream out(config.outPath);
+        writeJson(out, config, summaries);
+    }
+
+    if (!config.keepData) {
+        fs::remove_all(workDir);
+    } else {
+        std::cerr << "[INFO] data kept in " << workDir.string() << std::endl;
+    }
+
+    if (resultMismatches != 0) {
+        std::cerr << "\n*** RESULT CHECK FAILED: " << resultMismatches << " parallel scan(s) differ from serial ***\n";
+        return 1;
+    }
+
+    if (!config.baselineOutPath.empty()) {
+        if (!PerfCheck::writeBaseline(config.baselineOutPath, config.ops, calibration, summaries)) {
+            std::cerr << "ERROR: cannot write " << config.baselineOutPath << std::endl;
+            return 1;
+        }
+        std::cerr << "[INFO] baseline written to " << config.baselineOutPath << std::endl;
+    }
+
+    if (!config.checkPath.empty()) {
+        std::cerr << "\nperf-check against " << config.checkPath << "\n";
+        int regressions = PerfCheck::check(config.checkPath, config.ops, calibration, summaries, std::cerr);
+        if (regressions != 0) {
+            std::cerr << "\n*** PERF CHECK FAILED: "
+                      << (regressions < 0 ? std::string("baseline unusable") : std::to_string(regressions) + " scenario(s) regressed")
+                      << " ***\n";
+            return 1;
+        }
+        std::cerr << "\nperf-check passed\n";
+    }
+    return 0;
+}
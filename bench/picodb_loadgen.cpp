@@ -0,0 +1,413 @@
+/*
+  picodb_loadgen: YCSB style load generator for a running picodb_server.
+
+  Opens N client connections (one thread each) and runs one of the YCSB core
+  workload mixes against a "usertable" with zipfian key choice:
+
+    a  50% read, 50% update            (update heavy)
+    b  95% read,  5% update            (read mostly)
+    c  100% read                       (read only)
+    d  95% read,  5% insert            (read latest: keys skew to new rows)
+    e  95% scan,  5% insert            (short BETWEEN ranges, needs B+ tree mode)
+    f  50% read, 50% read-modify-write
+
+  Every interval it prints throughput, latency percentiles and errors;
+  a summary for the whole run follows at the end.
+
+  Usage: ./picodb_loadgen [--host H] [--port P] [--clients N] [--workload a-f]
+                          [--records N] [--duration S] [--interval S]
+                          [--theta T] [--seed N] [--no-load]
+  --host also takes unix:/path for the Unix domain socket.
+*/
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include "picodb_client.h"
+#include "metrics.h"
+
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    size_t clients = 8;
+    char workload = 'a';
+    uint64_t records = 1000;
+    double durationSeconds = 10;
+    double intervalSeconds = 1;
+    double theta = 0.99;
+    uint64_t seed = 1;
+    bool load = true;
+};
+
+enum class Operation { READ, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE };
+
+struct OperationMix {
+    double read = 0;
+    double update = 0;
+    double insert = 0;
+    double scan = 0;
+    double readModifyWrite = 0;
+    bool latest = false;   //d: pick keys near the newest insert
+};
+
+struct IntervalStats {
+    Metrics::Histogram latencyUs;
+    std::atomic<uint64_t> operations{0};
+    std::atomic<uint64_t> errors{0};
+};
+
+static const char* TABLE = "usertable";
+static const uint64_t MAX_SCAN_LENGTH = 100;
+
+static OperationMix mixFor(char workload) {
+    OperationMix mix;
+    switch (workload) {
+        case 'a': mix.read = 0.5; mix.update = 0.5; break;
+        case 'b': mix.read = 0.95; mix.update = 0.05; break;
+        case 'c': mix.read = 1.0; break;
+        case 'd': mix.read = 0.95; mix.insert = 0.05; mix.latest = true; break;
+        case 'e': mix.scan = 0.95; mix.insert = 0.05; break;
+        case 'f': mix.read = 0.5; mix.readModifyWrite = 0.5; break;
+    }
+    return mix;
+}
+
+/*
+  Zipfian over [0, n) as in YCSB (Gray et al., "Quickly generating
+  billion-record synthetic databases"). Items are scrambled with a hash so
+  the hot keys are spread over the table instead of being 0, 1, 2...
+  zeta(n) is computed once, n may grow afterwards (inserts) for free by
+  clamping, which is what YCSB does for its scrambled generator too.
+*/
+class ZipfianGenerator {
+private:
+    uint64_t items;
+    double theta;
+    double alpha;
+    double zetaN;
+    double eta;
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; i++) {
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+public:
+    ZipfianGenerator(uint64_t items, double theta) : items(items), theta(theta) {
+        double zeta2 = zeta(2, theta);
+        zetaN = zeta(items, theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / items, 1.0 - theta)) / (1.0 - zeta2 / zetaN);
+    }
+
+    // rank: 0 is the most popular
+    uint64_t nextRank(std::mt19937_64& random) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+        double uz = u * zetaN;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+        uint64_t rank = static_cast<uint64_t>(items * std::pow(eta * u - eta + 1.0, alpha));
+        return rank < items ? rank : items - 1;
+    }
+
+    uint64_t nextScrambled(std::mt19937_64& random, uint64_t keyCount) const {
+        uint64_t rank = nextRank(random);
+        // FNV-1a of the rank
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < 8; i++) {
+            hash ^= (rank >> (i * 8)) & 0xff;
+            hash *= 0x100000001b3ULL;
+        }
+        return hash % keyCount;
+    }
+};
+
+static std::string randomField(std::mt19937_64& random) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    std::string value(10, 'a');
+    for (char& ch : value) ch = letters[random() % 26];
+    return value;
+}
+
+static std::string insertQuery(uint64_t key, std::mt19937_64& random) {
+    return "INSERT INTO " + std::string(TABLE) + " VALUES (" + std::to_string(key) + ", \"" +
+           randomField(random) + "\", \"" + randomField(random) + "\");";
+}
+
+static std::string readQuery(uint64_t key) {
+    return "SELECT * FROM " + std::string(TABLE) + " WHERE id = " + std::to_string(key) + ";";
+}
+
+static std::string updateQuery(uint64_t key, std::mt19937_64& random) {
+    // same length as the loaded value, so the record is rewritten in place
+    return "UPDATE " + std::string(TABLE) + " SET field0 = \"" + randomField(random) +
+           "\" WHERE id = " + std::to_string(key) + ";";
+}
+
+static std::string scanQuery(uint64_t key, uint64_t length) {
+    return "SELECT * FROM " + std::string(TABLE) + " WHERE id BETWEEN " + std::to_string(key) +
+           " AND " + std::to_string(key + length - 1) + ";";
+}
+
+// the server reports some failures as normal text, e.g. "[ERROR] Table not found"
+static bool isErrorResponse(const Message& response) {
+    if (response.type == MSG_RESPONSE_ERROR || response.type == MSG_UNKNOWN) return true;
+    if (response.text.find("[ERROR]") != std::string::npos) return true;
+    for (const auto& row : response.rows) {
+        if (row.find("[ERROR]") != std::string::npos) return true;
+    }
+    return false;
+}
+
+static bool runQuery(PicoDBClient& client, const std::string& sql) {
+    Message response;
+    if (!client.isConnected() && !client.reconnect()) {
+        return false;
+    }
+    if (!client.query(sql, response)) {
+        client.reconnect();
+        return false;
+    }
+    return !isErrorResponse(response);
+}
+
+static bool loadTable(const LoadConfig& config) {
+    PicoDBClient setup(config.host, config.port);
+    if (!setup.connect()) {
+        std::cerr << "ERROR: cannot connect to " << config.host << ":" << config.port
+                  << " (" << setup.getLastError() << ")" << std::endl;
+        return false;
+    }
+
+    Message response;
+    setup.query("CREATE TABLE " + std::string(TABLE) + "(id INT PRIMARY, field0 TEXT, field1 TEXT);", response);
+    setup.disconnect();
+
+    std::cout << "Loading " << config.records << " records with " << config.clients << " clients..." << std::endl;
+    std::atomic<uint64_t> nextKey{0};
+    std::atomic<uint64_t> failed{0};
+    std::vector<std::thread> loaders;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < config.clients; i++) {
+        loaders.emplace_back([&, i]() {
+            std::mt19937_64 random(config.seed * 7919 + i);
+            PicoDBClient client(config.host, config.port);
+            if (!client.connect()) {
+                failed++;
+                return;
+            }
+
+            // one pipelined batch at a time keeps the load phase short
+            std::vector<std::string> batch;
+            while (true) {
+                batch.clear();
+                for (int n = 0; n < 64; n++) {
+                    uint64_t key = nextKey++;
+                    if (key >= config.records) break;
+                    batch.push_back(insertQuery(key, random));
+                }
+                if (batch.empty()) break;
+
+                std::vector<Message> responses = client.pipeline(batch);
+                failed += batch.size() - responses.size();
+                for (auto& response : responses) {
+                    if (isErrorResponse(response)) failed++;
+                }
+            }
+            client.disconnect();
+        });
+    }
+    for (auto& loader : loaders) loader.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Loaded in " << std::fixed << std::setprecision(2) << seconds << " s";
+    if (failed > 0) std::cout << ", " << failed.load() << " inserts failed";
+    std::cout << std::endl;
+    return true;
+}
+
+static void printHeader() {
+    std::cout << std::setw(8) << "time(s)" << std::setw(10) << "ops/s"
+              << std::setw(10) << "p50(us)" << std::setw(10) << "p99(us)"
+              << std::setw(11) << "p999(us)" << std::setw(10) << "max(us)"
+              << std::setw(8) << "errors" << std::setw(8) << "err%" << "\n";
+}
+
+static void printLine(const std::string& label, double seconds, const Metrics::Histogram& latency,
+                      uint64_t operations, uint64_t errors) {
+    double total = static_cast<double>(operations);
+    std::cout << std::setw(8) << label << std::fixed
+              << std::setw(10) << std::setprecision(0) << (seconds > 0 ? total / seconds : 0)
+              << std::setw(10) << latency.percentile(0.50)
+              << std::setw(10) << latency.percentile(0.99)
+              << std::setw(11) << latency.percentile(0.999)
+              << std::setw(10) << latency.max()
+              << std::setw(8) << errors
+              << std::setw(8) << std::setprecision(2) << (total > 0 ? 100.0 * errors / total : 0.0)
+              << std::endl;
+}
+
+static bool parseArguments(int argc, char** argv, LoadConfig& config) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--no-load") config.load = false;
+        else if (arg == "--host" && hasValue) config.host = argv[++i];
+        else if (arg == "--port" && hasValue) config.port = std::atoi(argv[++i]);
+        else if (arg == "--clients" && hasValue) config.clients = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--records" && hasValue) config.records = std::max(10L, std::atol(argv[++i]));
+        else if (arg == "--duration" && hasValue) config.durationSeconds = std::atof(argv[++i]);
+        else if (arg == "--interval" && hasValue) config.intervalSeconds = std::atof(argv[++i]);
+        else if (arg == "--theta" && hasValue) config.theta = std::atof(argv[++i]);
+        else if (arg == "--seed" && hasValue) config.seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--workload" && hasValue) config.workload = static_cast<char>(std::tolower(argv[++i][0]));
+        else {
+            std::cerr << "Usage: ./picodb_loadgen [--host H] [--port P] [--clients N] [--workload a-f]\n"
+                      << "                        [--records N] [--duration S] [--interval S]\n"
+                      << "                        [--theta T] [--seed N] [--no-load]\n";
+            return false;
+        }
+    }
+
+    if (config.workload < 'a' || config.workload > 'f') {
+        std::cerr << "ERROR: workload must be one of a-f" << std::endl;
+        return false;
+    }
+    if (config.durationSeconds <= 0 || config.intervalSeconds <= 0 || config.theta <= 0 || config.theta >= 1) {
+        std::cerr << "ERROR: duration and interval must be > 0, theta in (0,1)" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    LoadConfig config;
+    if (!parseArguments(argc, argv, config)) {
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    if (config.load && !loadTable(config)) {
+        return 1;
+    }
+
+    OperationMix mix = mixFor(config.workload);
+    ZipfianGenerator zipfian(config.records, config.theta);
+    std::atomic<uint64_t> keyCount{config.records};   //grows with inserts
+
+    size_t intervalCount = static_cast<size_t>(std::ceil(config.durationSeconds / config.intervalSeconds));
+    std::vector<std::unique_ptr<IntervalStats>> intervals;
+    for (size_t i = 0; i < intervalCount; i++) intervals.emplace_back(new IntervalStats());
+    IntervalStats totals;
+
+    std::cout << "Workload " << static_cast<char>(std::toupper(config.workload)) << ", "
+              << config.clients << " clients, " << config.records << " records, theta "
+              << config.theta << ", " << config.durationSeconds << " s" << std::endl;
+
+    std::atomic<bool> stop{false};
+    auto start = std::chrono::steady_clock::now();
+
+    auto pickKey = [&](std::mt19937_64& random) -> uint64_t {
+        uint64_t count = keyCount.load(std::memory_order_relaxed);
+        if (mix.latest) {
+            uint64_t back = zipfian.nextRank(random);
+            return back < count ? count - 1 - back : 0;
+        }
+        return zipfian.nextScrambled(random, count);
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < config.clients; i++) {
+        workers.emplace_back([&, i]() {
+            std::mt19937_64 random(config.seed * 104729 + i);
+            std::uniform_real_distribution<double> chance(0.0, 1.0);
+            std::uniform_int_distribution<uint64_t> scanLength(1, MAX_SCAN_LENGTH);
+
+            PicoDBClient client(config.host, config.port);
+            if (!client.connect()) {
+                std::cerr << "ERROR: client " << i << " could not connect: " << client.getLastError() << std::endl;
+                return;
+            }
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                double roll = chance(random);
+                Operation operation;
+                if ((roll -= mix.read) < 0) operation = Operation::READ;
+                else if ((roll -= mix.update) < 0) operation = Operation::UPDATE;
+                else if ((roll -= mix.insert) < 0) operation = Operation::INSERT;
+                else if ((roll -= mix.scan) < 0) operation = Operation::SCAN;
+                else operation = Operation::READ_MODIFY_WRITE;
+
+                auto opStart = std::chrono::steady_clock::now();
+                bool ok = true;
+                switch (operation) {
+                    case Operation::READ:
+                        ok = runQuery(client, readQuery(pickKey(random)));
+                        break;
+                    case Operation::UPDATE:
+                        ok = runQuery(client, updateQuery(pickKey(random), random));
+                        break;
+                    case Operation::INSERT: {
+                        uint64_t key = keyCount.fetch_add(1);
+                        ok = runQuery(client, insertQuery(key, random));
+                        break;
+                    }
+                    case Operation::SCAN:
+                        ok = runQuery(client, scanQuery(pickKey(random), scanLength(random)));
+                        break;
+                    case Operation::READ_MODIFY_WRITE: {
+                        uint64_t key = pickKey(random);
+                        ok = runQuery(client, readQuery(key)) && runQuery(client, updateQuery(key, random));
+                        break;
+                    }
+                }
+                auto opEnd = std::chrono::steady_clock::now();
+
+                double elapsed = std::chrono::duration<double>(opEnd - start).count();
+                size_t slot = static_cast<size_t>(elapsed / config.intervalSeconds);
+                if (slot >= intervalCount) break;
+
+                uint64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(opEnd - opStart).count();
+                for (IntervalStats* stats : {intervals[slot].get(), &totals}) {
+                    stats->latencyUs.record(latencyUs);
+                    stats->operations.fetch_add(1, std::memory_order_relaxed);
+                    if (!ok) stats->errors.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            client.disconnect();
+        });
+    }
+
+    printHeader();
+    for (size_t i = 0; i < intervalCount; i++) {
+        auto intervalEnd = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                       std::chrono::duration<double>(config.intervalSeconds * (i + 1)));
+        std::this_thread::sleep_until(intervalEnd);
+
+        const IntervalStats& stats = *intervals[i];
+        std::ostringstream label;
+        label << std::fixed << std::setprecision(1) << config.intervalSeconds * (i + 1);
+        printLine(label.str(), config.intervalSeconds, stats.latencyUs, stats.operations.load(), stats.errors.load());
+    }
+
+    stop = true;
+    for (auto& worker : workers) worker.join();
+
+    double seconds = std::min(config.durationSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    std::cout << "--------------------------------------------------------------------------" << std::endl;
+    printLine("total", seconds, totals.latencyUs, totals.operations.load(), totals.errors.load());
+    return 0;
+}
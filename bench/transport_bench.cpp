@@ -0,0 +1,195 @@
+/*
+  Round trip latency: loopback TCP vs Unix domain socket.
+
+  Starts an in-process PicoDB server listening on both transports, then
+  sends PING frames one at a time over each and reports the latency
+  distribution in microseconds.
+
+  Usage: ./picodb_transport_bench [iterations] [port]
+*/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "server_socket.h"
+#include "client_handler.h"
+#include "lock_manager.h"
+#include "message_protocol.h"
+#include "parser.h"
+#include "output_capture.h"
+
+struct LatencySummary {
+    double meanUs = 0;
+    double p50Us = 0;
+    double p99Us = 0;
+    double p999Us = 0;
+    double maxUs = 0;
+};
+
+static int connectTcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return fd;
+}
+
+static int connectUnix(const std::string& path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool runPings(int fd, int iterations, LatencySummary& summary) {
+    FrameReader reader(fd);
+    std::string frame;
+
+    // welcome message
+    if (!reader.readFrame(frame)) return false;
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+
+    for (int i = 0; i < iterations; i++) {
+        Message ping = Message::createPingMessage();
+        ping.requestId = static_cast<uint32_t>(i + 1);
+        std::string serialized = MessageProtocol::serializeMessage(ping);
+
+        auto start = std::chrono::steady_clock::now();
+        if (!MessageProtocol::sendFrame(fd, serialized) || !reader.readFrame(frame)) {
+            return false;
+        }
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    Message bye;
+    bye.type = MSG_DISCONNECT;
+    MessageProtocol::sendFrame(fd, MessageProtocol::serializeMessage(bye));
+    reader.readFrame(frame);
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (double s : samples) total += s;
+
+    auto percentile = [&](double p) {
+        size_t index = static_cast<size_t>(p * (samples.size() - 1));
+        return samples[index];
+    };
+
+    summary.meanUs = total / samples.size();
+    summary.p50Us = percentile(0.50);
+    summary.p99Us = percentile(0.99);
+    summary.p999Us = percentile(0.999);
+    summary.maxUs = samples.back();
+    return true;
+}
+
+static void printSummary(const std::string& name, const LatencySummary& s) {
+    std::cout << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << s.meanUs
+              << std::setw(10) << s.p50Us
+              << std::setw(10) << s.p99Us
+              << std::setw(10) << s.p999Us
+              << std::setw(10) << s.maxUs << "\n";
+}
+
+int main(int argc, char** argv) {
+    int iterations = 20000;
+    int port = 9400;
+    if (argc > 1) iterations = std::max(1, std::atoi(argv[1]));
+    if (argc > 2) port = std::atoi(argv[2]);
+
+    std::string socketPath = "/tmp/picodb_bench_" + std::to_string(getpid()) + ".sock";
+
+    ServerSocket server(port);
+    if (!server.initializeServer() || !server.initializeUnixSocket(socketPath)) {
+        std::cerr << "FATAL: could not start bench server" << std::endl;
+        return 1;
+    }
+
+    LockManager lockManager;
+    Parser sqlParser;
+    OutputCapture::install();
+
+    // server log lines would disturb the timings
+    std::cout.setstate(std::ios::failbit);
+
+    std::thread acceptThread([&]() {
+        int clientCounter = 0;
+        while (server.isRunning()) {
+            int clientFd = server.acceptClientConnection();
+            if (clientFd < 0) continue;
+
+            std::string clientId = "bench-" + std::to_string(++clientCounter);
+            std::thread([clientFd, clientId, &server, &lockManager, &sqlParser]() {
+                ClientHandler handler(clientFd, clientId, &server, &lockManager, &sqlParser);
+                handler.handleClientCommunication();
+            }).detach();
+        }
+    });
+    acceptThread.detach();
+
+    LatencySummary tcpSummary;
+    LatencySummary unixSummary;
+
+    int tcpFd = connectTcp(port);
+    bool tcpOk = tcpFd >= 0 && runPings(tcpFd, iterations, tcpSummary);
+    if (tcpFd >= 0) close(tcpFd);
+
+    int unixFd = connectUnix(socketPath);
+    bool unixOk = unixFd >= 0 && runPings(unixFd, iterations, unixSummary);
+    if (unixFd >= 0) close(unixFd);
+
+    std::cout.clear();
+    std::cout << "PING round trip, " << iterations << " iterations (microseconds)\n";
+    std::cout << std::left << std::setw(8) << "" << std::right
+              << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99"
+              << std::setw(10) << "p99.9" << std::setw(10) << "max" << "\n";
+    if (tcpOk) printSummary("tcp", tcpSummary);
+    else std::cout << "tcp     failed\n";
+    if (unixOk) printSummary("unix", unixSummary);
+    else std::cout << "unix    failed\n";
+
+    if (tcpOk && unixOk && unixSummary.p50Us > 0) {
+        std::cout << "unix p50 speedup: " << std::setprecision(2) << tcpSummary.p50Us / unixSummary.p50Us << "x\n";
+    }
+
+    server.shutdownServer();
+
+    // accept thread is still parked in poll(), skip destructors
+    std::cout << std::flush;
+    _exit((tcpOk && unixOk) ? 0 : 1);
+}
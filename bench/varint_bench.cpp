@@ -0,0 +1,146 @@
+/*
+  Varint microbenchmark: the vector based encode/decode against the
+  pointer API (encodeTo, decode(ptr, end), decodeBatch).
+
+  Three value mixes: all 1 byte, all 2 byte, and a log-uniform mix up to
+  2^40. Each result is checked against the input so a fast but wrong
+  decoder shows up as an error instead of a speedup.
+
+  Usage: ./picodb_varint_bench [values] [rounds]
+*/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include "varint.h"
+
+struct ValueMix {
+    std::string name;
+    std::vector<uint64_t> values;
+};
+
+static ValueMix makeMix(const std::string &name, size_t count, int maxBits, bool logUniform) {
+    std::mt19937_64 rng(42);
+    ValueMix mix;
+    mix.name = name;
+    mix.values.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        int bits = logUniform ? static_cast<int>(rng() % maxBits) + 1 : maxBits;
+        mix.values.push_back(rng() & ((uint64_t(1) << bits) - 1));
+    }
+    return mix;
+}
+
+// best of rounds, in nanoseconds per value
+static double timeIt(size_t rounds, size_t count, const std::function<void()> &body) {
+    double best = 0;
+    for (size_t r = 0; r < rounds; r++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best / count;
+}
+
+static void printRow(const std::string &mix, const std::string &op, double oldNs, double newNs) {
+    std::cout << "| " << std::left << std::setw(7) << mix << " | " << std::setw(13) << op << std::right
+              << " | " << std::setw(8) << oldNs << " | " << std::setw(8) << newNs
+              << " | " << std::setw(6) << (newNs > 0 ? oldNs / newNs : 0) << "x |\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    size_t rounds = argc > 2 ? std::stoull(argv[2]) : 5;
+
+    std::vector<ValueMix> mixes = {
+        makeMix("1byte", count, 7, false),
+        makeMix("2byte", count, 14, false),
+        makeMix("mixed", count, 40, true),
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "values " << count << ", best of " << rounds << " rounds, ns per value\n";
+    std::cout << "---------------------------------------------------------\n";
+    std::cout << "| mix     | op            |   vector |  pointer | speedup |\n";
+    std::cout << "---------------------------------------------------------\n";
+
+    int errors = 0;
+    volatile uint64_t sink = 0;
+
+    for (auto &mix : mixes) {
+        const std::vector<uint64_t> &values = mix.values;
+
+        std::vector<uint8_t> encoded;
+        encoded.reserve(count * Varint::MAX_BYTES);
+        double oldEncode = timeIt(rounds, count, [&]() {
+            encoded.clear();
+            for (uint64_t v : values) {
+                auto bytes = Varint::encode(v);
+                encoded.insert(encoded.end(), bytes.begin(), bytes.end());
+            }
+        });
+
+        std::vector<uint8_t> buffer(count * Varint::MAX_BYTES);
+        size_t used = 0;
+        double newEncode = timeIt(rounds, count, [&]() {
+            used = 0;
+            for (uint64_t v : values) {
+                used += Varint::encodeTo(buffer.data() + used, v);
+            }
+        });
+        buffer.resize(used);
+        if (buffer != encoded) {
+            std::cout << "[ERROR] encodeTo output differs for " << mix.name << "\n";
+            errors++;
+        }
+        printRow(mix.name, "encode", oldEncode, newEncode);
+
+        std::vector<uint64_t> decoded(count);
+        double oldDecode = timeIt(rounds, count, [&]() {
+            size_t pos = 0;
+            for (size_t i = 0; i < count; i++) {
+                size_t readByte = 0;
+                decoded[i] = Varint::decode(encoded, pos, readByte);
+                pos += readByte;
+            }
+        });
+        if (decoded != values) {
+            std::cout << "[ERROR] vector decode mismatch for " << mix.name << "\n";
+            errors++;
+        }
+
+        const uint8_t *begin = buffer.data();
+        const uint8_t *end = buffer.data() + buffer.size();
+        double newDecode = timeIt(rounds, count, [&]() {
+            const uint8_t *p = begin;
+            for (size_t i = 0; i < count; i++) {
+                size_t readByte = 0;
+                decoded[i] = Varint::decode(p, end, readByte);
+                p += readByte;
+            }
+        });
+        if (decoded != values) {
+            std::cout << "[ERROR] pointer decode mismatch for " << mix.name << "\n";
+            errors++;
+        }
+        printRow(mix.name, "decode", oldDecode, newDecode);
+
+        size_t batchUsed = 0;
+        double batchDecode = timeIt(rounds, count, [&]() {
+            batchUsed = Varint::decodeBatch(begin, end, decoded.data(), count);
+        });
+        if (decoded != values || batchUsed != buffer.size()) {
+            std::cout << "[ERROR] batch decode mismatch for " << mix.name << "\n";
+            errors++;
+        }
+        printRow(mix.name, "decodeBatch", oldDecode, batchDecode);
+        sink = sink + decoded[count / 2];
+    }
+
+    std::cout << "---------------------------------------------------------\n";
+    return errors == 0 ? 0 : 1;
+}
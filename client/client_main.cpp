@@ -1,168 +1,113 @@
 #include <iostream>
 #include <string>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <cstring>
+#include <vector>
+#include <iomanip>
+#include <sstream>
+#include "picodb_client.h"
 #include "message_protocol.h"
+#include "result_codec.h"
 
 
-class PicoDBClient {
-private:
-    int socketFd;                      
-    std::string serverHost;            
-    int port;
-    bool connected;
-    struct sockaddr_in address;
+// server reports microseconds
+static void printElapsed(int timeUs) {
+    if (timeUs > 0) {
+        std::ostringstream elapsed;
+        elapsed << std::fixed << std::setprecision(3) << timeUs / 1000.0;
+        std::cout << "time: " << elapsed.str() << "ms" << std::endl;
+    }
+}
+
+static void displayResult(const Message& response) {
+    if (!response.text.empty()) {
+        std::cout << response.text;
+    }
     
-public:
-    PicoDBClient(const std::string& host, int port) {
-        serverHost = host;
-        this->port = port;
-        socketFd = -1;
-        connected = false;
-        memset(&address, 0, sizeof(address));
+    DecodedResult result;
+    if (!ResultCodec::decode(response.payload, result)) {
+        std::cout << "Error: malformed result from server" << std::endl;
+        return;
     }
     
-    ~PicoDBClient() {
-        disconnect();
+    std::string line;
+    std::cout << "-------------------------------------------------" << std::endl;
+    for (auto& column : result.columns) {
+        line += "| " + column.name + " ";
     }
+    std::cout << line << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
     
-    bool connect() {
-        std::cout << "Connecting to " << serverHost << ":" << port << "..." << std::endl;
-        
-        socketFd = socket(AF_INET, SOCK_STREAM, 0);
-        if (socketFd < 0) {
-            std::cerr << "ERROR: Failed to create socket" << std::endl;
-            return false;
-        }
-        
-        address.sin_family = AF_INET;
-        address.sin_port = htons(port);
-        
-        if (inet_pton(AF_INET, serverHost.c_str(), &address.sin_addr) <= 0) {
-            std::cerr << "ERROR: Invalid server address: " << serverHost << std::endl;
-            close(socketFd);
-            return false;
+    for (size_t row = 0; row < result.rowCount; row++) {
+        line.clear();
+        for (auto& column : result.columns) {
+            line += "| " + ResultCodec::cellToString(column, row) + " ";
         }
-        
-        if (::connect(socketFd, (struct sockaddr*)&address, sizeof(address)) < 0) {
-            std::cerr << "ERROR: Connection failed! Is the server running?" << std::endl;
-            close(socketFd);
-            return false;
-        }
-        
-        connected = true;
-        std::cout << "Connected." << std::endl;
-        
-        receiveResponse();
-        
-        return true;
+        std::cout << line << "\n";
     }
     
-    void disconnect() {
-        if (connected) {
-            Message disconnectMsg;
-            disconnectMsg.type = MSG_DISCONNECT;
-            disconnectMsg.text = "DISCONNECT";
+    std::cout << result.rowCount << " row(s)" << std::endl;
+    printElapsed(response.timeUs);
+}
+
+static void displayResponse(const Message& response) {
+    switch (response.type) {
+        case MSG_RESPONSE_OK:
+            std::cout << response.text << std::endl;
+            printElapsed(response.timeUs);
+            break;
             
-            std::string serialized = MessageProtocol::serializeMessage(disconnectMsg);
-            send(socketFd, serialized.c_str(), serialized.length(), 0);
+        case MSG_RESPONSE_ERROR:
+            std::cout << "Error: " << response.text << std::endl;
+            break;
             
-            close(socketFd);
-            connected = false;
-            std::cout << "Disconnected." << std::endl;
-        }
-    }
-    
-    bool sendQuery(const std::string& sql) {
-        if (!connected) {
-            std::cerr << "ERROR: Not connected to server" << std::endl;
-            return false;
-        }
-        
-        Message queryMsg = Message::createQueryMessage(sql);
-        std::string serialized = MessageProtocol::serializeMessage(queryMsg);
-        
-        ssize_t bytes_sent = send(socketFd, serialized.c_str(), serialized.length(), 0);
-        
-        if (bytes_sent < 0) {
-            std::cerr << "ERROR: Failed to send query" << std::endl;
-            return false;
-        }
-        
-        return true;
+        case MSG_RESPONSE_DATA:
+            if (response.rows.empty()) {
+                std::cout << "No rows returned." << std::endl;
+            } else {
+                for (size_t i = 0; i < response.rows.size(); i++) {
+                    std::cout << response.rows[i] << std::endl;
+                }
+            }
+
+            std::cout << response.rows.size() << " row(s)" << std::endl;
+            printElapsed(response.timeUs);
+            break;
+            
+        case MSG_RESPONSE_RESULT:
+            displayResult(response);
+            break;
+            
+        default:
+            std::cout << response.text << std::endl;
+            break;
     }
-    
-    bool receiveResponse() {
-        if (!connected) {
-            return false;
-        }
-        
-        const int BUFFER_SIZE = 4096;
-        char buffer[BUFFER_SIZE];
-        memset(buffer, 0, BUFFER_SIZE);
-        
-        ssize_t bytesReceived = recv(socketFd, buffer, BUFFER_SIZE - 1, 0);
-        
-        if (bytesReceived < 0) {
-            std::cerr << "ERROR: Failed to receive response" << std::endl;
-            return false;
-        }
-        
-        if (bytesReceived == 0) {
-            std::cout << "Server closed connection" << std::endl;
-            connected = false;
-            return false;
+}
+
+// Split a line into ';' separated statements, ignoring ';' inside quotes
+static std::vector<std::string> splitStatements(const std::string& line) {
+    std::vector<std::string> statements;
+    std::string current;
+    char quote = 0;
+    
+    for (char ch : line) {
+        if (quote) {
+            if (ch == quote) quote = 0;
+        } else if (ch == '"' || ch == '\'') {
+            quote = ch;
+        } else if (ch == ';') {
+            if (current.find_first_not_of(" \t") != std::string::npos) {
+                statements.push_back(current + ";");
+            }
+            current.clear();
+            continue;
         }
-        
-        buffer[bytesReceived] = '\0';
-        
-        Message response = MessageProtocol::deserializeMessage(std::string(buffer));
-        displayResponse(response);
-        
-        return true;
-    }
-    
-    bool isConnected() const {
-        return connected;
+        current += ch;
     }
     
-private:
-    void displayResponse(const Message& response) {
-        switch (response.type) {
-            case MSG_RESPONSE_OK:
-                std::cout << response.text << std::endl;
-                if (response.timeMs > 0) {
-                    std::cout << "time: " << response.timeMs << "ms" << std::endl;
-                }
-                break;
-                
-            case MSG_RESPONSE_ERROR:
-                std::cout << "Error: " << response.text << std::endl;
-                break;
-                
-            case MSG_RESPONSE_DATA:
-                if (response.rows.empty()) {
-                    std::cout << "No rows returned." << std::endl;
-                } else {
-                    for (size_t i = 0; i < response.rows.size(); i++) {
-                        std::cout << response.rows[i] << std::endl;
-                    }
-                }
-
-                std::cout << response.rows.size() << " row(s)" << std::endl;
-                if (response.timeMs > 0) {
-                    std::cout << "time: " << response.timeMs << "ms" << std::endl;
-                }
-                break;
-                
-            default:
-                std::cout << response.text << std::endl;
-                break;
-        }
+    if (current.find_first_not_of(" \t") != std::string::npos) {
+        statements.push_back(current);
     }
-};
+    return statements;
+}
 
 void printClientBanner() {
     std::cout << "\n";
@@ -178,8 +123,10 @@ void printClientBanner() {
 
 void printClientUsage() {
     std::cout << "Usage: ./picodb_client [server_ip] [port]" << std::endl;
+    std::cout << "       ./picodb_client unix:/path/to/socket" << std::endl;
     std::cout << "Example: ./picodb_client 127.0.0.1 8080" << std::endl;
     std::cout << "Type SQL and press Enter. Type 'quit' to exit." << std::endl;
+    std::cout << "Several statements on one line (a; b; c;) are sent together." << std::endl;
     std::cout << std::endl;
 }
 
@@ -204,10 +151,19 @@ int main(int argc, char** argv) {
     printClientUsage();
     PicoDBClient client(serverHost, serverPort);
     
+    if (PicoDBClient::isUnixSocketTarget(serverHost)) {
+        std::cout << "Connecting to " << serverHost << "..." << std::endl;
+    } else {
+        std::cout << "Connecting to " << serverHost << ":" << serverPort << "..." << std::endl;
+    }
+    
     if (!client.connect()) {
+        std::cerr << "ERROR: " << client.getLastError() << std::endl;
         std::cerr << "FATAL: Could not connect to server" << std::endl;
         return 1;
     }
+    std::cout << "Connected." << std::endl;
+    displayResponse(client.getWelcomeMessage());
     
     std::cout << "Type SQL command. Write 'quit' to exit." << std::endl;
     
@@ -231,11 +187,27 @@ int main(int argc, char** argv) {
             break;
         }
         
-        if (client.sendQuery(userInput)) {
-            client.receiveResponse();
+        // several statements on one line are pipelined in a single round trip
+        std::vector<std::string> statements = splitStatements(userInput);
+        if (statements.size() > 1) {
+            for (auto& response : client.pipeline(statements)) {
+                displayResponse(response);
+            }
+        } else {
+            Message response;
+            if (client.query(userInput, response)) {
+                displayResponse(response);
+            }
         }
+        
+        if (!client.isConnected()) {
+            std::cout << "Server closed connection" << std::endl;
+        }
+    }
+    if (client.isConnected()) {
+        client.disconnect();
+        std::cout << "Disconnected." << std::endl;
     }
-    client.disconnect();
     
     std::cout << "Goodbye!" << std::endl;
     
@@ -0,0 +1,519 @@
+#include "picodb_client.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+#include <chrono>
+#include <cctype>
+#include <deque>
+
+
+PicoDBClient::PicoDBClient(const std::string& host, int port) {
+    serverHost = host;
+    this->port = port;
+    socketFd = -1;
+    connected = false;
+    nextRequestId = 1;
+}
+
+PicoDBClient::~PicoDBClient() {
+    disconnect();
+}
+
+bool PicoDBClient::isUnixSocketTarget(const std::string& host) {
+    return host.rfind("unix:", 0) == 0 || (!host.empty() && host[0] == '/');
+}
+
+bool PicoDBClient::openTcp() {
+    socketFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (socketFd < 0) {
+        lastError = "Failed to create socket";
+        return false;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, serverHost.c_str(), &address.sin_addr) <= 0) {
+        lastError = "Invalid server address: " + serverHost;
+        closeSocket();
+        return false;
+    }
+
+    if (::connect(socketFd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        lastError = "Connection failed! Is the server running?";
+        closeSocket();
+        return false;
+    }
+
+    int noDelay = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    return true;
+}
+
+bool PicoDBClient::openUnix() {
+    std::string socketPath = serverHost.rfind("unix:", 0) == 0 ? serverHost.substr(5) : serverHost;
+
+    struct sockaddr_un unixAddress;
+    memset(&unixAddress, 0, sizeof(unixAddress));
+    if (socketPath.size() >= sizeof(unixAddress.sun_path)) {
+        lastError = "Socket path too long: " + socketPath;
+        return false;
+    }
+
+    socketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socketFd < 0) {
+        lastError = "Failed to create socket";
+        return false;
+    }
+
+    unixAddress.sun_family = AF_UNIX;
+    strncpy(unixAddress.sun_path, socketPath.c_str(), sizeof(unixAddress.sun_path) - 1);
+
+    if (::connect(socketFd, (struct sockaddr*)&unixAddress, sizeof(unixAddress)) < 0) {
+        lastError = "Connection failed! Is the server running with --unix?";
+        closeSocket();
+        return false;
+    }
+    return true;
+}
+
+void PicoDBClient::closeSocket() {
+    if (socketFd >= 0) {
+        close(socketFd);
+        socketFd = -1;
+    }
+    reader.reset();
+    connected = false;
+}
+
+bool PicoDBClient::connect() {
+    bool opened = isUnixSocketTarget(serverHost) ? openUnix() : openTcp();
+    if (!opened) {
+        return false;
+    }
+
+    reader.reset(new FrameReader(socketFd));
+    connected = true;
+    earlyResponses.clear();
+
+    // server greets every new connection with request id 0
+    std::string frame;
+    if (!reader->readFrame(frame)) {
+        lastError = "Server closed connection";
+        closeSocket();
+        return false;
+    }
+    welcomeMessage = MessageProtocol::deserializeMessage(frame);
+    return true;
+}
+
+void PicoDBClient::disconnect() {
+    if (connected) {
+        Message disconnectMsg;
+        disconnectMsg.type = MSG_DISCONNECT;
+        disconnectMsg.text = "DISCONNECT";
+
+        std::string serialized = MessageProtocol::serializeMessage(disconnectMsg);
+        MessageProtocol::sendFrame(socketFd, serialized);
+    }
+    closeSocket();
+}
+
+bool PicoDBClient::reconnect(int attempts, int delayMs) {
+    closeSocket();
+    for (int attempt = 0; attempt < attempts; attempt++) {
+        if (attempt > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs * attempt));
+        }
+        if (connect()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t PicoDBClient::sendQueryAsync(const std::string& sql) {
+    if (!connected) {
+        lastError = "Not connected to server";
+        return 0;
+    }
+
+    uint32_t requestId = nextRequestId++;
+    Message queryMsg = Message::createQueryMessage(sql, requestId);
+    std::string serialized = MessageProtocol::serializeMessage(queryMsg);
+
+    if (!MessageProtocol::sendFrame(socketFd, serialized)) {
+        lastError = "Failed to send query";
+        closeSocket();
+        return 0;
+    }
+
+    return requestId;
+}
+
+bool PicoDBClient::waitForResponse(uint32_t requestId, Message& response) {
+    auto early = earlyResponses.find(requestId);
+    if (early != earlyResponses.end()) {
+        response = early->second;
+        earlyResponses.erase(early);
+        return true;
+    }
+
+    while (connected) {
+        std::string frame;
+        if (!reader->readFrame(frame)) {
+            lastError = "Server closed connection";
+            closeSocket();
+            return false;
+        }
+
+        Message received = MessageProtocol::deserializeMessage(frame);
+        if (received.requestId == requestId) {
+            response = received;
+            return true;
+        }
+        earlyResponses[received.requestId] = received;
+    }
+    return false;
+}
+
+bool PicoDBClient::query(const std::string& sql, Message& response) {
+    uint32_t requestId = sendQueryAsync(sql);
+    if (requestId == 0) {
+        return false;
+    }
+    return waitForResponse(requestId, response);
+}
+
+std::vector<Message> PicoDBClient::pipeline(const std::vector<std::string>& queries) {
+    std::vector<Message> responses;
+    if (!connected) {
+        lastError = "Not connected to server";
+        return responses;
+    }
+
+    uint32_t firstId = nextRequestId;
+    nextRequestId += static_cast<uint32_t>(queries.size());
+
+    // The server answers while it reads, so a batch written in one go can fill
+    // both socket buffers and leave both sides blocked in send. Only up to
+    // PIPELINE_WINDOW_BYTES of requests are left unanswered, far below what the
+    // buffers hold; a single larger query still goes out once nothing is pending.
+    std::deque<size_t> pendingSizes;
+    size_t pendingBytes = 0;
+    size_t next = 0;
+    size_t sendable = queries.size();   // a query over the frame limit ends the batch
+    std::string batch;
+    std::string frame;
+    while (responses.size() < sendable) {
+        batch.clear();
+        while (next < sendable) {
+            Message queryMsg = Message::createQueryMessage(queries[next], firstId + static_cast<uint32_t>(next));
+            std::string body = MessageProtocol::serializeMessage(queryMsg);
+            if (body.size() > MessageProtocol::MAX_FRAME_BYTES) {
+                lastError = "Query is over the frame limit";
+                sendable = next;
+                break;
+            }
+            frame.clear();
+            MessageProtocol::appendFrame(frame, body);
+            if (pendingBytes > 0 && pendingBytes + frame.size() > PIPELINE_WINDOW_BYTES) {
+                break;
+            }
+            batch += frame;
+            pendingSizes.push_back(frame.size());
+            pendingBytes += frame.size();
+            next++;
+        }
+
+        if (!batch.empty() && !MessageProtocol::sendAll(socketFd, batch)) {
+            lastError = "Failed to send query batch";
+            closeSocket();
+            return responses;
+        }
+        if (responses.size() == sendable) {
+            break;
+        }
+
+        Message response;
+        if (!waitForResponse(firstId + static_cast<uint32_t>(responses.size()), response)) {
+            break;
+        }
+        responses.push_back(response);
+        pendingBytes -= pendingSizes.front();
+        pendingSizes.pop_front();
+    }
+    return responses;
+}
+
+bool PicoDBClient::ping() {
+    if (!connected) {
+        return false;
+    }
+
+    uint32_t requestId = nextRequestId++;
+    Message pingMsg = Message::createPingMessage();
+    pingMsg.requestId = requestId;
+    if (!MessageProtocol::sendFrame(socketFd, MessageProtocol::serializeMessage(pingMsg))) {
+        closeSocket();
+        return false;
+    }
+
+    Message response;
+    return waitForResponse(requestId, response);
+}
+
+
+ConnectionPool::ConnectionPool(const std::string& host, int port, size_t maxConnections,
+                               int reconnectAttempts, int reconnectDelayMs) {
+    serverHost = host;
+    this->port = port;
+    this->maxConnections = maxConnections == 0 ? 1 : maxConnections;
+    this->reconnectAttempts = reconnectAttempts;
+    this->reconnectDelayMs = reconnectDelayMs;
+    openConnections = 0;
+    closed = false;
+}
+
+ConnectionPool::~ConnectionPool() {
+    close();
+}
+
+std::unique_ptr<PicoDBClient> ConnectionPool::acquire() {
+    std::unique_ptr<PicoDBClient> connection;
+    {
+        std::unique_lock<std::mutex> lock(poolMutex);
+        available.wait(lock, [this]() {
+            return closed || !idle.empty() || openConnections < maxConnections;
+        });
+        if (closed) {
+            return nullptr;
+        }
+
+        if (!idle.empty()) {
+            connection = std::move(idle.front());
+            idle.pop_front();
+        } else {
+            openConnections++;
+            connection.reset(new PicoDBClient(serverHost, port));
+        }
+    }
+
+    // connecting happens outside the lock so other threads are not held up
+    if (!connection->isConnected() && !connection->reconnect(reconnectAttempts, reconnectDelayMs)) {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        openConnections--;
+        available.notify_one();
+        return nullptr;
+    }
+    return connection;
+}
+
+void ConnectionPool::release(std::unique_ptr<PicoDBClient> connection) {
+    if (!connection) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (closed) {
+        openConnections--;
+        return;
+    }
+    // broken connections stay in the pool and are reconnected on next acquire
+    idle.push_back(std::move(connection));
+    available.notify_one();
+}
+
+void ConnectionPool::close() {
+    std::deque<std::unique_ptr<PicoDBClient>> toClose;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        closed = true;
+        openConnections -= idle.size();
+        toClose.swap(idle);
+        available.notify_all();
+    }
+    // destructors send DISCONNECT
+    toClose.clear();
+}
+
+size_t ConnectionPool::getOpenConnections() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return openConnections;
+}
+
+
+AsyncClient::AsyncClient(const std::string& host, int port, AsyncClientOptions options)
+    : options(options),
+      pool(host, port, options.connections, options.reconnectAttempts, options.reconnectDelayMs) {
+    stopping = false;
+    if (this->options.maxBatch == 0) {
+        this->options.maxBatch = 1;
+    }
+
+    size_t workerCount = options.connections == 0 ? 1 : options.connections;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+AsyncClient::~AsyncClient() {
+    shutdown();
+}
+
+std::future<Message> AsyncClient::submit(const std::string& sql) {
+    PendingQuery pending;
+    pending.sql = sql;
+    std::future<Message> result = pending.promise.get_future();
+    enqueue(std::move(pending));
+    return result;
+}
+
+void AsyncClient::submit(const std::string& sql, Callback callback) {
+    PendingQuery pending;
+    pending.sql = sql;
+    pending.callback = std::move(callback);
+    pending.hasCallback = true;
+    enqueue(std::move(pending));
+}
+
+Message AsyncClient::query(const std::string& sql) {
+    return submit(sql).get();
+}
+
+void AsyncClient::enqueue(PendingQuery pending) {
+    bool rejected = false;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        rejected = stopping;
+        if (!rejected) {
+            queue.push_back(std::move(pending));
+        }
+    }
+    // outside the lock: a callback may submit again
+    if (rejected) {
+        complete(pending, Message::createErrorMessage("Client is shut down"));
+        return;
+    }
+    queueReady.notify_one();
+}
+
+void AsyncClient::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (stopping && workers.empty()) {
+            return;
+        }
+        stopping = true;
+    }
+    queueReady.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+    pool.close();
+}
+
+/*
+  Each worker takes everything that is queued (up to maxBatch) and sends it
+  as one pipelined batch on a pooled connection. Under load this turns many
+  small round trips into a few large ones without the caller doing anything.
+*/
+void AsyncClient::workerLoop() {
+    while (true) {
+        std::vector<PendingQuery> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueReady.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;   //stopping and nothing left
+            }
+
+            while (!queue.empty() && batch.size() < options.maxBatch) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+
+        runBatch(batch);
+    }
+}
+
+// SELECT, SHOW and STATS change nothing, running them twice is harmless
+static bool isReadOnly(const std::string& sql) {
+    size_t start = sql.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        return false;
+    }
+    size_t end = sql.find_first_of(" \t\r\n;(", start);
+    std::string word = sql.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    for (auto& c : word) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return word == "SELECT" || word == "SHOW" || word == "STATS";
+}
+
+void AsyncClient::runBatch(std::vector<PendingQuery>& batch) {
+    std::unique_ptr<PicoDBClient> connection = pool.acquire();
+    if (!connection) {
+        for (auto& pending : batch) {
+            complete(pending, Message::createErrorMessage("Could not connect to server"));
+        }
+        return;
+    }
+
+    size_t done = 0;
+    int retriesLeft = options.reconnectAttempts;
+
+    while (done < batch.size()) {
+        std::vector<std::string> queries;
+        for (size_t i = done; i < batch.size(); i++) {
+            queries.push_back(batch[i].sql);
+        }
+
+        std::vector<Message> responses = connection->pipeline(queries);
+        for (auto& response : responses) {
+            complete(batch[done++], response);
+        }
+
+        if (done < batch.size()) {
+            // connection broke: the server may have run an unanswered write and only lost the
+            // reply, so just the read-only queries are resent on a fresh connection; writes
+            // fail and the caller decides whether to retry them
+            std::string reason = connection->getLastError();
+            bool reconnected = retriesLeft-- > 0 &&
+                               connection->reconnect(options.reconnectAttempts, options.reconnectDelayMs);
+            std::vector<PendingQuery> resend;
+            for (; done < batch.size(); done++) {
+                if (reconnected && isReadOnly(batch[done].sql)) {
+                    resend.push_back(std::move(batch[done]));
+                } else {
+                    complete(batch[done], Message::createErrorMessage("Connection lost: " + reason));
+                }
+            }
+            batch.swap(resend);
+            done = 0;
+        }
+    }
+
+    pool.release(std::move(connection));
+}
+
+void AsyncClient::complete(PendingQuery& pending, const Message& response) {
+    if (pending.hasCallback) {
+        if (pending.callback) {
+            pending.callback(response);
+        }
+    } else {
+        pending.promise.set_value(response);
+    }
+}
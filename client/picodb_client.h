@@ -0,0 +1,149 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <thread>
+#include <cstdint>
+#include "message_protocol.h"
+
+/*
+  libpicodb_client
+
+  PicoDBClient   - one blocking connection (TCP or Unix socket) with pipelining
+  ConnectionPool - thread-safe pool of PicoDBClient, reconnects broken ones
+  AsyncClient    - submit queries from any thread, get a future or a callback;
+                   small queries queued together are sent as one pipelined batch
+
+  Host "unix:/path" (or an absolute path) selects the Unix domain socket.
+*/
+
+class PicoDBClient {
+private:
+    int socketFd;
+    std::string serverHost;
+    int port;
+    bool connected;
+
+    std::unique_ptr<FrameReader> reader;
+    uint32_t nextRequestId;
+    std::map<uint32_t, Message> earlyResponses;   //arrived while waiting for another id
+
+    Message welcomeMessage;
+    std::string lastError;
+
+    bool openTcp();
+    bool openUnix();
+    void closeSocket();
+
+public:
+    // unanswered request bytes pipeline() allows, well below the socket buffers
+    static const size_t PIPELINE_WINDOW_BYTES = 32 * 1024;
+
+    PicoDBClient(const std::string& host, int port);
+    ~PicoDBClient();
+
+    PicoDBClient(const PicoDBClient&) = delete;
+    PicoDBClient& operator=(const PicoDBClient&) = delete;
+
+    static bool isUnixSocketTarget(const std::string& host);
+
+    bool connect();
+    void disconnect();
+    // drop the current socket and connect again, up to 'attempts' tries
+    bool reconnect(int attempts = 3, int delayMs = 100);
+
+    bool isConnected() const { return connected; }
+    const std::string& getLastError() const { return lastError; }
+    const Message& getWelcomeMessage() const { return welcomeMessage; }
+    const std::string& getHost() const { return serverHost; }
+    int getPort() const { return port; }
+
+    // Send without waiting for the answer. Returns the request id, 0 on failure.
+    uint32_t sendQueryAsync(const std::string& sql);
+    // Block until the response for requestId arrives.
+    bool waitForResponse(uint32_t requestId, Message& response);
+    bool query(const std::string& sql, Message& response);
+    // Send the queries in writes of up to PIPELINE_WINDOW_BYTES unanswered
+    // requests, collecting the answers in order as they come.
+    // Fewer responses than queries means the connection broke.
+    std::vector<Message> pipeline(const std::vector<std::string>& queries);
+    bool ping();
+};
+
+class ConnectionPool {
+private:
+    std::string serverHost;
+    int port;
+    size_t maxConnections;
+    int reconnectAttempts;
+    int reconnectDelayMs;
+
+    std::deque<std::unique_ptr<PicoDBClient>> idle;
+    size_t openConnections;
+    bool closed;
+
+    std::mutex poolMutex;
+    std::condition_variable available;
+
+public:
+    ConnectionPool(const std::string& host, int port, size_t maxConnections,
+                   int reconnectAttempts = 3, int reconnectDelayMs = 100);
+    ~ConnectionPool();
+
+    // Blocks while all connections are busy. Returns null if connecting failed.
+    std::unique_ptr<PicoDBClient> acquire();
+    void release(std::unique_ptr<PicoDBClient> connection);
+    void close();
+
+    size_t getOpenConnections();
+};
+
+struct AsyncClientOptions {
+    size_t connections = 4;        //pool size, also the number of worker threads
+    size_t maxBatch = 32;          //queries sent together in one pipelined write
+    int reconnectAttempts = 3;      //a broken batch resends only its unanswered SELECT/SHOW/STATS,
+    int reconnectDelayMs = 100;     //other unanswered queries fail with "Connection lost: ..."
+};
+
+class AsyncClient {
+public:
+    using Callback = std::function<void(const Message&)>;
+
+    AsyncClient(const std::string& host, int port, AsyncClientOptions options = AsyncClientOptions());
+    ~AsyncClient();
+
+    std::future<Message> submit(const std::string& sql);
+    void submit(const std::string& sql, Callback callback);
+    Message query(const std::string& sql);
+
+    // finish queued queries and stop the workers
+    void shutdown();
+
+private:
+    struct PendingQuery {
+        std::string sql;
+        std::promise<Message> promise;
+        Callback callback;
+        bool hasCallback = false;
+    };
+
+    AsyncClientOptions options;
+    ConnectionPool pool;
+
+    std::deque<PendingQuery> queue;
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    bool stopping;
+    std::vector<std::thread> workers;
+
+    void enqueue(PendingQuery pending);
+    void workerLoop();
+    void runBatch(std::vector<PendingQuery>& batch);
+    static void complete(PendingQuery& pending, const Message& response);
+};
@@ -0,0 +1,642 @@
+#include "aggregate.h"
+#include "utils.h"
+#include "trace.h"
+#include "varint.h"
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <cstring>
+
+using namespace std;
+using RecordCodec::ColumnType;
+
+static bool isNumber(ColumnType type){
+    return type == ColumnType::INT || type == ColumnType::FLOAT;
+}
+
+static bool isBatched(ColumnType type){
+    return type == ColumnType::INT || type == ColumnType::FLOAT || type == ColumnType::BOOL;
+}
+
+static string floatText(double value){
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", value);   //enough digits to read back the same float
+    return text;
+}
+
+void AggregateTotals::merge(const AggregateTotals &other){
+    if(other.count == 0) return;
+
+    if(count == 0 || other.minInt < minInt) minInt = other.minInt;
+    if(count == 0 || other.maxInt > maxInt) maxInt = other.maxInt;
+    if(count == 0 || other.minFloat < minFloat) minFloat = other.minFloat;
+    if(count == 0 || other.maxFloat > maxFloat) maxFloat = other.maxFloat;
+    if(count == 0 || other.minText < minText) minText = other.minText;
+    if(count == 0 || other.maxText > maxText) maxText = other.maxText;
+    uint64_t before = sumInt;
+    sumInt += other.sumInt;
+    sumIntCarry += other.sumIntCarry + (sumInt < before);
+    sumFloat += other.sumFloat;
+    count += other.count;
+}
+
+/* ---------- AggregatePlan ---------- */
+
+bool AggregatePlan::prepare(const vector<AggregateCall> &aggregateCalls, const vector<pair<string,string>> &tableColumns,
+                            const RecordCodec::Schema &tableSchema){
+    calls = aggregateCalls;
+    schema = &tableSchema;
+    callInput.clear();
+    inputColumns.clear();
+    inputTypes.clear();
+    wantedColumns.assign(tableSchema.types.size(), false);
+
+    for(const AggregateCall &call : calls){
+        if(call.column == "*"){
+            if(call.function != "COUNT"){
+                cout << "[ERROR] " << call.function << "(*) is not supported, only COUNT(*)\n";
+                return false;
+            }
+            callInput.push_back(-1);
+            continue;
+        }
+
+        int column = findColumnIndex(tableColumns, call.column);
+        if(column < 0){
+            cout << "[ERROR] Column " << call.column << " not found\n";
+            return false;
+        }
+        ColumnType type = tableSchema.types[column];
+        if((call.function == "SUM" || call.function == "AVG") && !isNumber(type)){
+            cout << "[ERROR] " << call.function << "(" << call.column << ") needs an INT or FLOAT column\n";
+            return false;
+        }
+
+        //calls on the same column share one input
+        size_t input = 0;
+        while(input < inputColumns.size() && inputColumns[input] != column) input++;
+        if(input == inputColumns.size()){
+            inputColumns.push_back(column);
+            inputTypes.push_back(type);
+            wantedColumns[column] = true;
+        }
+        callInput.push_back(input);
+    }
+    return true;
+}
+
+void AggregatePlan::addValue(size_t input, const vector<uint8_t> &bytes, const RecordCodec::Field &field, AggregateTotals &totals) const{
+    if(field.isNull) return;
+
+    ColumnType type = inputTypes[input];
+    if(type == ColumnType::FLOAT){
+        float value = field.floatValue;
+        if(totals.count == 0 || value < totals.minFloat) totals.minFloat = value;
+        if(totals.count == 0 || value > totals.maxFloat) totals.maxFloat = value;
+        totals.sumFloat += value;
+    }else if(type == ColumnType::INT || type == ColumnType::BOOL){
+        uint64_t value = field.intValue;
+        if(totals.count == 0 || value < totals.minInt) totals.minInt = value;
+        if(totals.count == 0 || value > totals.maxInt) totals.maxInt = value;
+        totals.sumInt += value;
+        totals.sumIntCarry += totals.sumInt < value;
+    }else{
+        //TEXT and DICT, only MIN/MAX read them
+        string text = RecordCodec::toString(*schema, bytes, field, inputColumns[input]);
+        if(totals.count == 0 || text < totals.minText) totals.minText = text;
+        if(totals.count == 0 || text > totals.maxText) totals.maxText = text;
+    }
+    totals.count++;
+}
+
+void AggregatePlan::resultColumns(vector<pair<string,string>> &columns) const{
+    for(size_t i = 0; i < calls.size(); i++){
+        const AggregateCall &call = calls[i];
+        string name = call.function + "(" + call.column + ")";
+        string type = "INT";
+
+        if(call.function == "AVG"){
+            type = "FLOAT";
+        }else if(call.function != "COUNT"){
+            ColumnType input = inputTypes[callInput[i]];
+            if(input == ColumnType::FLOAT) type = "FLOAT";
+            else if(input == ColumnType::BOOL) type = "BOOL";
+            else if(input == ColumnType::TEXT || input == ColumnType::DICT) type = "TEXT";
+        }
+        columns.push_back({name, type});
+    }
+}
+
+void AggregatePlan::resultValues(uint64_t rows, const AggregateTotals *totals, vector<string> &values, vector<bool> &nulls) const{
+    for(size_t i = 0; i < calls.size(); i++){
+        const AggregateCall &call = calls[i];
+
+        if(callInput[i] < 0 || call.function == "COUNT"){
+            values.push_back(to_string(callInput[i] < 0 ? rows : totals[callInput[i]].count));
+            nulls.push_back(false);
+            continue;
+        }
+
+        const AggregateTotals &input = totals[callInput[i]];
+        ColumnType type = inputTypes[callInput[i]];
+        bool isMin = call.function == "MIN";
+        string value;
+
+        if(call.function == "SUM"){
+            value = type == ColumnType::FLOAT ? floatText(input.sumFloat) : to_string(input.sumInt);
+        }else if(call.function == "AVG"){
+            double sum = type == ColumnType::FLOAT ? input.sumFloat : input.sumIntCarry * 18446744073709551616.0 + input.sumInt;
+            value = input.count ? floatText(sum / input.count) : "";
+        }else if(type == ColumnType::FLOAT){
+            value = floatText(isMin ? input.minFloat : input.maxFloat);
+        }else if(type == ColumnType::BOOL){
+            value = (isMin ? input.minInt : input.maxInt) ? "true" : "false";
+        }else if(type == ColumnType::INT){
+            value = to_string(isMin ? input.minInt : input.maxInt);
+        }else{
+            value = isMin ? input.minText : input.maxText;
+        }
+
+        //no values: SUM, AVG, MIN and MAX are NULL
+        values.push_back(input.count ? value : "");
+        nulls.push_back(input.count == 0);
+    }
+}
+
+/* ---------- Aggregator ---------- */
+
+/*
+  Batch folds. Each loop does one thing over a plain array so it stays
+  vectorizable; the float sum keeps 8 partial sums, a single running double
+  would force the adds into order.
+*/
+static void foldInts(const uint64_t *values, size_t n, AggregateTotals &totals){
+    uint64_t sum = 0;
+    uint64_t carry = 0;
+    uint64_t low = values[0];
+    uint64_t high = values[0];
+    for(size_t i = 0; i < n; i++){
+        sum += values[i];
+        carry += sum < values[i];
+    }
+    for(size_t i = 0; i < n; i++) low = values[i] < low ? values[i] : low;
+    for(size_t i = 0; i < n; i++) high = values[i] > high ? values[i] : high;
+
+    if(totals.count == 0 || low < totals.minInt) totals.minInt = low;
+    if(totals.count == 0 || high > totals.maxInt) totals.maxInt = high;
+    uint64_t before = totals.sumInt;
+    totals.sumInt += sum;
+    totals.sumIntCarry += carry + (totals.sumInt < before);
+    totals.count += n;
+}
+
+static void foldFloats(const float *values, size_t n, AggregateTotals &totals){
+    double lanes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    float low = values[0];
+    float high = values[0];
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        for(size_t lane = 0; lane < 8; lane++) lanes[lane] += values[i + lane];
+    }
+    for(; i < n; i++) lanes[0] += values[i];
+    for(size_t j = 0; j < n; j++) low = values[j] < low ? values[j] : low;
+    for(size_t j = 0; j < n; j++) high = values[j] > high ? values[j] : high;
+
+    if(totals.count == 0 || low < totals.minFloat) totals.minFloat = low;
+    if(totals.count == 0 || high > totals.maxFloat) totals.maxFloat = high;
+    for(double lane : lanes) totals.sumFloat += lane;
+    totals.count += n;
+}
+
+bool Aggregator::prepare(const vector<AggregateCall> &aggregateCalls, const vector<pair<string,string>> &tableColumns,
+                         const RecordCodec::Schema &tableSchema){
+    rows = 0;
+    if(!plan.prepare(aggregateCalls, tableColumns, tableSchema)) return false;
+
+    inputs.assign(plan.inputCount(), Input());
+    totals.assign(plan.inputCount(), AggregateTotals());
+    for(size_t i = 0; i < inputs.size(); i++){
+        if(plan.inputType(i) == ColumnType::FLOAT){
+            inputs[i].floats.resize(BATCH_ROWS);
+        }else if(isBatched(plan.inputType(i))){
+            inputs[i].ints.resize(BATCH_ROWS);
+        }
+    }
+    return true;
+}
+
+void Aggregator::flush(size_t input){
+    Input &batch = inputs[input];
+    if(batch.batched == 0) return;
+
+    if(plan.inputType(input) == ColumnType::FLOAT){
+        foldFloats(batch.floats.data(), batch.batched, totals[input]);
+    }else{
+        foldInts(batch.ints.data(), batch.batched, totals[input]);
+    }
+    batch.batched = 0;
+}
+
+void Aggregator::addRow(const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+    rows++;
+
+    for(size_t i = 0; i < inputs.size(); i++){
+        const RecordCodec::Field &field = fields[plan.inputColumn(i)];
+        if(field.isNull) continue;
+
+        ColumnType type = plan.inputType(i);
+        Input &batch = inputs[i];
+        if(type == ColumnType::FLOAT){
+            batch.floats[batch.batched++] = field.floatValue;
+        }else if(isBatched(type)){
+            batch.ints[batch.batched++] = field.intValue;
+        }else{
+            plan.addValue(i, bytes, field, totals[i]);
+            continue;
+        }
+        if(batch.batched == BATCH_ROWS) flush(i);
+    }
+}
+
+void Aggregator::merge(Aggregator &other){
+    for(size_t i = 0; i < inputs.size(); i++){
+        other.flush(i);
+        totals[i].merge(other.totals[i]);
+    }
+    rows += other.rows;
+}
+
+void Aggregator::result(vector<pair<string,string>> &columns, RecordCodec::Schema &resultSchema, vector<uint8_t> &record){
+    Trace::Span span("aggregate");
+    for(size_t i = 0; i < inputs.size(); i++) flush(i);
+
+    vector<string> values;
+    vector<bool> nulls;
+    columns.clear();
+    plan.resultColumns(columns);
+    plan.resultValues(rows, totals.data(), values, nulls);
+
+    resultSchema = RecordCodec::makeSchema(columns, RecordCodec::FORMAT_BITMAP);
+    record = RecordCodec::encode(resultSchema, values, nulls);
+}
+
+/* ---------- GroupAggregator ---------- */
+
+static atomic<size_t> memoryBudget{64 * 1024 * 1024};
+
+void GroupAggregator::setMemoryBudget(size_t bytes){
+    memoryBudget = bytes;
+}
+
+static void appendKeyPart(string &key, bool isNull, const string &text){
+    key.push_back(isNull ? 0 : 1);
+    if(isNull) return;
+
+    uint8_t length[Varint::MAX_BYTES];
+    size_t size = Varint::encodeTo(length, text.size());
+    key.append(reinterpret_cast<const char*>(length), size);
+    key += text;
+}
+
+static uint64_t keyHash(const string &key){
+    uint64_t hash = std::hash<string>{}(key);
+    //std::hash of a string is good, but spread the bits once more for the partition pick
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+static void writeVarint(FILE *file, uint64_t value){
+    uint8_t bytes[Varint::MAX_BYTES];
+    fwrite(bytes, 1, Varint::encodeTo(bytes, value), file);
+}
+
+static bool readVarint(FILE *file, uint64_t &value){
+    value = 0;
+    for(int shift = 0; shift < 64; shift += 7){
+        int c = fgetc(file);
+        if(c == EOF) return false;
+        value |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if((c & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+static void writeText(FILE *file, const string &text){
+    writeVarint(file, text.size());
+    fwrite(text.data(), 1, text.size(), file);
+}
+
+static bool readText(FILE *file, string &text){
+    uint64_t size = 0;
+    if(!readVarint(file, size)) return false;
+    text.resize(size);
+    return fread(&text[0], 1, size, file) == size;
+}
+
+template<typename T>
+static void writeValue(FILE *file, T value){
+    fwrite(&value, sizeof(T), 1, file);
+}
+
+template<typename T>
+static bool readValue(FILE *file, T &value){
+    return fread(&value, sizeof(T), 1, file) == 1;
+}
+
+GroupAggregator::~GroupAggregator(){
+    for(size_t p = 0; p < spillFiles.size(); p++){
+        if(spillFiles[p]) fclose(spillFiles[p]);
+        remove((spillBase + to_string(p)).c_str());
+    }
+}
+
+bool GroupAggregator::prepare(const string &table, const vector<string> &groupBy, const vector<string> &selectColumns,
+                              const vector<AggregateCall> &aggregateCalls, const vector<pair<string,string>> &tableColumns,
+                              const RecordCodec::Schema &tableSchema){
+    schema = &tableSchema;
+    if(!plan.prepare(aggregateCalls, tableColumns, tableSchema)) return false;
+    wantedColumns = plan.wanted();
+
+    groupColumns.clear();
+    groupColumnInfo.clear();
+    for(const string &name : groupBy){
+        int column = findColumnIndex(tableColumns, name);
+        if(column < 0){
+            cout << "[ERROR] Column " << name << " not found\n";
+            return false;
+        }
+        groupColumns.push_back(column);
+        wantedColumns[column] = true;
+
+        //DICT groups come out as their text
+        string type = tableColumns[column].second;
+        if(tableSchema.types[column] == ColumnType::DICT) type = "TEXT";
+        groupColumnInfo.push_back({name, type});
+    }
+
+    shownColumns.clear();
+    for(const string &name : selectColumns){
+        size_t position = 0;
+        while(position < groupBy.size() && groupBy[position] != name) position++;
+        if(position == groupBy.size()){
+            cout << "[ERROR] Column " << name << " must be in GROUP BY or inside an aggregate\n";
+            return false;
+        }
+        shownColumns.push_back(position);
+    }
+
+    //per thread, SELECTs on one table can run at the same time
+    spillBase = "data/" + table + "/" + table + ".spill-" + to_string(std::hash<thread::id>{}(this_thread::get_id())) + "-";
+    clearTable();
+    return true;
+}
+
+size_t GroupAggregator::memoryUsed() const{
+    return arenaBytes + textBytes + slots.size() * sizeof(Slot) + groups.size() * sizeof(Group) +
+           totals.size() * sizeof(AggregateTotals);
+}
+
+const char* GroupAggregator::keep(const string &key){
+    if(arena.empty() || arenaUsed + key.size() > ARENA_BLOCK){
+        size_t size = key.size() > ARENA_BLOCK ? key.size() : ARENA_BLOCK;
+        arena.emplace_back(new char[size]);
+        arenaUsed = 0;
+        arenaBytes += size;
+    }
+    char *copy = arena.back().get() + arenaUsed;
+    memcpy(copy, key.data(), key.size());
+    arenaUsed += key.size();
+    return copy;
+}
+
+void GroupAggregator::clearTable(){
+    slots.assign(64, Slot());
+    groups.clear();
+    totals.clear();
+    arena.clear();
+    arenaUsed = 0;
+    arenaBytes = 0;
+    textBytes = 0;
+}
+
+size_t GroupAggregator::findOrAdd(const string &key, uint64_t hash){
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while(slots[i].group){
+        const Group &group = groups[slots[i].group - 1];
+        if(slots[i].hash == hash && group.keyLength == key.size() && memcmp(group.key, key.data(), key.size()) == 0){
+            return slots[i].group - 1;
+        }
+        i = (i + 1) & mask;
+    }
+
+    if(!merging && !groups.empty() && memoryUsed() > memoryBudget){
+        spill();
+        return findOrAdd(key, hash);
+    }
+
+    Group group;
+    group.key = keep(key);
+    group.keyLength = key.size();
+    group.hash = hash;
+    groups.push_back(group);
+    totals.resize(totals.size() + plan.inputCount());
+    slots[i].hash = hash;
+    slots[i].group = groups.size();
+
+    //grow at half full, slots are cheap next to the groups
+    if(groups.size() * 2 > slots.size()){
+        vector<Slot> grown(slots.size() * 2);
+        size_t grownMask = grown.size() - 1;
+        for(const Slot &slot : slots){
+            if(!slot.group) continue;
+            size_t j = slot.hash & grownMask;
+            while(grown[j].group) j = (j + 1) & grownMask;
+            grown[j] = slot;
+        }
+        slots.swap(grown);
+    }
+    return groups.size() - 1;
+}
+
+void GroupAggregator::addRow(const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+    static thread_local string key;
+    key.clear();
+    for(int column : groupColumns){
+        const RecordCodec::Field &field = fields[column];
+        appendKeyPart(key, field.isNull, field.isNull ? "" : RecordCodec::toString(*schema, bytes, field, column));
+    }
+
+    size_t group = findOrAdd(key, keyHash(key));
+    groups[group].rows++;
+
+    size_t inputs = plan.inputCount();
+    for(size_t i = 0; i < inputs; i++){
+        AggregateTotals &input = totals[group * inputs + i];
+        size_t textBefore = input.minText.size() + input.maxText.size();
+        plan.addValue(i, bytes, fields[plan.inputColumn(i)], input);
+        textBytes += input.minText.size() + input.maxText.size() - textBefore;
+    }
+}
+
+void GroupAggregator::addGroup(bool isNull, const string &text, uint64_t rows){
+    string key;
+    appendKeyPart(key, isNull, text);
+    groups[findOrAdd(key, keyHash(key))].rows += rows;
+}
+
+/*
+  Spill entry: [varint key length][key][varint rows], per input
+  [count][sumInt][sumIntCarry][minInt][maxInt][sumFloat][minFloat][maxFloat] raw,
+  then minText and maxText as varint length + bytes.
+*/
+void GroupAggregator::spill(){
+    Trace::Span span("aggregate_spill");
+
+    if(spillFiles.empty()){
+        for(size_t p = 0; p < SPILL_PARTITIONS; p++){
+            FILE *file = fopen((spillBase + to_string(p)).c_str(), "w+b");
+            if(!file){
+                cerr << "ERROR opening spill file, GROUP BY stays in memory" << endl;
+                for(FILE *opened : spillFiles) fclose(opened);
+                spillFiles.clear();
+                merging = true;
+                return;
+            }
+            spillFiles.push_back(file);
+        }
+    }
+
+    size_t inputs = plan.inputCount();
+    for(size_t g = 0; g < groups.size(); g++){
+        FILE *file = spillFiles[(groups[g].hash >> 60) % SPILL_PARTITIONS];
+        writeVarint(file, groups[g].keyLength);
+        fwrite(groups[g].key, 1, groups[g].keyLength, file);
+        writeVarint(file, groups[g].rows);
+
+        for(size_t i = 0; i < inputs; i++){
+            const AggregateTotals &input = totals[g * inputs + i];
+            writeValue(file, input.count);
+            writeValue(file, input.sumInt);
+            writeValue(file, input.sumIntCarry);
+            writeValue(file, input.minInt);
+            writeValue(file, input.maxInt);
+            writeValue(file, input.sumFloat);
+            writeValue(file, input.minFloat);
+            writeValue(file, input.maxFloat);
+            writeText(file, input.minText);
+            writeText(file, input.maxText);
+        }
+    }
+    //fwrite keeps its errors in the stream, a full disk shows up here at the latest
+    for(FILE *file : spillFiles){
+        if(fflush(file) != 0 || ferror(file)){
+            if(!spillFailed) cerr << "ERROR writing GROUP BY spill file" << endl;
+            spillFailed = true;
+        }
+    }
+    spilledGroups += groups.size();
+    clearTable();
+}
+
+bool GroupAggregator::mergePartition(size_t partition){
+    FILE *file = spillFiles[partition];
+    rewind(file);
+
+    size_t inputs = plan.inputCount();
+    string key;
+    AggregateTotals input;
+    uint64_t rows = 0;
+    while(true){
+        //only the end of the file may stop the loop, a cut entry is an error
+        int next = fgetc(file);
+        if(next == EOF) return !ferror(file);
+        ungetc(next, file);
+        if(!readText(file, key) || !readVarint(file, rows)) return false;
+
+        size_t group = findOrAdd(key, keyHash(key));
+        groups[group].rows += rows;
+        for(size_t i = 0; i < inputs; i++){
+            if(!readValue(file, input.count) || !readValue(file, input.sumInt) || !readValue(file, input.sumIntCarry) ||
+               !readValue(file, input.minInt) || !readValue(file, input.maxInt) || !readValue(file, input.sumFloat) ||
+               !readValue(file, input.minFloat) || !readValue(file, input.maxFloat) ||
+               !readText(file, input.minText) || !readText(file, input.maxText)){
+                return false;
+            }
+            totals[group * inputs + i].merge(input);
+        }
+    }
+}
+
+void GroupAggregator::emitGroups(const RecordCodec::Schema &resultSchema, const function<void(vector<uint8_t> &record)> &row){
+    size_t inputs = plan.inputCount();
+    vector<string> keyValues(groupColumns.size());
+    vector<bool> keyNulls(groupColumns.size());
+    vector<string> values;
+    vector<bool> nulls;
+    vector<uint8_t> record;
+
+    for(size_t g = 0; g < groups.size(); g++){
+        const uint8_t *pos = reinterpret_cast<const uint8_t*>(groups[g].key);
+        const uint8_t *end = pos + groups[g].keyLength;
+        for(size_t c = 0; c < groupColumns.size(); c++){
+            keyNulls[c] = *pos++ == 0;
+            keyValues[c].clear();
+            if(keyNulls[c]) continue;
+
+            size_t readBytes = 0;
+            uint64_t length = Varint::decode(pos, end, readBytes);
+            pos += readBytes;
+            keyValues[c].assign(reinterpret_cast<const char*>(pos), length);
+            pos += length;
+        }
+
+        values.clear();
+        nulls.clear();
+        for(size_t shown : shownColumns){
+            values.push_back(keyValues[shown]);
+            nulls.push_back(keyNulls[shown]);
+        }
+        plan.resultValues(groups[g].rows, totals.data() + g * inputs, values, nulls);
+        record = RecordCodec::encode(resultSchema, values, nulls);
+        row(record);
+    }
+}
+
+void GroupAggregator::resultColumns(vector<pair<string,string>> &columns, RecordCodec::Schema &resultSchema) const{
+    columns.clear();
+    for(size_t shown : shownColumns) columns.push_back(groupColumnInfo[shown]);
+    plan.resultColumns(columns);
+    resultSchema = RecordCodec::makeSchema(columns, RecordCodec::FORMAT_BITMAP);
+}
+
+bool GroupAggregator::result(const RecordCodec::Schema &resultSchema, const function<void(vector<uint8_t> &record)> &row){
+    Trace::Span span("aggregate");
+
+    if(spillFiles.empty()){
+        emitGroups(resultSchema, row);
+        return true;
+    }
+
+    //the groups still in memory join their partitions, then one partition at a time
+    spill();
+    merging = true;
+    for(size_t p = 0; p < spillFiles.size() && !spillFailed; p++){
+        if(!mergePartition(p)){
+            cerr << "ERROR reading GROUP BY spill file" << endl;
+            spillFailed = true;
+            break;
+        }
+        emitGroups(resultSchema, row);
+        clearTable();
+    }
+    //some groups would come out short or not at all
+    if(spillFailed){
+        cout << "[ERROR] GROUP BY could not write or read back its spill files, query aborted\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <functional>
+#include "parser.h"
+#include "record_codec.h"
+
+/*
+  COUNT, SUM, AVG, MIN and MAX of one SELECT.
+
+  Without GROUP BY rows are not folded one by one: Aggregator copies the non
+  NULL values of each INT, BOOL and FLOAT input into a batch of BATCH_ROWS
+  plain arrays, and a full batch is folded by short loops without branches,
+  which the compiler vectorizes at -O2. TEXT and DICT values (MIN/MAX only)
+  compare as text row by row.
+
+  GROUP BY goes through GroupAggregator, a hash aggregation (see below).
+*/
+
+//running totals of one input column
+struct AggregateTotals{
+    uint64_t count = 0;          //non NULL values
+    uint64_t sumInt = 0, minInt = 0, maxInt = 0;   //INT is unsigned like in the records, SUM wraps
+    uint64_t sumIntCarry = 0;    //times sumInt wrapped, AVG adds them back
+    double sumFloat = 0.0;
+    float minFloat = 0.0f, maxFloat = 0.0f;
+    std::string minText, maxText;
+
+    void merge(const AggregateTotals &other);
+};
+
+//the calls of one SELECT resolved against the table
+class AggregatePlan{
+    private:
+        std::vector<AggregateCall> calls;
+        std::vector<int> callInput;       //index into inputColumns, -1 for COUNT(*)
+        std::vector<int> inputColumns;
+        std::vector<RecordCodec::ColumnType> inputTypes;
+        std::vector<bool> wantedColumns;
+        const RecordCodec::Schema *schema = nullptr;
+
+    public:
+        //false (and prints the error) for an unknown column or SUM/AVG of a non number
+        bool prepare(const std::vector<AggregateCall> &aggregateCalls, const std::vector<std::pair<std::string,std::string>> &tableColumns,
+                     const RecordCodec::Schema &tableSchema);
+
+        //columns the calls read, for decode and FileManager::scanColumns
+        const std::vector<bool>& wanted() const { return wantedColumns; }
+        size_t inputCount() const { return inputColumns.size(); }
+        int inputColumn(size_t input) const { return inputColumns[input]; }
+        RecordCodec::ColumnType inputType(size_t input) const { return inputTypes[input]; }
+        //every call is COUNT(*), rows can be counted without decoding anything
+        bool countOnly() const { return inputColumns.empty(); }
+
+        //fold one row's value of an input into totals, row by row
+        void addValue(size_t input, const std::vector<uint8_t> &bytes, const RecordCodec::Field &field, AggregateTotals &totals) const;
+
+        //name and type of every call's result column
+        void resultColumns(std::vector<std::pair<std::string,std::string>> &columns) const;
+        //result of every call for rows rows with the given totals (one per input), as text for RecordCodec::encode
+        void resultValues(uint64_t rows, const AggregateTotals *totals, std::vector<std::string> &values, std::vector<bool> &nulls) const;
+};
+
+class Aggregator{
+    private:
+        struct Input{
+            std::vector<uint64_t> ints;   //current batch, INT and BOOL
+            std::vector<float> floats;    //current batch, FLOAT
+            size_t batched = 0;
+        };
+
+        AggregatePlan plan;
+        std::vector<Input> inputs;
+        std::vector<AggregateTotals> totals;   //one per input
+        uint64_t rows = 0;
+
+        void flush(size_t input);
+
+    public:
+        static const size_t BATCH_ROWS = 1024;
+
+        bool prepare(const std::vector<AggregateCall> &aggregateCalls, const std::vector<std::pair<std::string,std::string>> &tableColumns,
+                     const RecordCodec::Schema &tableSchema);
+
+        const std::vector<bool>& wanted() const { return plan.wanted(); }
+        bool countOnly() const { return plan.countOnly(); }
+
+        void addRow(const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &fields);
+        //rows counted elsewhere (row count metadata, index hits), countOnly() queries only
+        void addRows(uint64_t count){ rows += count; }
+        //add the rows of another aggregator of the same calls (a parallel scan worker)
+        void merge(Aggregator &other);
+
+        //the single result row: name/type per call and the row as a format 2 record
+        void result(std::vector<std::pair<std::string,std::string>> &columns, RecordCodec::Schema &resultSchema,
+                    std::vector<uint8_t> &record);
+};
+
+/*
+  Hash aggregation for GROUP BY.
+
+  The group key is the text of the GROUP BY columns ([0] for NULL, or [1]
+  [varint length][text] per column), copied once into an arena of 64 KB
+  blocks. Groups are found through an open addressing table of
+  (hash, group) slots with linear probing, kept at most half full.
+
+  When the table, arena and totals pass the memory budget, every group is
+  written as a partial result to one of SPILL_PARTITIONS files by its hash,
+  and the table starts empty. At the end the in-memory groups are spilled
+  too and each partition is merged on its own, so a partition holds about
+  1/SPILL_PARTITIONS of the groups.
+*/
+class GroupAggregator{
+    private:
+        struct Slot{
+            uint64_t hash = 0;
+            uint32_t group = 0;     //group + 1, 0 is an empty slot
+        };
+        struct Group{
+            const char *key = nullptr;
+            uint32_t keyLength = 0;
+            uint64_t hash = 0;
+            uint64_t rows = 0;
+        };
+
+        AggregatePlan plan;
+        std::vector<int> groupColumns;      //table positions of the GROUP BY columns
+        std::vector<size_t> shownColumns;   //GROUP BY columns listed in SELECT, as positions in groupColumns
+        std::vector<std::pair<std::string,std::string>> groupColumnInfo;
+        std::vector<bool> wantedColumns;
+        const RecordCodec::Schema *schema = nullptr;
+        std::string spillBase;
+
+        std::vector<Slot> slots;
+        std::vector<Group> groups;
+        std::vector<AggregateTotals> totals;   //inputCount() per group
+        std::vector<std::unique_ptr<char[]>> arena;
+        size_t arenaUsed = 0;                  //bytes used in the last arena block
+        size_t arenaBytes = 0;
+        size_t textBytes = 0;                  //MIN/MAX text held by totals
+
+        std::vector<FILE*> spillFiles;
+        uint64_t spilledGroups = 0;
+        bool merging = false;                  //no spilling while a partition is read back
+        bool spillFailed = false;              //groups lost on the way to or from disk
+
+        size_t memoryUsed() const;
+        const char* keep(const std::string &key);
+        size_t findOrAdd(const std::string &key, uint64_t hash);
+        void clearTable();
+        void spill();
+        bool mergePartition(size_t partition);
+        void emitGroups(const RecordCodec::Schema &resultSchema, const std::function<void(std::vector<uint8_t> &record)> &row);
+
+    public:
+        static const size_t ARENA_BLOCK = 64 * 1024;
+        static const size_t SPILL_PARTITIONS = 16;
+
+        //bytes of groups kept in memory before spilling, shared by every query
+        static void setMemoryBudget(size_t bytes);
+
+        ~GroupAggregator();
+
+        //false (and prints the error) for an unknown column or a SELECT column not in GROUP BY
+        bool prepare(const std::string &table, const std::vector<std::string> &groupBy, const std::vector<std::string> &selectColumns,
+                     const std::vector<AggregateCall> &aggregateCalls, const std::vector<std::pair<std::string,std::string>> &tableColumns,
+                     const RecordCodec::Schema &tableSchema);
+
+        //group and aggregate columns
+        const std::vector<bool>& wanted() const { return wantedColumns; }
+        bool countOnly() const { return plan.countOnly(); }
+
+        void addRow(const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &fields);
+        //a whole group counted elsewhere (hash index lists), one GROUP BY column and countOnly() only;
+        //isNull for the rows without a value
+        void addGroup(bool isNull, const std::string &text, uint64_t rows);
+
+        uint64_t spilled() const { return spilledGroups; }
+
+        //result columns: shown GROUP BY columns, then the calls
+        void resultColumns(std::vector<std::pair<std::string,std::string>> &columns, RecordCodec::Schema &resultSchema) const;
+        //one row per group, handed over as each spill partition is merged, so only one partition is held;
+        //false (and prints the error) when spilled groups could not be written or read back,
+        //the rows of the partitions before that were handed over already
+        bool result(const RecordCodec::Schema &resultSchema, const std::function<void(std::vector<uint8_t> &record)> &row);
+};
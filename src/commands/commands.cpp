@@ -5,7 +5,15 @@
 #include "select.h"
 #include "delete.h"
 #include "update.h"
+#include "stats.h"
+#include "seal.h"
 #include "utils.h"
+#include "result_set.h"
+#include "metrics.h"
+#include "trace.h"
+#include "dictionary.h"
+#include "segment_store.h"
+#include "zone_map.h"
 #include <iostream>
 
 
@@ -14,6 +22,9 @@ using namespace Commands;
 //default mode
 static IndexMode globalMode = IndexMode::HASH;
 
+//null means print rows to stdout like before
+static thread_local ResultSet* resultCapture = nullptr;
+
 void Commands::setIndexMode(IndexMode type){
     globalMode = type;
 }
@@ -22,6 +33,22 @@ IndexMode Commands::getIndexMode(){
     return globalMode;
 }
 
+void Commands::setResultCapture(ResultSet *result){
+    resultCapture = result;
+}
+
+ResultSet* Commands::getResultCapture(){
+    return resultCapture;
+}
+
+//every client thread keeps its own loaded copies, bounded by IndexFileStamp's limits
+static void releaseThreadCaches(){
+    releaseSelectIndexes();
+    Dictionary::trimThreadCache();
+    ZoneMap::trimThreadCache();
+    SegmentStore::trimThreadCache();
+}
+
 void Commands::initIndex(){};//later need
 void Commands::execute(const ParsedCommand &cmd){
 
@@ -29,12 +56,22 @@ void Commands::execute(const ParsedCommand &cmd){
         std::cout << "Invalid Command\n";
         return;
     }
-    if(cmd.type == "CREATE") return createCmdExecute(cmd);
-    if(cmd.type == "INSERT") return insertCmdExecute(cmd,globalMode);
-    if(cmd.type == "SHOW") return showCmdExecute(cmd);
-    if(cmd.type == "SELECT") return selectCmdExecute(cmd, globalMode);
-    if(cmd.type == "DELETE") return deleteCmdExecute(cmd, globalMode);
-    if(cmd.type == "UPDATE") return updateCmdExecute(cmd, globalMode);
-
-    std::cout << "Not found this command\n";
+
+    uint64_t startUs = Trace::nowMicros();
+
+    if(cmd.type == "CREATE") createCmdExecute(cmd);
+    else if(cmd.type == "INSERT") insertCmdExecute(cmd,globalMode);
+    else if(cmd.type == "SHOW") showCmdExecute(cmd);
+    else if(cmd.type == "SELECT") selectCmdExecute(cmd, globalMode);
+    else if(cmd.type == "DELETE") deleteCmdExecute(cmd, globalMode);
+    else if(cmd.type == "UPDATE") updateCmdExecute(cmd, globalMode);
+    else if(cmd.type == "STATS") statsCmdExecute(cmd);
+    else if(cmd.type == "SEAL") sealCmdExecute(cmd);
+    else{
+        std::cout << "Not found this command\n";
+        return;
+    }
+    releaseThreadCaches();
+
+    Metrics::recordQuery(Metrics::statementFromType(cmd.type), Trace::nowMicros() - startUs);
 }
\ No newline at end of file
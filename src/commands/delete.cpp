@@ -1,70 +1,28 @@
 #include "delete.h"
 #include "file_manager.h"
 #include "utils.h"
-#include "varint.h"
+#include "record_codec.h"
 #include "hash_index.h"
 #include "bplusTree_index.h"
+#include "trace.h"
 #include <iostream>
-#include <cstring>
+#include <algorithm>
 
 using namespace std;
 
 static HashIndex globalHashDelete;
 static BPlusTreeIndex globalBPTreeDelete;
 
-static vector<string> decodeRecordValues(const vector<uint8_t> &recordData, const vector<pair<string,string>> &metaInfo){
-    vector<string> values;
-    size_t pos = 0;
-    
-    for (auto &col : metaInfo) {
-        if (pos >= recordData.size()) { 
-            values.push_back("");
-            continue; 
-        }
-        
-        char flagType = recordData[pos++];
-        
-        if (flagType == 'I') {
-            size_t r = 0;
-            uint64_t intValue = Varint::decode(recordData, pos, r);
-            pos += r;
-            values.push_back(to_string(intValue));
-        } else if (flagType == 'F') {
-            float floatValue = 0.0f;
-            if (pos + 4 <= recordData.size()) {
-                memcpy(&floatValue, recordData.data() + pos, 4);
-                pos += 4;   
-            }
-            values.push_back(to_string(floatValue));
-        } else if (flagType == 'B') {
-            uint8_t boolValue = recordData[pos++]; 
-            values.push_back(boolValue ? "true" : "false");
-        } else if (flagType == 'S') {
-            size_t r = 0;
-            uint64_t strLength = Varint::decode(recordData, pos, r);
-            pos += r;
-            string strValue;
-            if (pos + strLength <= recordData.size()) {
-                strValue.assign((char*)(recordData.data() + pos), strLength);
-            }
-            pos += strLength;
-            values.push_back(strValue);
-        } else {
-            values.push_back("");
-        }
-    }
-    
-    return values;
-}
-
 void deleteCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode){
     vector<pair<string,string>> metaInfo;
     string primaryColName;
+    int format = RecordCodec::FORMAT_TAGGED;
 
-    if(!FileManager::readMeta(cmd.table, metaInfo, primaryColName)){
+    if(!FileManager::readMeta(cmd.table, metaInfo, primaryColName, format)){
         cout << "[ERROR] Table not found: " << cmd.table << "\n";
         return;
     }
+    auto schema = RecordCodec::makeSchema(metaInfo, format, cmd.table);
 
     if(mode == Commands::IndexMode::HASH){
         globalHashDelete.loadFromDisk(cmd.table);
@@ -78,8 +36,11 @@ void deleteCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode){
     if(cmd.op == "="){
         cout << "[INFO] Deleting records where " << cmd.whereColumn << " = " << cmd.whereValue1 << "\n";
         
-        if(mode == Commands::IndexMode::HASH){
-            offsetsToDelete = globalHashDelete.findRecord(cmd.whereColumn, cmd.whereValue1);
+        //a DICT value the column never held matches nothing
+        string whereKey;
+        bool known = indexValue(schema, findColumnIndex(metaInfo, cmd.whereColumn), mode, cmd.whereValue1, whereKey);
+        if(known && mode == Commands::IndexMode::HASH){
+            offsetsToDelete = globalHashDelete.findRecord(cmd.whereColumn, whereKey);
         } else if(mode == Commands::IndexMode::BPLUSTREE){
             string key = cmd.whereColumn + "##" + cmd.whereValue1;
             offsetsToDelete = globalBPTreeDelete.search(key);
@@ -111,19 +72,30 @@ void deleteCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode){
     // 2. Mark the record as deleted in the data file
     // 3. Remove from all index entries
 
+    //file order, so the reads merge; and an offset listed twice is deleted once
+    sort(offsetsToDelete.begin(), offsetsToDelete.end());
+    offsetsToDelete.erase(unique(offsetsToDelete.begin(), offsetsToDelete.end()), offsetsToDelete.end());
+
     int deletedCount = 0;
-    for(auto offset : offsetsToDelete){
-        auto recordData = FileManager::readRecord(cmd.table, offset);
+    Trace::StageTotal decodeTime("decode");
+    FileManager::readRecords(cmd.table, offsetsToDelete, [&](size_t index, const vector<uint8_t> &recordData){
+        uint64_t offset = offsetsToDelete[index];
         if(recordData.empty()){
-            continue;
+            return;
         }
 
-        vector<string> recordValues = decodeRecordValues(recordData, metaInfo);
+        vector<string> recordValues;
+        vector<bool> recordNulls;
+        decodeTime.begin();
+        RecordCodec::decodeValues(schema, recordData, recordValues, recordNulls);
+        decodeTime.end();
         FileManager::markDeleted(cmd.table, offset);
         
         for(size_t i = 0; i < metaInfo.size() && i < recordValues.size(); i++){
+            if(recordNulls[i]) continue;   //NULLs were never indexed
             string colName = metaInfo[i].first;
-            string colValue = recordValues[i];
+            string colValue;
+            if(!indexValue(schema, i, mode, recordValues[i], colValue)) continue;
             
             if(mode == Commands::IndexMode::HASH){
                 globalHashDelete.deleteRecord(colName, colValue, offset);
@@ -134,7 +106,7 @@ void deleteCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode){
         }
         
         deletedCount++;
-    }
+    });
 
     if(mode == Commands::IndexMode::HASH){
         globalHashDelete.saveToDisk(cmd.table);
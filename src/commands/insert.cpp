@@ -1,86 +1,25 @@
 #include "insert.h"
 #include "file_manager.h"
-#include "varint.h"
+#include "record_codec.h"
+#include "utils.h"
 #include "hash_index.h"
 #include "bplusTree_index.h"
-#include <cstring>
 #include <iostream>
 
 static HashIndex globalHash;
 static BPlusTreeIndex globalBPTree;
 
-static std::vector<uint8_t> encodeRecord(
-    const std::vector<std::pair<std::string,std::string>> &metaInfo,const std::vector<std::string> &metaValues)
-{
-    std::vector<uint8_t> bufferSpace;
-
-    for (int i = 0; i < metaInfo.size(); i++)
-    {
-        std::string dataType = metaInfo[i].second;
-        for ( auto &c : dataType)
-        {
-            c = toupper(c);
-        }
-
-        std::string metaValue;
-        if(i < metaValues.size()){
-            metaValue = metaValues[i];
-        }else{
-            metaValue = "";
-        }
-
-        if(dataType == "INT"){
-            bufferSpace.push_back('I');//flag for integer
-            uint64_t intValue = 0;
-
-            try{
-                if(!metaValue.empty()){
-                    intValue = std::stoull(metaValue);
-                }
-            }catch(...){}
-
-            auto varInt = Varint::encode(intValue);
-            bufferSpace.insert(bufferSpace.end(),varInt.begin(),varInt.end());
-            
-        }else if(dataType == "FLOAT"){
-            bufferSpace.push_back('F');
-            float floatValue = 0.0f;
-
-            try{
-                if(!metaValue.empty()){
-                    floatValue = std::stof(metaValue);
-                }
-            }catch(...){}
-
-            uint8_t temp[4];//binary for float value;
-            memcpy(temp,&floatValue,4);
-
-            bufferSpace.insert(bufferSpace.end(),temp,temp+4);
-
-        }else if(dataType == "BOOL"){
-            bufferSpace.push_back('B');
-            bufferSpace.push_back((metaValue == "true" || metaValue == "1") ? 1 : 0);
-        }else{
-            bufferSpace.push_back('S');
-
-            std::uint64_t strLength = metaValue.size();
-            auto strLenBin = Varint::encode(strLength);
-            bufferSpace.insert(bufferSpace.end(),strLenBin.begin(),strLenBin.end());
-
-            bufferSpace.insert(bufferSpace.end(),metaValue.begin(),metaValue.end());
-
-        }
-        
-    }
-    return bufferSpace;
+static bool valueIsNull(const ParsedCommand &cmd, size_t i){
+    return i < cmd.nullValues.size() && cmd.nullValues[i];
 }
 
 void insertCmdExecute(const ParsedCommand &cmd,Commands::IndexMode mode){
 
     std::vector<std::pair<std::string,std::string>> metaInfo;
     std::string primaryColName;
+    int format = RecordCodec::FORMAT_TAGGED;
 
-    if(!FileManager::readMeta(cmd.table,metaInfo,primaryColName)){
+    if(!FileManager::readMeta(cmd.table,metaInfo,primaryColName,format)){
         std::cout << "error to read meta(table not found)\n";
         return;
     }
@@ -90,7 +29,18 @@ void insertCmdExecute(const ParsedCommand &cmd,Commands::IndexMode mode){
         return;
     }
 
+    if(format == RecordCodec::FORMAT_TAGGED){
+        for(size_t i = 0; i < cmd.values.size(); i++){
+            if(valueIsNull(cmd, i)){
+                std::cout << "[ERROR] Table " << cmd.table << " uses record format 1, which has no NULL\n";
+                return;
+            }
+        }
+    }
+
     
+    auto schema = RecordCodec::makeSchema(metaInfo, format, cmd.table);
+
     if(mode == Commands::IndexMode::HASH){
         globalHash.loadFromDisk(cmd.table);
     }else if(mode == Commands::IndexMode::BPLUSTREE){
@@ -107,12 +57,20 @@ void insertCmdExecute(const ParsedCommand &cmd,Commands::IndexMode mode){
             }
         }
 
+        if(primaryIdx >= 0 && valueIsNull(cmd, primaryIdx)){
+            std::cout << "[ERROR] Primary key " << primaryColName << " cannot be NULL\n";
+            return;
+        }
+
         if(primaryIdx >= 0 && primaryIdx < cmd.values.size()){
             std::string primaryKeyValue = cmd.values[primaryIdx];
+            std::string primaryKey;
             
+            //a DICT value not seen before cannot be a duplicate
             std::vector<uint64_t> checkExist;
-            if(mode == Commands::IndexMode::HASH){
-                checkExist = globalHash.findRecord(primaryColName, primaryKeyValue);
+            bool known = indexValue(schema, primaryIdx, mode, primaryKeyValue, primaryKey);
+            if(known && mode == Commands::IndexMode::HASH){
+                checkExist = globalHash.findRecord(primaryColName, primaryKey);
             }else if(mode == Commands::IndexMode::BPLUSTREE){
                 // For B+Tree, create key: "columnName##value"
                 std::string key = primaryColName + "##" + primaryKeyValue;
@@ -126,14 +84,20 @@ void insertCmdExecute(const ParsedCommand &cmd,Commands::IndexMode mode){
         }
     }
 
-    auto buffer = encodeRecord(metaInfo,cmd.values);
+    std::vector<uint8_t> buffer;
+    if(!RecordCodec::encode(schema, cmd.values, cmd.nullValues, buffer)){
+        std::cout << "[ERROR] Cannot write the dictionary of a DICT column, row not inserted\n";
+        return;
+    }
     uint64_t offset = FileManager::appendRecord(cmd.table,buffer);
 
-    //update index
+    //update index, NULL never matches a WHERE so it is not indexed
     for(size_t i=0;i<metaInfo.size();i++){
+        if(valueIsNull(cmd, i)) continue;
         std::string colName = metaInfo[i].first;
         std::string colType = metaInfo[i].second;
-        std::string colValue = cmd.values[i];
+        std::string colValue;
+        indexValue(schema, i, mode, cmd.values[i], colValue);   //encode gave DICT values a code
 
         if(mode == Commands::IndexMode::HASH){
             globalHash.addRecord(colName,colValue,offset);
@@ -0,0 +1,257 @@
+#include "join.h"
+#include "file_manager.h"
+#include "hash_index.h"
+#include "utils.h"
+#include "query_stats.h"
+#include "trace.h"
+#include <iostream>
+#include <atomic>
+#include <unordered_map>
+
+using namespace std;
+using RecordCodec::ColumnType;
+
+static atomic<size_t> memoryBudget{64 * 1024 * 1024};
+static const uint64_t INDEX_JOIN_RATIO = 8;
+
+//probe side index, per thread like the SELECT indexes
+static thread_local HashIndex joinIndex;
+
+void Join::setMemoryBudget(size_t bytes){
+    memoryBudget = bytes;
+}
+
+void Join::releaseIndex(){
+    joinIndex.releaseUnlessKept();
+}
+
+bool Join::loadSide(int side, const string &table, const string &column){
+    Side &s = sides[side];
+    s.table = table;
+
+    string primaryColName;
+    int format = RecordCodec::FORMAT_TAGGED;
+    if(!FileManager::readMeta(table, s.metaInfo, primaryColName, format)){
+        cout << "[ERROR] Table " << table << " not found\n";
+        return false;
+    }
+    s.schema = RecordCodec::makeSchema(s.metaInfo, format, table);
+
+    s.column = findColumnIndex(s.metaInfo, column);
+    if(s.column < 0){
+        cout << "[ERROR] Column " << table << "." << column << " not found\n";
+        return false;
+    }
+    s.wanted.assign(s.metaInfo.size(), false);
+    s.wanted[s.column] = true;
+    s.rowsKnown = FileManager::countRecords(table, s.rows);
+    return true;
+}
+
+//"table.column", or a bare column found in exactly one table
+bool Join::addColumn(const string &name){
+    int side = -1;
+    int column = -1;
+
+    size_t dot = name.find('.');
+    if(dot != string::npos){
+        string table = name.substr(0, dot);
+        for(int i = 0; i < 2; i++){
+            if(sides[i].table == table) side = i;
+        }
+        if(side >= 0) column = findColumnIndex(sides[side].metaInfo, name.substr(dot + 1));
+    }else{
+        for(int i = 0; i < 2; i++){
+            int found = findColumnIndex(sides[i].metaInfo, name);
+            if(found < 0) continue;
+            if(side >= 0){
+                cout << "[ERROR] Column " << name << " is in both tables, write it as table.column\n";
+                return false;
+            }
+            side = i;
+            column = found;
+        }
+    }
+    if(side < 0 || column < 0){
+        cout << "[ERROR] Column " << name << " not found\n";
+        return false;
+    }
+
+    Side &s = sides[side];
+    s.wanted[column] = true;
+    output.push_back({side, s.shown.size()});
+    s.shown.push_back(column);
+
+    //DICT values come out as their text
+    string type = s.metaInfo[column].second;
+    if(s.schema.types[column] == ColumnType::DICT) type = "TEXT";
+    columnInfo.push_back({s.table + "." + s.metaInfo[column].first, type});
+    return true;
+}
+
+bool Join::prepare(const ParsedCommand &cmd){
+    if(cmd.table == cmd.joinTable){
+        cout << "[ERROR] JOIN of a table with itself is not supported\n";
+        return false;
+    }
+    if(!loadSide(0, cmd.table, cmd.joinLeftColumn) || !loadSide(1, cmd.joinTable, cmd.joinRightColumn)) return false;
+
+    output.clear();
+    columnInfo.clear();
+    if(cmd.selectColumns.empty()){
+        for(int side = 0; side < 2; side++){
+            for(auto &column : sides[side].metaInfo){
+                addColumn(sides[side].table + "." + column.first);
+            }
+        }
+    }else{
+        for(const string &name : cmd.selectColumns){
+            if(!addColumn(name)) return false;
+        }
+    }
+    resultSchema = RecordCodec::makeSchema(columnInfo, RecordCodec::FORMAT_BITMAP);
+
+    //hash the smaller table, the JOIN table when counts are missing
+    build = 1;
+    if(sides[0].rowsKnown && sides[1].rowsKnown && sides[0].rows < sides[1].rows) build = 0;
+    return true;
+}
+
+void Join::rowValues(const Side &side, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields, RowValues &row) const{
+    row.values.assign(side.shown.size(), "");
+    row.nulls.assign(side.shown.size(), false);
+    for(size_t k = 0; k < side.shown.size(); k++){
+        const RecordCodec::Field &field = fields[side.shown[k]];
+        if(field.isNull){
+            row.nulls[k] = true;
+        }else{
+            row.values[k] = RecordCodec::toString(side.schema, bytes, field, side.shown[k]);
+        }
+    }
+}
+
+void Join::emit(const RowValues &buildRow, const RowValues &probeRow){
+    vector<string> values(output.size());
+    vector<bool> nulls(output.size(), false);
+    for(size_t i = 0; i < output.size(); i++){
+        const RowValues &row = output[i].first == build ? buildRow : probeRow;
+        values[i] = row.values[output[i].second];
+        nulls[i] = row.nulls[output[i].second];
+    }
+    vector<uint8_t> record = RecordCodec::encode(resultSchema, values, nulls);
+    stopped = !rowSink(record);
+}
+
+/*
+  Index nested loop join: scan the build table, probe the other one's hash
+  index with each value. False when the probe column has no index or the
+  lookups would read about as much as a scan, nothing emitted then.
+*/
+bool Join::indexJoin(){
+    const Side &outer = sides[build];
+    const Side &inner = sides[1 - build];
+    ColumnType type = inner.schema.types[inner.column];
+    if(type != ColumnType::INT && type != ColumnType::TEXT && type != ColumnType::DICT) return false;
+
+    joinIndex.loadFromDisk(inner.table);
+    auto values = joinIndex.idx.find(inner.metaInfo[inner.column].first);
+    if(values == joinIndex.idx.end()) return false;
+
+    //about rows/distinct records per lookup, random reads cost some 8 scanned rows
+    if(!outer.rowsKnown || outer.rows * INDEX_JOIN_RATIO >= values->second.size()) return false;
+
+    QueryStats::usePlan("index nested loop join");
+    RowValues outerRow, innerRow;
+    vector<RecordCodec::Field> innerFields;
+
+    FileManager::scanColumns(outer.table, outer.schema, outer.wanted,
+        [&](uint64_t, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+            const RecordCodec::Field &key = fields[outer.column];
+            if(key.isNull || stopped) return;
+
+            //a DICT value the probe column never held matches nothing
+            string indexKey;
+            string text = RecordCodec::toString(outer.schema, bytes, key, outer.column);
+            if(!indexValue(inner.schema, inner.column, Commands::IndexMode::HASH, text, indexKey)) return;
+
+            QueryStats::addIndexEntries(1);
+            auto matches = values->second.find(indexKey);
+            if(matches == values->second.end()) return;
+
+            rowValues(outer, bytes, fields, outerRow);
+            FileManager::readRecords(inner.table, matches->second, [&](size_t, const vector<uint8_t> &recordData){
+                if(recordData.empty() || stopped) return;
+                RecordCodec::decode(inner.schema, recordData, innerFields, inner.wanted);
+                rowValues(inner, recordData, innerFields, innerRow);
+                emit(outerRow, innerRow);
+            });
+        });
+    return true;
+}
+
+void Join::hashJoin(){
+    const Side &buildSide = sides[build];
+    const Side &probeSide = sides[1 - build];
+    QueryStats::usePlan("hash join");
+
+    uint64_t start = 0;     //first build row (non NULL key) of the pass
+    bool more = true;
+    RowValues probeRow;
+
+    while(more && !stopped){
+        unordered_map<string, vector<uint32_t>> table;
+        vector<RowValues> rows;
+        size_t used = 0;
+        uint64_t seen = 0;
+        more = false;
+
+        FileManager::scanColumns(buildSide.table, buildSide.schema, buildSide.wanted,
+            [&](uint64_t, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+                const RecordCodec::Field &key = fields[buildSide.column];
+                if(key.isNull) return;
+                uint64_t row = seen++;
+                if(row < start || more) return;
+
+                //budget spent, this row starts the next pass
+                if(!rows.empty() && used > memoryBudget){
+                    more = true;
+                    start = row;
+                    return;
+                }
+
+                string text = RecordCodec::toString(buildSide.schema, bytes, key, buildSide.column);
+                rows.emplace_back();
+                rowValues(buildSide, bytes, fields, rows.back());
+                used += text.size() + 64;
+                for(auto &value : rows.back().values) used += value.size() + sizeof(string);
+                table[text].push_back(rows.size() - 1);
+            });
+        passCount++;
+        if(rows.empty()) break;
+
+        FileManager::scanColumns(probeSide.table, probeSide.schema, probeSide.wanted,
+            [&](uint64_t, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+                const RecordCodec::Field &key = fields[probeSide.column];
+                if(key.isNull || stopped) return;
+
+                auto matches = table.find(RecordCodec::toString(probeSide.schema, bytes, key, probeSide.column));
+                if(matches == table.end()) return;
+
+                rowValues(probeSide, bytes, fields, probeRow);
+                for(uint32_t row : matches->second){
+                    emit(rows[row], probeRow);
+                    if(stopped) return;
+                }
+            });
+    }
+}
+
+void Join::run(Commands::IndexMode mode, const function<bool(vector<uint8_t> &record)> &row){
+    Trace::Span span("join");
+    rowSink = row;
+    stopped = false;
+    passCount = 0;
+
+    if(mode == Commands::IndexMode::HASH && indexJoin()) return;
+    hashJoin();
+}
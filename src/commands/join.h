@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include "parser.h"
+#include "commands.h"
+#include "record_codec.h"
+
+/*
+  SELECT ... FROM a JOIN b ON a.x = b.y, one equality per join.
+
+  The table with fewer rows (row count metadata) is the build side and the
+  other one probes. If the probe column has a hash index (hash mode, INT,
+  TEXT or DICT columns, whose keys are the printed value) with many more
+  distinct values than there are build rows, every build row looks its value
+  up and reads just the matching records: an index nested loop join. Each
+  match is a random read, so when most probe rows would match anyway the
+  build rows are hashed on their join value instead and the probe table is
+  scanned once, decoding only the join and selected columns.
+
+  Past the memory budget the hash join runs in passes: each pass hashes the
+  next budget's worth of build rows and scans the probe table again. NULL
+  never joins. Joined rows are handed over one at a time, none are kept.
+*/
+class Join{
+    private:
+        struct Side{
+            std::string table;
+            std::vector<std::pair<std::string,std::string>> metaInfo;
+            RecordCodec::Schema schema;
+            int column = -1;           //ON column
+            std::vector<int> shown;    //selected columns of this side
+            std::vector<bool> wanted;  //ON and selected columns
+            uint64_t rows = 0;
+            bool rowsKnown = false;
+        };
+        //values of one side's shown columns for one row
+        struct RowValues{
+            std::vector<std::string> values;
+            std::vector<bool> nulls;
+        };
+
+        Side sides[2];                              //FROM table, JOIN table
+        std::vector<std::pair<int,size_t>> output;  //(side, position in its shown) per result column
+        std::vector<std::pair<std::string,std::string>> columnInfo;
+        RecordCodec::Schema resultSchema;
+        int build = 1;
+        size_t passCount = 0;
+        std::function<bool(std::vector<uint8_t> &record)> rowSink;
+        bool stopped = false;   //rowSink wants no more rows
+
+        bool loadSide(int side, const std::string &table, const std::string &column);
+        bool addColumn(const std::string &name);
+        void rowValues(const Side &side, const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &fields, RowValues &row) const;
+        void emit(const RowValues &buildRow, const RowValues &probeRow);
+        bool indexJoin();
+        void hashJoin();
+
+    public:
+        //bytes of hashed build rows per pass, shared by every query
+        static void setMemoryBudget(size_t bytes);
+        //after a command: free this thread's probe index unless it fits the keep budget
+        static void releaseIndex();
+
+        //false (and prints the error) for an unknown table or column
+        bool prepare(const ParsedCommand &cmd);
+
+        //result columns and their format 2 schema, once prepared
+        const std::vector<std::pair<std::string,std::string>>& columns() const { return columnInfo; }
+        const RecordCodec::Schema& schema() const { return resultSchema; }
+
+        //hands each joined row to row, until it returns false
+        void run(Commands::IndexMode mode, const std::function<bool(std::vector<uint8_t> &record)> &row);
+
+        //build side passes of the hash join, 0 for an index join
+        size_t passes() const { return passCount; }
+};
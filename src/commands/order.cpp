@@ -0,0 +1,78 @@
+#include "order.h"
+#include <algorithm>
+
+using namespace std;
+
+SortKey makeSortKey(const RecordCodec::Schema &schema, size_t column, const vector<uint8_t> &bytes, const RecordCodec::Field &field){
+    SortKey key;
+    if(field.isNull) return key;
+    key.isNull = false;
+
+    switch(schema.types[column]){
+        case RecordCodec::ColumnType::INT:
+        case RecordCodec::ColumnType::BOOL:
+            key.intValue = field.intValue;
+            break;
+        case RecordCodec::ColumnType::FLOAT:
+            key.floatValue = field.floatValue;
+            break;
+        case RecordCodec::ColumnType::TEXT:
+        case RecordCodec::ColumnType::DICT:
+            key.text = RecordCodec::toString(schema, bytes, field, column);
+            break;
+    }
+    return key;
+}
+
+TopK::TopK(RecordCodec::ColumnType columnType, bool orderDescending, size_t rowLimit)
+    : type(columnType), descending(orderDescending), limit(rowLimit){}
+
+bool TopK::before(const Entry &a, const Entry &b) const{
+    if(a.key.isNull != b.key.isNull) return b.key.isNull;
+
+    if(!a.key.isNull){
+        int order = 0;
+        switch(type){
+            case RecordCodec::ColumnType::INT:
+            case RecordCodec::ColumnType::BOOL:
+                order = a.key.intValue < b.key.intValue ? -1 : (a.key.intValue > b.key.intValue ? 1 : 0);
+                break;
+            case RecordCodec::ColumnType::FLOAT:
+                order = a.key.floatValue < b.key.floatValue ? -1 : (a.key.floatValue > b.key.floatValue ? 1 : 0);
+                break;
+            case RecordCodec::ColumnType::TEXT:
+            case RecordCodec::ColumnType::DICT:
+                order = a.key.text.compare(b.key.text);
+                break;
+        }
+        if(order != 0) return descending ? order > 0 : order < 0;
+    }
+    return a.position < b.position;
+}
+
+void TopK::add(SortKey key, uint64_t position){
+    if(limit == 0) return;
+    auto compare = [this](const Entry &a, const Entry &b){ return before(a, b); };
+
+    Entry entry{move(key), position};
+    if(heap.size() < limit){
+        heap.push_back(move(entry));
+        push_heap(heap.begin(), heap.end(), compare);
+        return;
+    }
+    //heap.front() is the last row kept
+    if(!before(entry, heap.front())) return;
+    pop_heap(heap.begin(), heap.end(), compare);
+    heap.back() = move(entry);
+    push_heap(heap.begin(), heap.end(), compare);
+}
+
+vector<uint64_t> TopK::take(){
+    sort_heap(heap.begin(), heap.end(), [this](const Entry &a, const Entry &b){ return before(a, b); });
+
+    vector<uint64_t> positions;
+    positions.reserve(heap.size());
+    for(auto &entry : heap) positions.push_back(entry.position);
+    heap.clear();
+    return positions;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "record_codec.h"
+
+/*
+  ORDER BY ... LIMIT n.
+
+  Rows are never sorted as a whole: TopK keeps the first limit rows seen so
+  far in a heap whose top is the last of them, so another row costs one
+  compare with the top, and a push only when it beats it. Callers feed it
+  the ordered column alone and read the chosen rows afterwards.
+
+  NULLs sort last in both directions, equal values keep their position
+  order (file offset or result row).
+*/
+
+//one row's value of the ORDER BY column
+struct SortKey{
+    bool isNull = true;
+    uint64_t intValue = 0;     //INT and BOOL, unsigned like in the records
+    float floatValue = 0.0f;
+    std::string text;          //TEXT, and DICT as its text
+};
+
+SortKey makeSortKey(const RecordCodec::Schema &schema, size_t column, const std::vector<uint8_t> &bytes, const RecordCodec::Field &field);
+
+class TopK{
+    private:
+        struct Entry{
+            SortKey key;
+            uint64_t position;
+        };
+
+        RecordCodec::ColumnType type;
+        bool descending;
+        size_t limit;
+        std::vector<Entry> heap;
+
+        bool before(const Entry &a, const Entry &b) const;
+
+    public:
+        //limit SIZE_MAX keeps every row (ORDER BY without LIMIT)
+        TopK(RecordCodec::ColumnType columnType, bool orderDescending, size_t rowLimit);
+
+        void add(SortKey key, uint64_t position);
+        //kept positions in ORDER BY order, leaves the heap empty
+        std::vector<uint64_t> take();
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "record_codec.h"
+
+/*
+  Rows produced by SELECT / SHOW when the caller wants them back as data
+  instead of printed text. Records are kept exactly as stored in the .data
+  file so the server can ship them without decoding.
+*/
+struct ResultSet{
+    bool hasTable = false;
+    std::vector<std::pair<std::string,std::string>> columns;
+    RecordCodec::Schema schema;   //layout of records, with the table's dictionaries
+    std::vector<std::vector<uint8_t>> records;
+    std::vector<int> projection;   //SELECT column list as column positions, empty for all
+};
+
+namespace Commands{
+
+    //capture is per thread, every server client runs on its own thread
+    void setResultCapture(ResultSet *result);
+    ResultSet* getResultCapture();
+
+}
@@ -0,0 +1,46 @@
+#include "seal.h"
+#include "file_manager.h"
+#include "segment_store.h"
+#include "zone_map.h"
+#include <iostream>
+
+using namespace std;
+
+//SEAL TABLE t [COLUMNAR]: compress the current .data into cold segment blocks, offsets and indexes stay valid
+void sealCmdExecute(const ParsedCommand &cmd){
+
+    std::vector<std::pair<std::string,std::string>> metaInfo;
+    std::string primaryColName;
+    int format = RecordCodec::FORMAT_TAGGED;
+
+    if(!FileManager::readMeta(cmd.table,metaInfo,primaryColName,format)){
+        cout << "error to read meta(table not found)\n";
+        return;
+    }
+
+    //column groups split records by the v2 layout
+    if(cmd.columnar && format != RecordCodec::FORMAT_BITMAP){
+        cout << "[ERROR] Table " << cmd.table << " uses record format " << format << ", COLUMNAR needs format 2\n";
+        return;
+    }
+    auto schema = RecordCodec::makeSchema(metaInfo, format);
+
+    SealResult result;
+    if(!SegmentStore::seal(cmd.table, result, cmd.columnar ? &schema : nullptr)){
+        cout << "[ERROR] Could not seal table " << cmd.table << "\n";
+        return;
+    }
+
+    if(result.blocks == 0){
+        cout << "[INFO] Nothing to seal.\n";
+        return;
+    }
+
+    //the tail now starts at a new offset
+    const SegmentStore *sealed = SegmentStore::forTable(cmd.table);
+    ZoneMap::rebuild(cmd.table, sealed ? sealed->tailBase() : 0);
+
+    cout << "[OK] Sealed " << result.records << " record(s) of " << cmd.table << ": "
+         << result.rawBytes << " -> " << result.packedBytes << " bytes in "
+         << result.blocks << (cmd.columnar ? " column group(s)\n" : " block(s)\n");
+}
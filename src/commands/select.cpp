@@ -1,67 +1,499 @@
 #include "select.h"
 #include "file_manager.h"
 #include "utils.h"
-#include "varint.h"
 #include "hash_index.h"
 #include "bplusTree_index.h"
+#include "result_set.h"
+#include "aggregate.h"
+#include "order.h"
+#include "join.h"
+#include "dictionary.h"
+#include "query_stats.h"
+#include "trace.h"
 #include <iostream>
-#include <cstring>
+#include <algorithm>
+#include <cstdint>
 
 using namespace std;
 
-static HashIndex globalHashSelect;
-static BPlusTreeIndex globalBPTreeSelect;
-
-static void printSingleRecord(const vector<uint8_t> &recordData, const vector<pair<string,string>> &metaInfo){
-
-    size_t pos = 0;
-    for (auto &col : metaInfo) {
-        if (pos >= recordData.size()) { 
-            cout << "| ? "; 
-            continue; 
-        }
-        char flagType = recordData[pos++];
-            if (flagType == 'I') {
-            size_t r=0;
-            uint64_t intValue = Varint::decode(recordData, pos, r);
-            pos += r;
-            cout << "| " << intValue << " ";
-        } else if (flagType == 'F') {
-            float floatValue=0.0f;
-            if (pos + 4 <= recordData.size()) {
-                memcpy(&floatValue, recordData.data()+pos, 4);
-                pos += 4;   
+//SELECTs run in parallel under the server's read lock, so each thread
+//keeps its own copy (the file stamp still avoids needless reloads)
+static thread_local HashIndex globalHashSelect;
+static thread_local BPlusTreeIndex globalBPTreeSelect;
+
+//rows a LIMIT lets through, all without one
+static size_t rowLimit(const ParsedCommand &cmd){
+    return cmd.limit < 0 ? SIZE_MAX : (size_t)cmd.limit;
+}
+
+static void outputHeader(const vector<pair<string,string>> &metaInfo, const Projection &projection){
+    cout << "-------------------------------------------------\n";
+    for (int c : projection.columns){
+         cout << "| " << metaInfo[c].first << " ";
+    }   
+    cout << "\n-------------------------------------------------\n";
+}
+
+//server side: hand raw records back, no text formatting
+static ResultSet* startCapture(const vector<pair<string,string>> &metaInfo, const RecordCodec::Schema &schema, const Projection &projection){
+    ResultSet* capture = Commands::getResultCapture();
+    if(capture){
+        capture->hasTable = true;
+        capture->columns = metaInfo;
+        capture->schema = schema;
+        if(projection.columns.size() != metaInfo.size()) capture->projection = projection.columns;
+    }
+    return capture;
+}
+
+static void outputRecords(const string &table, const vector<uint64_t> &offsets, const vector<pair<string,string>> &metaInfo,
+                          const RecordCodec::Schema &schema, const Projection &projection){
+
+    ResultSet* capture = startCapture(metaInfo, schema, projection);
+    if(capture){
+        FileManager::readRecords(table, offsets, [&](size_t, const vector<uint8_t> &recordData){
+            if(!recordData.empty()) capture->records.push_back(recordData);
+        });
+        return;
+    }
+
+    outputHeader(metaInfo, projection);
+    Trace::StageTotal decodeTime("decode");
+    FileManager::readRecords(table, offsets, [&](size_t, const vector<uint8_t> &recordData){
+        decodeTime.begin();
+        printRecord(schema,recordData,projection);
+        decodeTime.end();
+    });
+}
+
+//SELECT without WHERE: every live record in file order, the first limit of them
+static void outputTable(const string &table, const vector<pair<string,string>> &metaInfo,
+                        const RecordCodec::Schema &schema, const Projection &projection, size_t limit){
+
+    ResultSet* capture = startCapture(metaInfo, schema, projection);
+    if(!capture) outputHeader(metaInfo, projection);
+
+    //a LIMIT stops early, only the whole table is worth splitting over threads
+    if(limit == SIZE_MAX){
+        outputRows(table, schema, projection, capture);
+        return;
+    }
+
+    size_t shown = 0;
+    Trace::StageTotal decodeTime("decode");
+    FileManager::scanRecords(table, [&](uint64_t, const vector<uint8_t> &recordData){
+        if(shown >= limit) return;
+        shown++;
+        if(capture){
+            capture->records.push_back(recordData);
+        }else{
+            decodeTime.begin();
+            printRecord(schema,recordData,projection);
+            decodeTime.end();
+        }
+    });
+}
+
+/*
+  Rows built by an aggregator or a join, handed over one at a time and not
+  stored anywhere. Without ORDER BY each row is printed (or captured) right
+  away and rows past LIMIT are dropped. ORDER BY names a result column: rows
+  are held until finish(), and with a LIMIT they are cut back to the best
+  ones whenever twice the LIMIT are held.
+*/
+class ResultOutput{
+    private:
+        const ParsedCommand &cmd;
+        const vector<pair<string,string>> &columns;
+        const RecordCodec::Schema &schema;
+        size_t limit;
+        int orderColumn = -1;
+        Projection all;
+        ResultSet* capture = nullptr;
+        size_t shown = 0;
+        vector<vector<uint8_t>> held;   //ORDER BY only
+        Trace::StageTotal decodeTime{"decode"};
+
+        //held rows in ORDER BY order, the first limit of them; ties keep their order
+        void cut(){
+            vector<bool> wanted(columns.size(), false);
+            wanted[orderColumn] = true;
+            TopK topK(schema.types[orderColumn], cmd.orderDescending, limit);
+            vector<RecordCodec::Field> fields;
+            for(size_t i = 0; i < held.size(); i++){
+                RecordCodec::decode(schema, held[i], fields, wanted);
+                topK.add(makeSortKey(schema, orderColumn, held[i], fields[orderColumn]), i);
+            }
+            vector<vector<uint8_t>> best;
+            for(uint64_t i : topK.take()) best.push_back(move(held[i]));
+            held.swap(best);
+        }
+
+        void show(vector<uint8_t> &record){
+            if(capture){
+                capture->records.push_back(move(record));
+                return;
+            }
+            decodeTime.begin();
+            printRecord(schema, record, all);
+            decodeTime.end();
+        }
+
+    public:
+        ResultOutput(const ParsedCommand &command, const vector<pair<string,string>> &resultColumns, const RecordCodec::Schema &resultSchema)
+            : cmd(command), columns(resultColumns), schema(resultSchema), limit(rowLimit(command)){}
+
+        //false (and prints the error) when ORDER BY is not a result column
+        bool start(){
+            if(!cmd.orderBy.empty()){
+                orderColumn = findColumnIndex(columns, cmd.orderBy);
+                if(orderColumn < 0){
+                    cout << "[ERROR] ORDER BY " << cmd.orderBy << " is not a result column\n";
+                    return false;
+                }
+            }
+            makeProjection({}, columns, all);
+            capture = startCapture(columns, schema, all);
+            if(!capture) outputHeader(columns, all);
+            return true;
+        }
+
+        //every further row would be dropped, the producer may stop
+        bool full() const { return orderColumn < 0 && shown >= limit; }
+
+        void add(vector<uint8_t> &record){
+            if(orderColumn >= 0){
+                held.push_back(move(record));
+                if(held.size() - limit >= limit) cut();
+                return;
             }
-            cout << "| " << floatValue << " ";
-        } else if (flagType == 'B') {
-            uint8_t boolValue = recordData[pos++]; 
-            cout << "| " << (boolValue ? "true":"false") << " ";
-        } else if (flagType == 'S') {
-            size_t r=0;
-            uint64_t strLength = Varint::decode(recordData, pos, r);
-            pos += r;
-            string strValue;
-            if (pos + strLength <= recordData.size()) {
-                strValue.assign((char*)(recordData.data()+pos), strLength);
+            if(shown >= limit) return;
+            shown++;
+            show(record);
+        }
+
+        void finish(){
+            if(orderColumn < 0) return;
+            cut();
+            for(auto &record : held) show(record);
+            held.clear();
+        }
+
+        //the query failed after some rows: the captured ones are dropped, printed ones stay
+        void abort(){
+            if(capture) capture->records.clear();
+            held.clear();
+        }
+};
+
+//offsets are the WHERE matches, or nullptr for the whole table (only the wanted columns are decoded)
+template<typename Sink>
+static void feedRows(const string &table, const vector<uint64_t> *offsets, const RecordCodec::Schema &schema, Sink &sink){
+    if(offsets){
+        vector<RecordCodec::Field> fields;
+        FileManager::readRecords(table, *offsets, [&](size_t, const vector<uint8_t> &recordData){
+            if(recordData.empty()) return;
+            RecordCodec::decode(schema, recordData, fields, sink.wanted());
+            sink.addRow(recordData, fields);
+        });
+        return;
+    }
+    FileManager::scanColumns(table, schema, sink.wanted(),
+        [&](uint64_t, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+            sink.addRow(bytes, fields);
+        });
+}
+
+/*
+  Aggregate SELECT without GROUP BY. A lone COUNT(*) over the whole table
+  comes from the row counts FileManager keeps, over WHERE matches it is the
+  number of matches; other queries decode only the aggregated columns.
+*/
+static void outputAggregates(const ParsedCommand &cmd, const vector<uint64_t> *offsets, const vector<pair<string,string>> &metaInfo,
+                             const RecordCodec::Schema &schema){
+    Aggregator aggregator;
+    if(!aggregator.prepare(cmd.aggregates, metaInfo, schema)) return;
+
+    uint64_t rows = 0;
+    if(offsets && aggregator.countOnly()){
+        aggregator.addRows(offsets->size());
+    }else if(!offsets && aggregator.countOnly() && FileManager::countRecords(cmd.table, rows)){
+        aggregator.addRows(rows);
+    }else if(!offsets){
+        //one aggregator per scan worker, folded together at the end
+        vector<Aggregator> partial(FileManager::scanThreads(), aggregator);
+        FileManager::scanParallel(cmd.table, schema, aggregator.wanted(),
+            [&](size_t worker, uint64_t, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+                partial[worker].addRow(bytes, fields);
+            });
+        for(Aggregator &worker : partial) aggregator.merge(worker);
+    }else{
+        feedRows(cmd.table, offsets, schema, aggregator);
+    }
+
+    vector<pair<string,string>> columns;
+    RecordCodec::Schema resultSchema;
+    vector<uint8_t> record;
+    aggregator.result(columns, resultSchema, record);
+    ResultOutput output(cmd, columns, resultSchema);
+    if(!output.start()) return;
+    output.add(record);
+    output.finish();
+}
+
+/*
+  GROUP BY of one TEXT or DICT column with only COUNT(*) calls: the hash
+  index already keeps the offsets of every value, so each list's size is a
+  group's count. NULLs are not indexed, their group is whatever the row
+  count leaves over. False when the index can not answer, nothing added then.
+*/
+static bool groupsFromIndex(const ParsedCommand &cmd, Commands::IndexMode mode, const vector<pair<string,string>> &metaInfo,
+                            const RecordCodec::Schema &schema, GroupAggregator &aggregator){
+    if(mode != Commands::IndexMode::HASH || cmd.groupBy.size() != 1 || !aggregator.countOnly()) return false;
+
+    int column = findColumnIndex(metaInfo, cmd.groupBy[0]);
+    RecordCodec::ColumnType type = schema.types[column];
+    if(type != RecordCodec::ColumnType::TEXT && type != RecordCodec::ColumnType::DICT) return false;
+
+    uint64_t total = 0;
+    if(!FileManager::countRecords(cmd.table, total)) return false;
+
+    globalHashSelect.loadFromDisk(cmd.table);
+    auto values = globalHashSelect.idx.find(cmd.groupBy[0]);
+    uint64_t indexed = 0;
+    if(values != globalHashSelect.idx.end()){
+        for(auto &entry : values->second) indexed += entry.second.size();
+    }
+    if(indexed > total) return false;
+
+    QueryStats::usePlan("hash index groups");
+    if(values != globalHashSelect.idx.end()){
+        QueryStats::addIndexEntries(values->second.size());
+        Dictionary *dictionary = schema.dicts[column];
+        for(auto &entry : values->second){
+            if(entry.second.empty()) continue;
+            string text = entry.first;
+            if(dictionary){
+                try{ text = dictionary->text(stoull(entry.first)); }catch(...){}
             }
-            pos += strLength;
-            cout << "| " << strValue << " ";
-        } else {
-            cout << "| ? ";
+            aggregator.addGroup(false, text, entry.second.size());
         }
     }
-    cout << "\n";
+    if(total > indexed) aggregator.addGroup(true, "", total - indexed);
+    return true;
+}
+
+static void outputGroups(const ParsedCommand &cmd, Commands::IndexMode mode, const vector<uint64_t> *offsets,
+                         const vector<pair<string,string>> &metaInfo, const RecordCodec::Schema &schema){
+    GroupAggregator aggregator;
+    if(!aggregator.prepare(cmd.table, cmd.groupBy, cmd.selectColumns, cmd.aggregates, metaInfo, schema)) return;
+
+    if(offsets || !groupsFromIndex(cmd, mode, metaInfo, schema, aggregator)){
+        feedRows(cmd.table, offsets, schema, aggregator);
+    }
+
+    vector<pair<string,string>> columns;
+    RecordCodec::Schema resultSchema;
+    aggregator.resultColumns(columns, resultSchema);
+    ResultOutput output(cmd, columns, resultSchema);
+    if(!output.start()) return;
+
+    //partition by partition when spilled, only one of them is held at a time
+    bool complete = aggregator.result(resultSchema, [&](vector<uint8_t> &record){ output.add(record); });
+    if(!complete){
+        output.abort();
+        return;
+    }
+    output.finish();
+    if(aggregator.spilled()){
+        cout << "[INFO] GROUP BY spilled " << aggregator.spilled() << " partial group(s) to disk\n";
+    }
+}
+
+static void outputJoin(const ParsedCommand &cmd, Commands::IndexMode mode){
+    if(!cmd.aggregates.empty() || !cmd.groupBy.empty()){
+        cout << "[ERROR] JOIN takes a column list, aggregates and GROUP BY are not supported\n";
+        return;
+    }
+    Join join;
+    if(!join.prepare(cmd)) return;
+
+    //rows go out as they are joined; without ORDER BY the join stops at LIMIT
+    ResultOutput output(cmd, join.columns(), join.schema());
+    if(!output.start()) return;
+    if(!output.full()){
+        join.run(mode, [&](vector<uint8_t> &record){
+            output.add(record);
+            return !output.full();
+        });
+    }
+    output.finish();
+    if(join.passes() > 1){
+        cout << "[INFO] JOIN passed its memory budget, hashed the build table in " << join.passes() << " passes\n";
+    }
+}
+
+/*
+  ORDER BY over table rows; offsets are the WHERE matches, or nullptr for
+  the whole table. In B+ tree mode the leaf chain already holds a TEXT or
+  DICT column in order, so the first rows are walked off it. Keys are the
+  typed text, which does not order numbers, so INT, FLOAT and BOOL (and
+  WHERE matches) go through TopK reading just the ordered column.
+*/
+static void outputOrdered(const ParsedCommand &cmd, Commands::IndexMode mode, const vector<uint64_t> *offsets,
+                          const vector<pair<string,string>> &metaInfo, const RecordCodec::Schema &schema, const Projection &projection){
+    int column = findColumnIndex(metaInfo, cmd.orderBy);
+    if(column < 0){
+        cout << "[ERROR] ORDER BY column " << cmd.orderBy << " not found\n";
+        return;
+    }
+    RecordCodec::ColumnType type = schema.types[column];
+    size_t limit = rowLimit(cmd);
+    vector<bool> wanted(schema.types.size(), false);
+    wanted[column] = true;
+
+    vector<uint64_t> ordered;
+    if(!offsets && mode == Commands::IndexMode::BPLUSTREE &&
+       (type == RecordCodec::ColumnType::TEXT || type == RecordCodec::ColumnType::DICT)){
+        globalBPTreeSelect.loadFromDisk(cmd.table);
+        ordered = globalBPTreeSelect.orderedScan(cmd.orderBy, cmd.orderDescending, limit);
+
+        //NULLs are not indexed and sort last
+        if(ordered.size() < limit){
+            FileManager::scanColumns(cmd.table, schema, wanted,
+                [&](uint64_t offset, const vector<uint8_t> &, const vector<RecordCodec::Field> &fields){
+                    if(fields[column].isNull && ordered.size() < limit) ordered.push_back(offset);
+                });
+        }
+    }else{
+        QueryStats::usePlan("top-k heap");
+        TopK topK(type, cmd.orderDescending, limit);
+        if(offsets){
+            vector<RecordCodec::Field> fields;
+            FileManager::readRecords(cmd.table, *offsets, [&](size_t i, const vector<uint8_t> &recordData){
+                if(recordData.empty()) return;
+                RecordCodec::decode(schema, recordData, fields, wanted);
+                topK.add(makeSortKey(schema, column, recordData, fields[column]), (*offsets)[i]);
+            });
+        }else{
+            FileManager::scanColumns(cmd.table, schema, wanted,
+                [&](uint64_t offset, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+                    topK.add(makeSortKey(schema, column, bytes, fields[column]), offset);
+                });
+        }
+        ordered = topK.take();
+    }
+
+    outputRecords(cmd.table, ordered, metaInfo, schema, projection);
+}
+
+/*
+  BETWEEN without an ordered index (hash mode): scan only the where column.
+  INT and FLOAT compare as numbers, the zone maps skip blocks whose min/max
+  lie outside the range. Other types compare as text and read every block.
+*/
+static vector<uint64_t> scanBetween(const ParsedCommand &cmd, const vector<pair<string,string>> &metaInfo, const RecordCodec::Schema &schema){
+    vector<uint64_t> offsets;
+    int column = findColumnIndex(metaInfo, cmd.whereColumn);
+    if(column < 0) return offsets;
+
+    RecordCodec::ColumnType type = schema.types[column];
+    uint64_t lowInt = 0, highInt = 0;
+    float lowFloat = 0.0f, highFloat = 0.0f;
+    try{
+        if(type == RecordCodec::ColumnType::INT){
+            lowInt = stoull(cmd.whereValue1);
+            highInt = stoull(cmd.whereValue2);
+        }else if(type == RecordCodec::ColumnType::FLOAT){
+            lowFloat = stof(cmd.whereValue1);
+            highFloat = stof(cmd.whereValue2);
+        }
+    }catch(...){
+        cout << "[ERROR] BETWEEN on " << cmd.whereColumn << " needs numbers\n";
+        return offsets;
+    }
+
+    auto blockFilter = [&](const vector<RecordCodec::ColumnRange> &ranges){
+        const RecordCodec::ColumnRange &range = ranges[column];
+        if(type == RecordCodec::ColumnType::INT){
+            return range.known && range.maxInt >= lowInt && range.minInt <= highInt;
+        }
+        if(type == RecordCodec::ColumnType::FLOAT){
+            return range.known && range.maxFloat >= lowFloat && range.minFloat <= highFloat;
+        }
+        return true;
+    };
+
+    vector<bool> wanted(schema.types.size(), false);
+    wanted[column] = true;
+
+    //matches per scan worker, appended in file order after each round
+    vector<vector<uint64_t>> found(FileManager::scanThreads());
+    FileManager::scanParallel(cmd.table, schema, wanted,
+        [&](size_t worker, uint64_t offset, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+            const RecordCodec::Field &field = fields[column];
+            if(field.isNull) return;
+
+            bool inRange = false;
+            if(type == RecordCodec::ColumnType::INT){
+                inRange = field.intValue >= lowInt && field.intValue <= highInt;
+            }else if(type == RecordCodec::ColumnType::FLOAT){
+                inRange = field.floatValue >= lowFloat && field.floatValue <= highFloat;
+            }else{
+                string text = RecordCodec::toString(schema, bytes, field, column);
+                inRange = text >= cmd.whereValue1 && text <= cmd.whereValue2;
+            }
+            if(inRange) found[worker].push_back(offset);
+        },
+        [&](size_t worker){
+            offsets.insert(offsets.end(), found[worker].begin(), found[worker].end());
+            found[worker].clear();
+        }, blockFilter);
+
+    return offsets;
+}
+
+void releaseSelectIndexes(){
+    globalHashSelect.releaseUnlessKept();
+    globalBPTreeSelect.releaseUnlessKept();
+    Join::releaseIndex();
 }
 
 void selectCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode){
+    if(!cmd.joinTable.empty()){
+        outputJoin(cmd, mode);
+        return;
+    }
+
     vector<pair<string,string>> metaInfo;
     string primaryColName;
+    int format = RecordCodec::FORMAT_TAGGED;
 
-    if(!FileManager::readMeta(cmd.table,metaInfo,primaryColName)){
+    if(!FileManager::readMeta(cmd.table,metaInfo,primaryColName,format)){
         cout << "error to read meta(table not found)\n";
         return;
     }
-    
+    auto schema = RecordCodec::makeSchema(metaInfo, format, cmd.table);
+
+    Projection projection;
+    if(!makeProjection(cmd.selectColumns, metaInfo, projection)) return;
+    if(!cmd.aggregates.empty() && !cmd.selectColumns.empty() && cmd.groupBy.empty()){
+        cout << "[ERROR] Column " << cmd.selectColumns[0] << " must be in GROUP BY or inside an aggregate\n";
+        return;
+    }
+
+    if(cmd.op.empty()){
+        if(!cmd.groupBy.empty()){
+            outputGroups(cmd, mode, nullptr, metaInfo, schema);
+        }else if(!cmd.aggregates.empty()){
+            outputAggregates(cmd, nullptr, metaInfo, schema);
+        }else if(!cmd.orderBy.empty()){
+            outputOrdered(cmd, mode, nullptr, metaInfo, schema, projection);
+        }else{
+            outputTable(cmd.table, metaInfo, schema, projection, rowLimit(cmd));
+        }
+        return;
+    }
     
     if(mode == Commands::IndexMode::HASH){
         globalHashSelect.loadFromDisk(cmd.table);
@@ -69,67 +501,80 @@ void selectCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode){
         globalBPTreeSelect.loadFromDisk(cmd.table);
     }
 
+    vector<uint64_t> offsets;
     if(cmd.op == "="){
         cout << "[INFO] Search for " << cmd.whereColumn << " = " << cmd.whereValue1 << "\n";
         
-        vector<uint64_t> offsets;
-        if(mode == Commands::IndexMode::HASH){
-            offsets = globalHashSelect.findRecord(cmd.whereColumn, cmd.whereValue1);
+        //a DICT value the column never held matches nothing
+        string whereKey;
+        bool known = indexValue(schema, findColumnIndex(metaInfo, cmd.whereColumn), mode, cmd.whereValue1, whereKey);
+        if(known && mode == Commands::IndexMode::HASH){
+            offsets = globalHashSelect.findRecord(cmd.whereColumn, whereKey);
         }else if(mode == Commands::IndexMode::BPLUSTREE){
             string key = cmd.whereColumn + "##" + cmd.whereValue1;
             offsets = globalBPTreeSelect.search(key);
         }
-        
-        if(offsets.empty()){
-            cout << "[INFO] 0 matching records.\n";
-            return;
-        }
-
-        
-        cout << "-------------------------------------------------\n";
-        for (auto &c: metaInfo){
-             cout << "| " << c.first << " ";
-        }   
-        cout << "\n-------------------------------------------------\n";
-
-        for(auto &off : offsets){
-            auto recordData = FileManager::readRecord(cmd.table,off);
-            printSingleRecord(recordData,metaInfo);
-        }
 
     }else if(cmd.op == "BETWEEN"){
         cout << "[INFO] Range search for " << cmd.whereColumn << " BETWEEN " 
              << cmd.whereValue1 << " AND " << cmd.whereValue2 << "\n";
         
-        vector<uint64_t> offsets;
         if(mode == Commands::IndexMode::HASH){
-            cout << "[ERROR] BETWEEN not supported with Hash index. Use B+ Tree.\n";
-            return;
+            offsets = scanBetween(cmd, metaInfo, schema);
         }else if(mode == Commands::IndexMode::BPLUSTREE){
             string keyLow = cmd.whereColumn + "##" + cmd.whereValue1;
             string keyHigh = cmd.whereColumn + "##" + cmd.whereValue2;
             offsets = globalBPTreeSelect.rangeSearch(keyLow, keyHigh);
         }
-        
-        if(offsets.empty()){
-            cout << "[INFO] 0 matching records.\n";
-            return;
-        }
 
-        cout << "-------------------------------------------------\n";
-        for (auto &c: metaInfo){
-             cout << "| " << c.first << " ";
-        }   
-        cout << "\n-------------------------------------------------\n";
+    }else if(cmd.op == "IN"){
+        cout << "[INFO] Search for " << cmd.whereColumn << " IN " << cmd.whereValues.size() << " value(s)\n";
 
-        for(auto &off : offsets){
-            auto recordData = FileManager::readRecord(cmd.table,off);
-            printSingleRecord(recordData,metaInfo);
+        //one probe pass for the whole list
+        int column = findColumnIndex(metaInfo, cmd.whereColumn);
+        vector<string> keys;
+        for(auto &value : cmd.whereValues){
+            string key;
+            if(mode == Commands::IndexMode::BPLUSTREE){
+                keys.push_back(cmd.whereColumn + "##" + value);
+            }else if(indexValue(schema, column, mode, value, key)){
+                keys.push_back(key);
+            }
         }
+        if(mode == Commands::IndexMode::HASH){
+            offsets = globalHashSelect.findRecords(cmd.whereColumn, keys);
+        }else if(mode == Commands::IndexMode::BPLUSTREE){
+            offsets = globalBPTreeSelect.searchMany(keys);
+        }
+
+        //records are read in file order, a row two listed values match comes once
+        sort(offsets.begin(), offsets.end());
+        offsets.erase(unique(offsets.begin(), offsets.end()), offsets.end());
 
     }else{
         cout << "[ERROR] Invalid SELECT operation\n";
+        return;
     }
 
-}
+    if(!cmd.groupBy.empty()){
+        outputGroups(cmd, mode, &offsets, metaInfo, schema);
+        return;
+    }
 
+    //aggregates answer with one row even when nothing matched
+    if(!cmd.aggregates.empty()){
+        outputAggregates(cmd, &offsets, metaInfo, schema);
+        return;
+    }
+
+    if(offsets.empty()){
+        cout << "[INFO] 0 matching records.\n";
+        return;
+    }
+    if(!cmd.orderBy.empty()){
+        outputOrdered(cmd, mode, &offsets, metaInfo, schema, projection);
+        return;
+    }
+    if(offsets.size() > rowLimit(cmd)) offsets.resize(rowLimit(cmd));
+    outputRecords(cmd.table, offsets, metaInfo, schema, projection);
+}
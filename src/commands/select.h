@@ -4,3 +4,6 @@
 
 void selectCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode);
 
+//after a command: free this thread's SELECT and join indexes unless they fit the keep budget
+void releaseSelectIndexes();
+
@@ -0,0 +1,14 @@
+#include "stats.h"
+#include "metrics.h"
+#include <iostream>
+
+using namespace std;
+
+//STATS: counters collected since the process started
+void statsCmdExecute(const ParsedCommand &cmd){
+    (void)cmd;
+
+    cout << "[INFO] PicoDB statistics\n";
+    Metrics::report(cout);
+    cout << "buffer_cache none (records are read from the .data file on every access)\n";
+}
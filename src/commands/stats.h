@@ -0,0 +1,4 @@
+#pragma once
+#include "parser.h"
+
+void statsCmdExecute(const ParsedCommand &cmd);
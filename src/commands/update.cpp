@@ -1,11 +1,11 @@
 #include "update.h"
 #include "file_manager.h"
 #include "utils.h"
-#include "varint.h"
+#include "record_codec.h"
 #include "hash_index.h"
 #include "bplusTree_index.h"
+#include "trace.h"
 #include <iostream>
-#include <cstring>
 #include <algorithm>
 #include <map>
 
@@ -14,129 +14,22 @@ using namespace std;
 static HashIndex globalHashUpdate;
 static BPlusTreeIndex globalBPTreeUpdate;
 
-static vector<uint8_t> encodeRecord(
-    const vector<pair<string,string>> &metaInfo,
-    const vector<string> &metaValues)
+//move one column's index entry from the old value to the new one, NULLs are not indexed
+static void reindexColumn(Commands::IndexMode mode, const RecordCodec::Schema &schema, int column, const string &colName,
+                          const string &oldVal, bool oldNull, uint64_t oldOffset,
+                          const string &newVal, bool newNull, uint64_t newOffset)
 {
-    vector<uint8_t> bufferSpace;
+    string oldKey, newKey;
+    if(!oldNull && !indexValue(schema, column, mode, oldVal, oldKey)) oldNull = true;
+    if(!newNull && !indexValue(schema, column, mode, newVal, newKey)) newNull = true;
 
-    for (int i = 0; i < metaInfo.size(); i++)
-    {
-        string dataType = metaInfo[i].second;
-        for (auto &c : dataType)
-        {
-            c = toupper(c);
-        }
-
-        string metaValue;
-        if(i < metaValues.size()){
-            metaValue = metaValues[i];
-        }else{
-            metaValue = "";
-        }
-
-        if(dataType == "INT"){
-            bufferSpace.push_back('I');
-            uint64_t intValue = 0;
-
-            try{
-                if(!metaValue.empty()){
-                    intValue = stoull(metaValue);
-                }
-            }catch(...){}
-
-            auto varInt = Varint::encode(intValue);
-            bufferSpace.insert(bufferSpace.end(),varInt.begin(),varInt.end());
-            
-        }else if(dataType == "FLOAT"){
-            bufferSpace.push_back('F');
-            float floatValue = 0.0f;
-
-            try{
-                if(!metaValue.empty()){
-                    floatValue = stof(metaValue);
-                }
-            }catch(...){}
-
-            uint8_t temp[4];
-            memcpy(temp,&floatValue,4);
-            bufferSpace.insert(bufferSpace.end(),temp,temp+4);
-
-        }else if(dataType == "BOOL"){
-            bufferSpace.push_back('B');
-            bufferSpace.push_back((metaValue == "true" || metaValue == "1") ? 1 : 0);
-        }else{
-            bufferSpace.push_back('S');
-
-            uint64_t strLength = metaValue.size();
-            auto strLenBin = Varint::encode(strLength);
-            bufferSpace.insert(bufferSpace.end(),strLenBin.begin(),strLenBin.end());
-
-            bufferSpace.insert(bufferSpace.end(),metaValue.begin(),metaValue.end());
-        }
-    }
-    return bufferSpace;
-}
-
-
-static vector<string> decodeRecordValues(
-    const vector<uint8_t> &recordData,
-    const vector<pair<string,string>> &metaInfo)
-{
-    vector<string> values;
-    size_t pos = 0;
-    
-    for (auto &col : metaInfo) {
-        if (pos >= recordData.size()) { 
-            values.push_back("");
-            continue; 
-        }
-        
-        char flagType = recordData[pos++];
-        
-        if (flagType == 'I') {
-            size_t r = 0;
-            uint64_t intValue = Varint::decode(recordData, pos, r);
-            pos += r;
-            values.push_back(to_string(intValue));
-        } else if (flagType == 'F') {
-            float floatValue = 0.0f;
-            if (pos + 4 <= recordData.size()) {
-                memcpy(&floatValue, recordData.data() + pos, 4);
-                pos += 4;   
-            }
-            values.push_back(to_string(floatValue));
-        } else if (flagType == 'B') {
-            uint8_t boolValue = recordData[pos++]; 
-            values.push_back(boolValue ? "true" : "false");
-        } else if (flagType == 'S') {
-            size_t r = 0;
-            uint64_t strLength = Varint::decode(recordData, pos, r);
-            pos += r;
-            string strValue;
-            if (pos + strLength <= recordData.size()) {
-                strValue.assign((char*)(recordData.data() + pos), strLength);
-            }
-            pos += strLength;
-            values.push_back(strValue);
-        } else {
-            values.push_back("");
-        }
-    }
-    
-    return values;
-}
-
-static int findColumnIndex(
-    const vector<pair<string,string>> &metaInfo,
-    const string &colName)
-{
-    for(size_t i = 0; i < metaInfo.size(); i++){
-        if(metaInfo[i].first == colName){
-            return i;
-        }
+    if(mode == Commands::IndexMode::HASH){
+        if(!oldNull) globalHashUpdate.deleteRecord(colName, oldKey, oldOffset);
+        if(!newNull) globalHashUpdate.addRecord(colName, newKey, newOffset);
+    } else if(mode == Commands::IndexMode::BPLUSTREE){
+        if(!oldNull) globalBPTreeUpdate.deleteRecord(colName + "##" + oldKey, oldOffset);
+        if(!newNull) globalBPTreeUpdate.insert(colName + "##" + newKey, newOffset);
     }
-    return -1;
 }
 
 /*
@@ -158,13 +51,15 @@ void updateCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode)
 {
     vector<pair<string,string>> metaInfo;
     string primaryColName;
+    int format = RecordCodec::FORMAT_TAGGED;
 
-    if(!FileManager::readMeta(cmd.table, metaInfo, primaryColName)){
+    if(!FileManager::readMeta(cmd.table, metaInfo, primaryColName, format)){
         cout << "[ERROR] Table not found: " << cmd.table << "\n";
         return;
     }
 
     map<string, string> updateMap;
+    map<string, bool> updateNull;
     if(cmd.columns.size() != cmd.values.size()){
         cout << "[ERROR] SET clause malformed: column count != value count\n";
         return;
@@ -172,6 +67,7 @@ void updateCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode)
     
     for(size_t i = 0; i < cmd.columns.size(); i++){
         updateMap[cmd.columns[i].first] = cmd.values[i];
+        updateNull[cmd.columns[i].first] = i < cmd.nullValues.size() && cmd.nullValues[i];
     }
 
     for(auto &upd : updateMap){
@@ -179,8 +75,20 @@ void updateCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode)
             cout << "[ERROR] Column not found: " << upd.first << "\n";
             return;
         }
+        if(updateNull[upd.first]){
+            if(format == RecordCodec::FORMAT_TAGGED){
+                cout << "[ERROR] Table " << cmd.table << " uses record format 1, which has no NULL\n";
+                return;
+            }
+            if(upd.first == primaryColName){
+                cout << "[ERROR] Primary key " << primaryColName << " cannot be NULL\n";
+                return;
+            }
+        }
     }
 
+    auto schema = RecordCodec::makeSchema(metaInfo, format, cmd.table);
+
     if(mode == Commands::IndexMode::HASH){
         globalHashUpdate.loadFromDisk(cmd.table);
     } else if(mode == Commands::IndexMode::BPLUSTREE){
@@ -192,8 +100,11 @@ void updateCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode)
     if(cmd.op == "="){
         cout << "[INFO] UPDATE: Finding records where " << cmd.whereColumn << " = " << cmd.whereValue1 << "\n";
         
-        if(mode == Commands::IndexMode::HASH){
-            offsetsToUpdate = globalHashUpdate.findRecord(cmd.whereColumn, cmd.whereValue1);
+        //a DICT value the column never held matches nothing
+        string whereKey;
+        bool known = indexValue(schema, findColumnIndex(metaInfo, cmd.whereColumn), mode, cmd.whereValue1, whereKey);
+        if(known && mode == Commands::IndexMode::HASH){
+            offsetsToUpdate = globalHashUpdate.findRecord(cmd.whereColumn, whereKey);
         } else if(mode == Commands::IndexMode::BPLUSTREE){
             string key = cmd.whereColumn + "##" + cmd.whereValue1;
             offsetsToUpdate = globalBPTreeUpdate.search(key);
@@ -220,30 +131,46 @@ void updateCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode)
         return;
     }
 
+    //file order, so the reads merge; and an offset listed twice is updated once
+    sort(offsetsToUpdate.begin(), offsetsToUpdate.end());
+    offsetsToUpdate.erase(unique(offsetsToUpdate.begin(), offsetsToUpdate.end()), offsetsToUpdate.end());
+
     int updatedCount = 0;
-    for(auto offset : offsetsToUpdate){
-        auto recordData = FileManager::readRecord(cmd.table, offset);
+    int failedCount = 0;   //rows left as they were, a new DICT value could not be written
+    Trace::StageTotal decodeTime("decode");
+    FileManager::readRecords(cmd.table, offsetsToUpdate, [&](size_t index, const vector<uint8_t> &recordData){
+        uint64_t offset = offsetsToUpdate[index];
         if(recordData.empty()){
-            continue;
+            return;
         }
 
-        vector<string> currentValues = decodeRecordValues(recordData, metaInfo);
+        vector<string> currentValues;
+        vector<bool> currentNulls;
+        decodeTime.begin();
+        RecordCodec::decodeValues(schema, recordData, currentValues, currentNulls);
+        decodeTime.end();
         
         vector<string> updatedValues = currentValues;
+        vector<bool> updatedNulls = currentNulls;
         for(auto &upd : updateMap){
             int colIdx = findColumnIndex(metaInfo, upd.first);
             if(colIdx != -1 && colIdx < (int)updatedValues.size()){
-                updatedValues[colIdx] = upd.second;
+                updatedNulls[colIdx] = updateNull[upd.first];
+                updatedValues[colIdx] = updatedNulls[colIdx] ? "" : upd.second;
             }
         }
-        map<string, pair<string, string>> indexChanges; // colName -> (oldVal, newVal)
+        vector<size_t> indexChanges; // columns whose value or NULL-ness changed
         for(size_t i = 0; i < metaInfo.size(); i++){
-            if(currentValues[i] != updatedValues[i]){
-                indexChanges[metaInfo[i].first] = {currentValues[i], updatedValues[i]};
+            if(currentValues[i] != updatedValues[i] || currentNulls[i] != updatedNulls[i]){
+                indexChanges.push_back(i);
             }
         }
-        auto newRecordData = encodeRecord(metaInfo, updatedValues);
-        
+        vector<uint8_t> newRecordData;
+        if(!RecordCodec::encode(schema, updatedValues, updatedNulls, newRecordData)){
+            failedCount++;
+            return;
+        }
+
         // Try to write updated record in-place
         // If it doesn't fit, append and mark old as deleted
         bool inPlaceSuccess = FileManager::overwriteRecord(cmd.table, offset, newRecordData);
@@ -255,40 +182,18 @@ void updateCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode)
             FileManager::markDeleted(cmd.table, offset);
 
             for(size_t i = 0; i < metaInfo.size(); i++){
-                string colName = metaInfo[i].first;
-                string oldVal = currentValues[i];
-                string newVal = updatedValues[i];
-                
-                if(mode == Commands::IndexMode::HASH){
-                    globalHashUpdate.deleteRecord(colName, oldVal, offset);
-                    globalHashUpdate.addRecord(colName, newVal, newOffset);
-                } else if(mode == Commands::IndexMode::BPLUSTREE){
-                    string oldKey = colName + "##" + oldVal;
-                    globalBPTreeUpdate.deleteRecord(oldKey, offset);
-                    string newKey = colName + "##" + newVal;
-                    globalBPTreeUpdate.insert(newKey, newOffset);
-                }
+                reindexColumn(mode, schema, i, metaInfo[i].first, currentValues[i], currentNulls[i], offset,
+                              updatedValues[i], updatedNulls[i], newOffset);
             }
         } else {
-            for(auto &change : indexChanges){
-                string colName = change.first;
-                string oldVal = change.second.first;
-                string newVal = change.second.second;
-
-                if(mode == Commands::IndexMode::HASH){
-                    globalHashUpdate.deleteRecord(colName, oldVal, offset);
-                    globalHashUpdate.addRecord(colName, newVal, offset);
-                } else if(mode == Commands::IndexMode::BPLUSTREE){
-                    string oldKey = colName + "##" + oldVal;
-                    globalBPTreeUpdate.deleteRecord(oldKey, offset);
-                    string newKey = colName + "##" + newVal;
-                    globalBPTreeUpdate.insert(newKey, offset);
-                }
+            for(size_t i : indexChanges){
+                reindexColumn(mode, schema, i, metaInfo[i].first, currentValues[i], currentNulls[i], offset,
+                              updatedValues[i], updatedNulls[i], offset);
             }
         }
 
         updatedCount++;
-    }
+    });
 
     if(mode == Commands::IndexMode::HASH){
         globalHashUpdate.saveToDisk(cmd.table);
@@ -296,5 +201,8 @@ void updateCmdExecute(const ParsedCommand &cmd, Commands::IndexMode mode)
         globalBPTreeUpdate.saveToDisk(cmd.table);
     }
 
+    if(failedCount > 0){
+        cout << "[ERROR] Cannot write the dictionary of a DICT column, " << failedCount << " record(s) not updated\n";
+    }
     cout << "[SUCCESS] Updated " << updatedCount << " record(s).\n";
 }
@@ -1,5 +1,10 @@
 #include "utils.h"
 #include <cctype>
+#include <iostream>
+#include "trace.h"
+#include "dictionary.h"
+#include "file_manager.h"
+#include "result_set.h"
 
 std::string trimSpaceC(const std::string &s){
     std::string sCopy = s;
@@ -16,4 +21,109 @@ std::string trimSpaceC(const std::string &s){
 
     return sCopy;
 
-}
\ No newline at end of file
+}
+
+void printRecord(const RecordCodec::Schema &schema, const std::vector<uint8_t> &recordData){
+    static thread_local std::vector<RecordCodec::Field> fields;
+    RecordCodec::decode(schema, recordData, fields);
+
+    for(size_t i = 0; i < fields.size(); i++){
+        std::cout << "| " << RecordCodec::toString(schema, recordData, fields[i], i) << " ";
+    }
+    std::cout << "\n";
+}
+
+bool makeProjection(const std::vector<std::string> &selectColumns, const std::vector<std::pair<std::string,std::string>> &metaInfo,
+                    Projection &projection){
+    projection.columns.clear();
+    projection.wanted.assign(metaInfo.size(), selectColumns.empty());
+
+    if(selectColumns.empty()){
+        for(size_t i = 0; i < metaInfo.size(); i++) projection.columns.push_back(i);
+        return true;
+    }
+
+    for(auto &name : selectColumns){
+        int column = findColumnIndex(metaInfo, name);
+        if(column < 0){
+            std::cout << "[ERROR] Column " << name << " not found\n";
+            return false;
+        }
+        projection.columns.push_back(column);
+        projection.wanted[column] = true;
+    }
+    return true;
+}
+
+void printRecord(const RecordCodec::Schema &schema, const std::vector<uint8_t> &recordData, const Projection &projection){
+    static thread_local std::vector<RecordCodec::Field> fields;
+    static thread_local std::string line;
+    RecordCodec::decode(schema, recordData, fields, projection.wanted);
+
+    line.clear();
+    formatRecord(schema, recordData, fields, projection, line);
+    std::cout << line;
+}
+
+void formatRecord(const RecordCodec::Schema &schema, const std::vector<uint8_t> &recordData, const std::vector<RecordCodec::Field> &fields,
+                  const Projection &projection, std::string &out){
+    for(int column : projection.columns){
+        out += "| ";
+        out += RecordCodec::toString(schema, recordData, fields[column], column);
+        out += " ";
+    }
+    out += "\n";
+}
+
+void outputRows(const std::string &table, const RecordCodec::Schema &schema, const Projection &projection, ResultSet *capture){
+    size_t workers = FileManager::scanThreads();
+
+    //records go out as stored, nothing to decode
+    if(capture){
+        std::vector<std::vector<std::vector<uint8_t>>> kept(workers);
+        FileManager::scanParallel(table, schema, std::vector<bool>(schema.types.size(), false),
+            [&](size_t worker, uint64_t, const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &){
+                kept[worker].push_back(bytes);
+            },
+            [&](size_t worker){
+                for(auto &record : kept[worker]) capture->records.push_back(std::move(record));
+                kept[worker].clear();
+            });
+        return;
+    }
+
+    std::vector<std::string> text(workers);
+    std::vector<Trace::StageTotal> decodeTime(workers, Trace::StageTotal("decode"));
+    FileManager::scanParallel(table, schema, projection.wanted,
+        [&](size_t worker, uint64_t, const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &fields){
+            decodeTime[worker].begin();
+            formatRecord(schema, bytes, fields, projection, text[worker]);
+            decodeTime[worker].end();
+        },
+        [&](size_t worker){
+            std::cout << text[worker];
+            text[worker].clear();
+        });
+}
+
+int findColumnIndex(const std::vector<std::pair<std::string,std::string>> &metaInfo, const std::string &colName){
+    for(size_t i = 0; i < metaInfo.size(); i++){
+        if(metaInfo[i].first == colName){
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool indexValue(const RecordCodec::Schema &schema, int column, Commands::IndexMode mode, const std::string &value, std::string &key){
+    key = value;
+    if(mode != Commands::IndexMode::HASH || column < 0 || column >= (int)schema.dicts.size()) return true;
+
+    Dictionary *dictionary = schema.dicts[column];
+    if(!dictionary) return true;
+
+    uint64_t code = 0;
+    if(!dictionary->find(value, code)) return false;
+    key = std::to_string(code);
+    return true;
+}
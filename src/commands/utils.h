@@ -1,6 +1,37 @@
 #pragma once
 #include<string>
+#include<vector>
+#include<cstdint>
+#include<utility>
+#include "record_codec.h"
+#include "commands.h"
+
+struct ResultSet;
 
 std::string trimSpaceC(const std::string &s);
+//one table row: "| value " per column, NULL fields print as NULL
+void printRecord(const RecordCodec::Schema &schema, const std::vector<uint8_t> &recordData);
+
+//SELECT column list as stored column positions, in the order asked for
+struct Projection{
+    std::vector<int> columns;
+    std::vector<bool> wanted;   //by stored position, what decode has to look at
+};
+//all columns for SELECT *; false (and prints the error) for an unknown column
+bool makeProjection(const std::vector<std::string> &selectColumns, const std::vector<std::pair<std::string,std::string>> &metaInfo,
+                    Projection &projection);
+//row with the projected columns only, the others are skipped without decoding
+void printRecord(const RecordCodec::Schema &schema, const std::vector<uint8_t> &recordData, const Projection &projection);
+//the same line for a row already decoded (at least projection.wanted), appended to out
+void formatRecord(const RecordCodec::Schema &schema, const std::vector<uint8_t> &recordData, const std::vector<RecordCodec::Field> &fields,
+                  const Projection &projection, std::string &out);
+//every live row of table in file order, printed or added to capture; rows are read and
+//formatted by FileManager::scanParallel, only the output itself is on this thread
+void outputRows(const std::string &table, const RecordCodec::Schema &schema, const Projection &projection, ResultSet *capture);
+//position of column in meta, -1 if the table has no such column
+int findColumnIndex(const std::vector<std::pair<std::string,std::string>> &metaInfo, const std::string &colName);
+//value as the index stores it: in hash mode DICT columns key on their code.
+//false when a DICT column never held value, so nothing can match it
+bool indexValue(const RecordCodec::Schema &schema, int column, Commands::IndexMode mode, const std::string &value, std::string &key);
 // std::string normalIntKey(const std::string &v);//for B+
 // std::string keyFIndex(const std::string &type, const std::string &value); //for B+
\ No newline at end of file
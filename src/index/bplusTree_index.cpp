@@ -3,11 +3,14 @@
 #include<iostream>
 #include<fstream>
 #include<filesystem>
+#include "trace.h"
+#include "metrics.h"
+#include "query_stats.h"
 
 namespace fs = std::filesystem;
 using namespace std;
 
-BPTreeNode::BPTreeNode(bool leaf): isLeaf(leaf),next(nullptr){
+BPTreeNode::BPTreeNode(bool leaf): isLeaf(leaf),next(nullptr),prev(nullptr){
     //order 4,max key 3,max child 3
     keys.reserve(3);
     if(leaf){
@@ -50,6 +53,7 @@ BPTreeNode* BPlusTreeIndex::findLeaf(const string &key){
 }
 
 void BPlusTreeIndex::insert(const string &key,uint64_t offset){
+    loadedStamp.forget();
 
     //first key
     if(root -> keys.empty()){
@@ -127,6 +131,8 @@ string BPlusTreeIndex::splitLeaf(BPTreeNode* leaf){
     leaf -> values.resize(mid);
 
     newLeaf -> next = leaf -> next;
+    newLeaf -> prev = leaf;
+    if(leaf -> next) leaf -> next -> prev = newLeaf;
     leaf -> next = newLeaf;
 
     return newLeaf -> keys[0];
@@ -158,6 +164,8 @@ void BPlusTreeIndex::insertIntoInternal(BPTreeNode* node, const string& key, BPT
 }
 
 vector<uint64_t> BPlusTreeIndex::search(const string &key){
+    Trace::Span span("index_probe");
+    QueryStats::usePlan("b+tree lookup");
     vector<uint64_t> results;
     
     if (!root) {
@@ -171,6 +179,7 @@ vector<uint64_t> BPlusTreeIndex::search(const string &key){
     }
     
     // Search for key in the leaf node
+    QueryStats::addIndexEntries(leaf->keys.size());
     for(size_t i = 0; i < leaf->keys.size(); i++){
         if(leaf->keys[i] == key){
             results.push_back(leaf->values[i]);
@@ -180,12 +189,53 @@ vector<uint64_t> BPlusTreeIndex::search(const string &key){
     return results;
 }
 
+vector<uint64_t> BPlusTreeIndex::searchMany(vector<string> keys){
+    Trace::Span span("index_probe");
+    QueryStats::usePlan("b+tree batched lookup");
+    vector<uint64_t> results;
+    if(!root || keys.empty()) return results;
+
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    BPTreeNode* leaf = nullptr;
+    for(const string &key : keys){
+        //descend again only when the key lies past the current leaf
+        if(!leaf || leaf -> keys.empty() || key > leaf -> keys.back()){
+            leaf = findLeaf(key);
+            //equal keys may start in earlier leaves
+            while(leaf && leaf -> prev && (leaf -> prev -> keys.empty() || leaf -> prev -> keys.back() >= key)){
+                leaf = leaf -> prev;
+            }
+        }
+
+        //equal keys may run on into the next leaves
+        for(; leaf != nullptr; leaf = leaf -> next){
+            bool past = false;
+            for(size_t i = 0; i < leaf -> keys.size(); i++){
+                QueryStats::addIndexEntries(1);
+                if(leaf -> keys[i] < key) continue;
+                if(leaf -> keys[i] > key){
+                    past = true;
+                    break;
+                }
+                results.push_back(leaf -> values[i]);
+            }
+            if(past || !leaf -> next) break;
+        }
+    }
+    return results;
+}
+
 vector<uint64_t> BPlusTreeIndex::rangeSearch(const string &low,const string &high){
+    Trace::Span span("index_probe");
+    QueryStats::usePlan("b+tree range");
     vector<uint64_t> allOffset;
     BPTreeNode* leaf = findLeaf(low);
 
     while(leaf != nullptr){
         for(int i =0;i< leaf -> keys.size();i++){
+            QueryStats::addIndexEntries(1);
             const string &key = leaf -> keys[i];
             if(key < low) continue;
             if(key > high) return allOffset;
@@ -196,7 +246,50 @@ vector<uint64_t> BPlusTreeIndex::rangeSearch(const string &low,const string &hig
     return allOffset;
 }
 
+vector<uint64_t> BPlusTreeIndex::orderedScan(const string &column, bool descending, size_t limit){
+    Trace::Span span("index_probe");
+    QueryStats::usePlan("b+tree order walk");
+    vector<uint64_t> offsets;
+    if(!root || limit == 0) return offsets;
+
+    //every key of the column sorts in [column##, column#$)
+    const string low = column + "##";
+    const string high = column + "#$";
+
+    if(!descending){
+        BPTreeNode* leaf = findLeaf(low);
+        //equal keys may start in earlier leaves
+        while(leaf && leaf -> prev && (leaf -> prev -> keys.empty() || leaf -> prev -> keys.back() >= low)){
+            leaf = leaf -> prev;
+        }
+        for(; leaf != nullptr; leaf = leaf -> next){
+            for(size_t i = 0; i < leaf -> keys.size(); i++){
+                QueryStats::addIndexEntries(1);
+                const string &key = leaf -> keys[i];
+                if(key < low) continue;
+                if(key >= high) return offsets;
+                offsets.push_back(leaf -> values[i]);
+                if(offsets.size() >= limit) return offsets;
+            }
+        }
+        return offsets;
+    }
+
+    for(BPTreeNode* leaf = findLeaf(high); leaf != nullptr; leaf = leaf -> prev){
+        for(size_t i = leaf -> keys.size(); i-- > 0;){
+            QueryStats::addIndexEntries(1);
+            const string &key = leaf -> keys[i];
+            if(key >= high) continue;
+            if(key < low) return offsets;
+            offsets.push_back(leaf -> values[i]);
+            if(offsets.size() >= limit) return offsets;
+        }
+    }
+    return offsets;
+}
+
 void BPlusTreeIndex::deleteRecord(const string &key, uint64_t offset){
+    loadedStamp.forget();
     if(!root){
         return;
     }
@@ -266,6 +359,10 @@ void BPlusTreeIndex::saveToDisk(const string &table) {
     
     saveNodeToDisk(out, root);
     out.close();
+
+    IndexFileStamp::fileChanged(filePath);
+    loadedStamp.remember(filePath);
+    Metrics::addIndexBytesWritten(fs::file_size(filePath));
 }
 
 BPTreeNode* BPlusTreeIndex::loadNodeFromDisk(ifstream& in) {
@@ -335,6 +432,7 @@ void BPlusTreeIndex::rebuildLeafLinks(BPTreeNode* node, BPTreeNode*& prevLeaf) {
         if (prevLeaf) {
             prevLeaf->next = node;
         }
+        node->prev = prevLeaf;
         prevLeaf = node;
         node->next = nullptr;  
     } else {
@@ -346,7 +444,16 @@ void BPlusTreeIndex::rebuildLeafLinks(BPTreeNode* node, BPTreeNode*& prevLeaf) {
 }
 
 void BPlusTreeIndex::loadFromDisk(const string &table) {
+    Trace::Span span("index_load");
     string filePath = "data/" + table + "/" + table + ".bptidx";
+
+    //same file as last time and nobody wrote it since
+    if (loadedStamp.matches(filePath)) {
+        Metrics::indexCacheHit();
+        return;
+    }
+    Metrics::indexCacheMiss();
+    loadedStamp.forget();
     
     ifstream in(filePath, ios::binary);
     if (!in) {
@@ -371,4 +478,13 @@ void BPlusTreeIndex::loadFromDisk(const string &table) {
     }
     
     in.close();
-}
\ No newline at end of file
+
+    loadedStamp.remember(filePath);
+    Metrics::addIndexBytesRead(fs::file_size(filePath));
+}
+
+void BPlusTreeIndex::releaseUnlessKept(){
+    if(loadedStamp.keep()) return;
+    delete root;
+    root = new BPTreeNode(true);
+}
@@ -3,6 +3,7 @@
 #include<vector>
 #include<cstdint>
 #include<fstream>
+#include "index_cache.h"
 
 class BPTreeNode;
 
@@ -29,6 +30,7 @@ class BPlusTreeIndex{
         void saveNodeToDisk(std::ofstream& out, BPTreeNode* node);
         BPTreeNode* loadNodeFromDisk(std::ifstream& in);
         void rebuildLeafLinks(BPTreeNode* node, BPTreeNode*& prevLeaf);
+        IndexFileStamp loadedStamp;   //skip reload while the file is unchanged
 
     public:
         BPlusTreeIndex();
@@ -36,10 +38,16 @@ class BPlusTreeIndex{
 
         void insert(const std::string &key, uint64_t offset);
         std::vector<uint64_t> search(const std::string &key);
+        //offsets of every key, probed in key order so nearby keys share a descent
+        std::vector<uint64_t> searchMany(std::vector<std::string> keys);
         std::vector<uint64_t> rangeSearch(const std::string &low, const std::string &high);
+        //offsets of one column's keys in key order, at most limit; descending walks the prev links
+        std::vector<uint64_t> orderedScan(const std::string &column, bool descending, size_t limit);
         void deleteRecord(const std::string &key, uint64_t offset);
         void saveToDisk(const std::string &tableName);
         void loadFromDisk(const std::string &tableName);
+        //after a command: free the loaded tree unless it fits IndexFileStamp's keep budget
+        void releaseUnlessKept();
 
 };
 
@@ -51,6 +59,7 @@ class BPTreeNode{
         std::vector<uint64_t> values;
         std::vector<BPTreeNode*> children;
         BPTreeNode* next;
+        BPTreeNode* prev;     //leaves only, for descending walks
 
         BPTreeNode(bool leaf = true);
         ~BPTreeNode();
@@ -3,6 +3,9 @@
 #include<fstream>
 #include<iostream>
 #include "utils.h"
+#include "trace.h"
+#include "metrics.h"
+#include "query_stats.h"
 
 
 using namespace std;
@@ -14,6 +17,7 @@ void HashIndex::addRecord(const string &col,const string &value,uint64_t offset)
     string trimmedCol = trimSpaceC(col);
 
     idx[trimmedCol][trimmedValue].push_back(offset);
+    loadedStamp.forget();
 
     //save like this
 
@@ -29,6 +33,8 @@ void HashIndex::addRecord(const string &col,const string &value,uint64_t offset)
 }
 
 vector<uint64_t> HashIndex::findRecord(const string &col, const string &value){
+    Trace::Span span("index_probe");
+    QueryStats::usePlan("hash lookup");
 
     //check column name and value exist or not
     string trimmedValue = trimSpaceC(value);
@@ -36,6 +42,7 @@ vector<uint64_t> HashIndex::findRecord(const string &col, const string &value){
     
     if(idx.count(trimmedCol) && idx[trimmedCol].count(trimmedValue)){
         //if exist return offset
+        QueryStats::addIndexEntries(idx[trimmedCol][trimmedValue].size());
         return idx[trimmedCol][trimmedValue]; 
     }
 
@@ -43,9 +50,27 @@ vector<uint64_t> HashIndex::findRecord(const string &col, const string &value){
 
 }
 
+vector<uint64_t> HashIndex::findRecords(const string &col, const vector<string> &values){
+    Trace::Span span("index_probe");
+    QueryStats::usePlan("hash batched lookup");
+    vector<uint64_t> offsets;
+
+    auto column = idx.find(trimSpaceC(col));
+    if(column == idx.end()) return offsets;
+
+    for(auto &value : values){
+        auto found = column->second.find(trimSpaceC(value));
+        if(found == column->second.end()) continue;
+        QueryStats::addIndexEntries(found->second.size());
+        offsets.insert(offsets.end(), found->second.begin(), found->second.end());
+    }
+    return offsets;
+}
+
 void HashIndex::deleteRecord(const string &col, const string &value, uint64_t offset){
     string trimmedValue = trimSpaceC(value);
     string trimmedCol = trimSpaceC(col);
+    loadedStamp.forget();
     
     // CHECK EXIST OR NOT
     if(idx.count(trimmedCol) && idx[trimmedCol].count(trimmedValue)){
@@ -104,14 +129,27 @@ void HashIndex::saveToDisk(const string &table){
     }
 
     indexRecord.close();
+
+    IndexFileStamp::fileChanged(filePath);
+    loadedStamp.remember(filePath);
+    Metrics::addIndexBytesWritten(fs::file_size(filePath));
 }
 
 void HashIndex::loadFromDisk(const string &table){
+    Trace::Span span("index_load");
+
+    string filePath = "data/" + table +"/" + table + ".hashidx";
+
+    //same file as last time and nobody wrote it since
+    if(loadedStamp.matches(filePath)){
+        Metrics::indexCacheHit();
+        return;
+    }
+    Metrics::indexCacheMiss();
 
     //we can rewrite it from file, so delete old data
     idx.clear();
-
-    string filePath = "data/" + table +"/" + table + ".hashidx";
+    loadedStamp.forget();
 
     if(!fs::exists(filePath)){
         cerr << "No hash index file found\n";
@@ -151,4 +189,12 @@ void HashIndex::loadFromDisk(const string &table){
 
     }
     indexRecordFile.close();
-}
\ No newline at end of file
+
+    loadedStamp.remember(filePath);
+    Metrics::addIndexBytesRead(fs::file_size(filePath));
+}
+
+void HashIndex::releaseUnlessKept(){
+    if(loadedStamp.keep()) return;
+    unordered_map<string,unordered_map<string,vector<uint64_t>>>().swap(idx);
+}
@@ -3,6 +3,7 @@
 #include<vector>
 #include<cstdint>
 #include<unordered_map>
+#include "index_cache.h"
 
 class HashIndex{
     public:
@@ -11,7 +12,14 @@ class HashIndex{
 
         void addRecord(const std::string &col, const std::string &value, uint64_t offset);
         std::vector<uint64_t> findRecord(const std::string &col, const std::string &value);
+        //offsets of every value, the column is looked up once
+        std::vector<uint64_t> findRecords(const std::string &col, const std::vector<std::string> &values);
         void deleteRecord(const std::string &col, const std::string &value, uint64_t offset);
         void saveToDisk(const std::string &table);
         void loadFromDisk(const std::string &table);
+        //after a command: free the loaded copy unless it fits IndexFileStamp's keep budget
+        void releaseUnlessKept();
+
+    private:
+        IndexFileStamp loadedStamp;   //skip reload while the file is unchanged
 };
\ No newline at end of file
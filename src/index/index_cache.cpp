@@ -0,0 +1,97 @@
+#include "index_cache.h"
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static mutex generationMutex;
+static unordered_map<string, uint64_t> fileGenerations;
+
+static atomic<uintmax_t> keptTotal{0};
+
+static uint64_t currentGeneration(const string &filePath){
+    lock_guard<mutex> guard(generationMutex);
+    auto it = fileGenerations.find(filePath);
+    return it == fileGenerations.end() ? 0 : it->second;
+}
+
+void IndexFileStamp::fileChanged(const string &filePath){
+    lock_guard<mutex> guard(generationMutex);
+    fileGenerations[filePath]++;
+}
+
+bool IndexFileStamp::matches(const string &filePath) const{
+    if(!valid || path != filePath) return false;
+    if(generation != currentGeneration(filePath)) return false;
+
+    error_code ec;
+    auto fileSize = fs::file_size(filePath, ec);
+    if(ec || fileSize != size) return false;
+
+    auto fileTime = fs::last_write_time(filePath, ec);
+    return !ec && fileTime == mtime;
+}
+
+//a copy never holds the original's share of the budget
+IndexFileStamp::IndexFileStamp(const IndexFileStamp &other)
+    : valid(other.valid), path(other.path), generation(other.generation), size(other.size), mtime(other.mtime){}
+
+IndexFileStamp& IndexFileStamp::operator=(const IndexFileStamp &other){
+    if(this == &other) return *this;
+    releaseKept();
+    valid = other.valid;
+    path = other.path;
+    generation = other.generation;
+    size = other.size;
+    mtime = other.mtime;
+    return *this;
+}
+
+IndexFileStamp::~IndexFileStamp(){
+    releaseKept();
+}
+
+void IndexFileStamp::releaseKept(){
+    if(keptBytes == 0) return;
+    keptTotal -= keptBytes;
+    keptBytes = 0;
+}
+
+bool IndexFileStamp::keep(){
+    if(!valid) return false;
+    if(keptBytes == size && size != 0) return true;
+
+    releaseKept();
+    uintmax_t total = keptTotal.load();
+    while(total + size <= KEEP_BUDGET){
+        if(keptTotal.compare_exchange_weak(total, total + size)){
+            keptBytes = size;
+            return true;
+        }
+    }
+    forget();
+    return false;
+}
+
+void IndexFileStamp::remember(const string &filePath){
+    releaseKept();
+    error_code ec;
+    size = fs::file_size(filePath, ec);
+    if(!ec) mtime = fs::last_write_time(filePath, ec);
+    if(ec){
+        forget();
+        return;
+    }
+
+    path = filePath;
+    generation = currentGeneration(filePath);
+    valid = true;
+}
+
+void IndexFileStamp::forget(){
+    releaseKept();
+    valid = false;
+    path.clear();
+}
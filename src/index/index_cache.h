@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <filesystem>
+
+/*
+  Lets an index instance skip reloading its file when nothing changed.
+
+  Every save in this process bumps a generation counter for that file, and
+  the file size and mtime catch changes made by another process. An index
+  forgets its stamp as soon as it is modified in memory, so unsaved changes
+  are never mistaken for the file contents.
+
+  Every client thread keeps its own SELECT and join indexes, so what they
+  keep between commands is capped: keep() takes the file's size out of
+  KEEP_BUDGET, shared by all threads, and a copy that does not fit is freed
+  after its command. Per table metadata (dictionaries, zone maps, segment
+  directories) is dropped once a thread holds more than CACHED_TABLES tables.
+*/
+class IndexFileStamp{
+    private:
+        bool valid = false;
+        std::string path;
+        uint64_t generation = 0;
+        std::uintmax_t size = 0;
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t keptBytes = 0;   //share of KEEP_BUDGET
+
+        void releaseKept();
+
+    public:
+        //index file bytes whose loaded copies stay between commands, all threads together
+        static const std::uintmax_t KEEP_BUDGET = 32 * 1024 * 1024;
+        //tables whose metadata one thread keeps loaded between commands
+        static const size_t CACHED_TABLES = 8;
+
+        IndexFileStamp() = default;
+        IndexFileStamp(const IndexFileStamp &other);
+        IndexFileStamp& operator=(const IndexFileStamp &other);
+        ~IndexFileStamp();
+
+        //true when the loaded copy still matches the file at path
+        bool matches(const std::string &filePath) const;
+        //call after loading or saving filePath
+        void remember(const std::string &filePath);
+        void forget();
+        //after a command: true when the loaded copy fits the keep budget and may stay,
+        //otherwise the stamp is forgotten and the owner frees the copy
+        bool keep();
+
+        //called by every save so other instances reload
+        static void fileChanged(const std::string &filePath);
+};
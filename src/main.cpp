@@ -1,12 +1,20 @@
 #include "commands.h"
 #include "parser.h"
+#include "trace.h"
 
 #include <iostream>
 #include <algorithm>
 
 using namespace std;
 
-int main(){
+int main(int argc, char** argv){
+    //optional: ./picodb --trace trace.json
+    string traceFilePath;
+    if(argc > 2 && string(argv[1]) == "--trace"){
+        traceFilePath = argv[2];
+        Trace::setEnabled(true);
+    }
+
     cout << "=============================================\n";
     cout << "              PicoDB - File Database         \n";
     cout << "=============================================\n";
@@ -59,9 +67,14 @@ int main(){
             continue;
         }
 
+        Trace::QueryScope traceScope(inputLine);
         Commands::execute(cmd);
     }
 
+    if(!traceFilePath.empty() && Trace::dumpChromeTrace(traceFilePath)){
+        cout << "[INFO] Trace written to " << traceFilePath << "\n";
+    }
+
     cout << "=============================================\n";
     cout << "              Thank you for using PicoDB     \n";
     cout << "=============================================\n";
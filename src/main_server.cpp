@@ -6,11 +6,19 @@
 #include "server/server_socket.h"
 #include "server/client_handler.h"
 #include "server/lock_manager.h"
+#include "server/metrics_http.h"
+#include "server/output_capture.h"
 #include "parser/parser.h"
 #include "commands/commands.h"
+#include "stats/trace.h"
+#include "stats/query_stats.h"
+#include "storage/async_io.h"
+#include "storage/file_manager.h"
 
 bool serverShouldKeepRunning = true;
 ServerSocket* globalServer = nullptr;
+volatile sig_atomic_t traceDumpRequested = 0;
+std::string traceFilePath;
 
 void handleShutdownSignal(int signalNumber) {
     std::cout << "\nStopping server (signal " << signalNumber << ")" << std::endl;
@@ -22,7 +30,18 @@ void handleShutdownSignal(int signalNumber) {
     }
 }
 
-void printServerBanner(int port) {
+// SIGUSR1: write the trace file without stopping the server
+void handleTraceDumpSignal(int) {
+    traceDumpRequested = 1;
+}
+
+void dumpTrace() {
+    if (!traceFilePath.empty() && Trace::dumpChromeTrace(traceFilePath)) {
+        std::cout << "Trace written to " << traceFilePath << std::endl;
+    }
+}
+
+void printServerBanner(int port, const std::string& unixPath) {
     std::cout << "\n";
     std::cout << "╔════════════════════════════════════════════╗\n";
     std::cout << "║                                            ║\n";
@@ -32,34 +51,146 @@ void printServerBanner(int port) {
     std::cout << "╚════════════════════════════════════════════╝\n";
     std::cout << "\n";
     std::cout << "Server Port: " << port << "\n";
+    if (!unixPath.empty()) {
+        std::cout << "Unix Socket: " << unixPath << "\n";
+    }
     std::cout << "Press Ctrl+C to shutdown\n";
     std::cout << "\n";
 }
 
 void printServerUsage() {
-    std::cout << "Usage: ./picodb_server [port]" << std::endl;
-    std::cout << "Example: ./picodb_server 8080" << std::endl;
+    std::cout << "Usage: ./picodb_server [port] [--unix socket_path] [--trace trace.json] [--metrics-port port]" << std::endl;
+    std::cout << "                      [--slow-us microseconds] [--slow-log file] [--io-depth n]" << std::endl;
+    std::cout << "                      [--scan-threads n]" << std::endl;
+    std::cout << "Example: ./picodb_server 8080 --unix /tmp/picodb.sock" << std::endl;
     std::cout << "If no port is given, default port 8080 is used." << std::endl;
+    std::cout << "--unix also accepts same-host clients on a Unix domain socket." << std::endl;
+    std::cout << "--trace records per-stage query timings (Chrome trace format)," << std::endl;
+    std::cout << "        written on shutdown or when the server gets SIGUSR1." << std::endl;
+    std::cout << "--metrics-port serves Prometheus metrics at http://host:port/metrics." << std::endl;
+    std::cout << "STATS shows the same numbers from any client." << std::endl;
+    std::cout << "--slow-us logs queries slower than the threshold with their plan and I/O" << std::endl;
+    std::cout << "          (to --slow-log file, default stderr; --slow-log alone means 100000 us)." << std::endl;
+    std::cout << "--io-depth sets the io_uring queue depth of record reads (default 64, 0 = pread)." << std::endl;
+    std::cout << "--scan-threads caps the threads of full-table scans, shared by all connections (default: all cores)." << std::endl;
     std::cout << std::endl;
 }
 
 int main(int argc, char** argv) {
     int serverPort = 8080;  
+    std::string unixSocketPath;
+    int metricsPort = 0;
+    long long slowThresholdUs = -1;
+    std::string slowLogPath;
     
-    if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        
+        if (arg == "--unix") {
+            if (i + 1 >= argc) {
+                std::cerr << "ERROR: --unix needs a socket path" << std::endl;
+                return 1;
+            }
+            unixSocketPath = argv[++i];
+            continue;
+        }
+        
+        if (arg == "--trace") {
+            if (i + 1 >= argc) {
+                std::cerr << "ERROR: --trace needs a file path" << std::endl;
+                return 1;
+            }
+            traceFilePath = argv[++i];
+            Trace::setEnabled(true);
+            continue;
+        }
+        
+        if (arg == "--slow-us" || arg == "--slow-log") {
+            if (i + 1 >= argc) {
+                std::cerr << "ERROR: " << arg << " needs a value" << std::endl;
+                return 1;
+            }
+            std::string value = argv[++i];
+            if (arg == "--slow-log") {
+                slowLogPath = value;
+                continue;
+            }
+            try {
+                slowThresholdUs = std::stoll(value);
+            } catch (...) {
+                slowThresholdUs = -1;
+            }
+            if (slowThresholdUs < 0) {
+                std::cerr << "ERROR: Invalid --slow-us value: " << value << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        
+        if (arg == "--io-depth") {
+            int depth = -1;
+            if (i + 1 < argc) {
+                try {
+                    depth = std::stoi(argv[++i]);
+                } catch (...) {
+                    depth = -1;
+                }
+            }
+            if (depth < 0 || depth > 4096) {
+                std::cerr << "ERROR: --io-depth needs a value between 0 and 4096" << std::endl;
+                return 1;
+            }
+            AsyncIO::setQueueDepth(depth);
+            continue;
+        }
+
+        if (arg == "--scan-threads") {
+            int threads = 0;
+            if (i + 1 < argc) {
+                try {
+                    threads = std::stoi(argv[++i]);
+                } catch (...) {
+                    threads = 0;
+                }
+            }
+            if (threads < 1 || threads > 256) {
+                std::cerr << "ERROR: --scan-threads needs a value between 1 and 256" << std::endl;
+                return 1;
+            }
+            FileManager::setScanThreads(threads);
+            continue;
+        }
+
+        if (arg == "--metrics-port") {
+            if (i + 1 >= argc) {
+                std::cerr << "ERROR: --metrics-port needs a port number" << std::endl;
+                return 1;
+            }
+            try {
+                metricsPort = std::stoi(argv[++i]);
+            } catch (...) {
+                metricsPort = -1;
+            }
+            if (metricsPort < 1024 || metricsPort > 65535) {
+                std::cerr << "ERROR: Metrics port must be between 1024 and 65535" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+        
         try {
-            serverPort = std::stoi(argv[1]);
+            serverPort = std::stoi(arg);
             if (serverPort < 1024 || serverPort > 65535) {
                 std::cerr << "ERROR: Port must be between 1024 and 65535" << std::endl;
                 return 1;
             }
         } catch (...) {
-            std::cerr << "ERROR: Invalid port number: " << argv[1] << std::endl;
+            std::cerr << "ERROR: Invalid port number: " << arg << std::endl;
             return 1;
         }
     }
 
-    printServerBanner(serverPort);
+    printServerBanner(serverPort, unixSocketPath);
     printServerUsage();
     std::cout << "Choose index mode:" << std::endl;
     std::cout << "1. Hash" << std::endl;
@@ -88,6 +219,7 @@ int main(int argc, char** argv) {
     
     signal(SIGINT, handleShutdownSignal);  
     signal(SIGTERM, handleShutdownSignal);  
+    signal(SIGUSR1, handleTraceDumpSignal);
     
     ServerSocket server(serverPort);
     globalServer = &server;
@@ -97,7 +229,26 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    if (!unixSocketPath.empty() && !server.initializeUnixSocket(unixSocketPath)) {
+        std::cerr << "FATAL ERROR: Failed to open unix socket!" << std::endl;
+        return 1;
+    }
+    
+    if (slowThresholdUs >= 0 || !slowLogPath.empty()) {
+        SlowQueryLog::configure(slowThresholdUs >= 0 ? slowThresholdUs : 100000, slowLogPath);
+    }
+    
+    MetricsHttpServer metricsServer(metricsPort);
+    if (metricsPort > 0) {
+        if (!metricsServer.start()) {
+            std::cerr << "FATAL ERROR: Failed to start metrics endpoint!" << std::endl;
+            return 1;
+        }
+        std::cout << "Metrics endpoint: http://0.0.0.0:" << metricsPort << "/metrics" << std::endl;
+    }
+    
     LockManager lockManager;
+    OutputCapture::install();
 
     Parser sqlParser;
     // Main loop: accept one client and run one thread
@@ -108,6 +259,12 @@ int main(int argc, char** argv) {
     
     while (serverShouldKeepRunning) {
         int clientFd = server.acceptClientConnection();
+        
+        if (traceDumpRequested) {
+            traceDumpRequested = 0;
+            dumpTrace();
+        }
+        
         if (clientFd < 0) {
             if (serverShouldKeepRunning) {
                 std::cerr << "WARNING: Failed to accept client connection" << std::endl;
@@ -143,6 +300,8 @@ int main(int argc, char** argv) {
     std::cout << "\nServer summary:" << std::endl;
     std::cout << "Total clients served: " << clientCounter << std::endl;
     lockManager.printLockStatus();
+    dumpTrace();
+    metricsServer.stop();
     
     std::cout << "\nServer shutdown complete." << std::endl;
     
@@ -19,6 +19,36 @@ static std::string trimSpace(std::string input){
 
 }
 
+//unquoted NULL, any case
+static bool isNullLiteral(const std::string &value){
+    std::string upper = value;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    return upper == "NULL";
+}
+
+//"id, name" -> selectColumns {"id","name"}, "*" -> {}, "COUNT(*), SUM(x)" -> aggregates
+static void parseColumnList(const std::string &list, ParsedCommand &cmd){
+    static const std::regex aggregateRegex(R"((COUNT|SUM|AVG|MIN|MAX)\s*\(\s*(\*|\w+)\s*\))",std::regex::icase);
+    std::stringstream allColumns(list);
+    std::string column;
+    std::smatch call;
+    bool all = false;
+
+    while(getline(allColumns,column,',')){
+        column = trimSpace(column);
+        if(std::regex_match(column,call,aggregateRegex)){
+            std::string function = call[1].str();
+            std::transform(function.begin(), function.end(), function.begin(), ::toupper);
+            cmd.aggregates.push_back({function, call[2].str()});
+        }else if(column == "*"){
+            all = true;
+        }else if(!column.empty()){
+            cmd.selectColumns.push_back(column);
+        }
+    }
+    if(all) cmd.selectColumns.clear();
+}
+
 ParsedCommand Parser::parse(const std::string &input){
     ParsedCommand cmd;
     std::string inputWithoutSpace = trimSpace(input);
@@ -44,7 +74,7 @@ ParsedCommand Parser::parse(const std::string &input){
 
         cmd.type = "CREATE";
         //regular expression for CREATE TABLE student(field etc)
-        std::regex re(R"(CREATE\s+TABLE\s+(\w+)\s*\((.*)\)\s*;*)", std::regex::icase);
+        static const std::regex re(R"(CREATE\s+TABLE\s+(\w+)\s*\((.*)\)\s*;*)", std::regex::icase);
         
         //separate table name and column info
         std::smatch target;
@@ -64,8 +94,8 @@ ParsedCommand Parser::parse(const std::string &input){
 
             separteColumn = trimSpace(separteColumn);
 
-            //regex for meta info (w+) -> variable name, (w+) -> type, (primary) -> for key optional(?)
-            std::regex metaInfo(R"((\w+)\s+(\w+)(\s+PRIMARY)?)",std::regex::icase);
+            //regex for meta info (w+) -> variable name, (w+) -> type, (dict) -> dictionary encoded text, (primary) -> for key optional(?)
+            static const std::regex metaInfo(R"((\w+)\s+(\w+)(\s+DICT)?(\s+PRIMARY)?)",std::regex::icase);
 
             std::smatch metaNameType;
 
@@ -74,8 +104,19 @@ ParsedCommand Parser::parse(const std::string &input){
                 std::string columnName = trimSpace(metaNameType[1].str());
                 std::string columnType = trimSpace(metaNameType[2].str());
 
-                std::string checkPrim;
                 if(metaNameType[3].matched){
+                    std::string upperType = columnType;
+                    std::transform(upperType.begin(), upperType.end(), upperType.begin(), ::toupper);
+                    if(upperType == "INT" || upperType == "FLOAT" || upperType == "BOOL"){
+                        cmd.isValid = false;
+                        cmd.error = "DICT is only for TEXT columns";
+                        return cmd;
+                    }
+                    columnType = "DICT";
+                }
+
+                std::string checkPrim;
+                if(metaNameType[4].matched){
                     checkPrim = "PRIMARY";
                 }else{
                     checkPrim = "";
@@ -95,7 +136,7 @@ ParsedCommand Parser::parse(const std::string &input){
         cmd.type = "INSERT";
 
         //regex for insert command
-        std::regex regXInsert(R"(INSERT\s+INTO\s+(\w+)\s*VALUES\s*\((.*)\)\s*;*)",std::regex::icase);
+        static const std::regex regXInsert(R"(INSERT\s+INTO\s+(\w+)\s*VALUES\s*\((.*)\)\s*;*)",std::regex::icase);
 
         std::smatch insertInfo;
         if(!std::regex_search(inputWithoutSpace,insertInfo,regXInsert)){
@@ -112,6 +153,7 @@ ParsedCommand Parser::parse(const std::string &input){
 
         while(getline(allValues,separateValue,',')){
             separateValue = trimSpace(separateValue);
+            cmd.nullValues.push_back(isNullLiteral(separateValue));
 
             // Remove surrounding quotes (both double quotes " and single quotes ')
             if(separateValue.size() >=2){
@@ -125,13 +167,42 @@ ParsedCommand Parser::parse(const std::string &input){
         return cmd;
     }
 
+    //cmd: STATS;
+    if(upperCaseInput.rfind("STATS",0) == 0){
+        cmd.type = "STATS";
+        static const std::regex statsRegex(R"(STATS\s*;*)",std::regex::icase);
+        if(!std::regex_match(inputWithoutSpace,statsRegex)){
+            cmd.isValid = false;
+            cmd.error = "STATS syntax";
+        }
+        return cmd;
+    }
+
+    //cmd: SEAL TABLE tableName [COLUMNAR]; OR SEAL tableName [COLUMNAR];
+    if(upperCaseInput.rfind("SEAL",0) == 0){
+        cmd.type = "SEAL";
+
+        static const std::regex sealRegex(R"(SEAL\s+(TABLE\s+)?(\w+)(\s+COLUMNAR)?\s*;*)",std::regex::icase);
+        std::smatch sealInfo;
+
+        if(!std::regex_match(inputWithoutSpace,sealInfo,sealRegex)){
+            cmd.isValid = false;
+            cmd.error = "SEAL syntax";
+            return cmd;
+        }
+
+        cmd.table = trimSpace(sealInfo[2].str());
+        cmd.columnar = sealInfo[3].matched;
+        return cmd;
+    }
+
     //cmd: SHOW TABLE tableName; OR SHOW tableName;
 
     if(upperCaseInput.rfind("SHOW TABLE",0)==0 || upperCaseInput.rfind("SHOW",0)==0){
 
         cmd.type = "SHOW";
 
-        std::regex showRegex(R"(SHOW\s+(TABLE\s+)?(\w+)\s*;*)",std::regex::icase);
+        static const std::regex showRegex(R"(SHOW\s+(TABLE\s+)?(\w+)\s*;*)",std::regex::icase);
         std::smatch showInfo;
 
         if(!std::regex_search(inputWithoutSpace,showInfo,showRegex)){
@@ -146,22 +217,116 @@ ParsedCommand Parser::parse(const std::string &input){
     }
 
     //cmd: SELECT * FROM tableName WHERE column op value;
-    //cmd: SELECT * FROM tableName WHERE column between value1 AND value2;(later implement)
+    //cmd: SELECT * FROM tableName WHERE column between value1 AND value2;
+    //cmd: SELECT COUNT(*), AVG(col) FROM tableName;
+    //cmd: SELECT dept, COUNT(*) FROM tableName [WHERE ...] GROUP BY dept;
+    //cmd: SELECT * FROM tableName [WHERE ...] ORDER BY col [ASC|DESC] LIMIT n;
+    //cmd: SELECT a.x, b.y FROM a JOIN b ON a.id = b.aid;
+    //cmd: SELECT * FROM tableName WHERE column IN (value1, value2, ...);
 
     if(upperCaseInput.rfind("SELECT",0) == 0){
         cmd.type = "SELECT";
 
         //Regxe for search with between keyword
-        std::regex regXBetween(R"(SELECT\s+(.*)\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s+BETWEEN\s+(\S+)\s+AND\s+(\S+))",std::regex::icase);
+        static const std::regex regXBetween(R"(SELECT\s+(.*)\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s+BETWEEN\s+(\S+)\s+AND\s+(\S+))",std::regex::icase);
 
         //Regex for search with equal sign
-        std::regex regXEqual(R"(SELECT\s+(.*)\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s*=\s*(\S+))",std::regex::icase);
+        static const std::regex regXEqual(R"(SELECT\s+(.*)\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s*=\s*(\S+))",std::regex::icase);
+
+        //Regex for a list of values
+        static const std::regex regXIn(R"(SELECT\s+(.*)\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s+IN\s*\((.*)\)\s*;*)",std::regex::icase);
+
+        //Regex for an equi join of two tables
+        static const std::regex regXJoin(R"(SELECT\s+(.*)\s+FROM\s+(\w+)\s+(INNER\s+)?JOIN\s+(\w+)\s+ON\s+(\w+)\.(\w+)\s*=\s*(\w+)\.(\w+)\s*;*)",std::regex::icase);
+
+        //Regex for every row of the table
+        static const std::regex regXAll(R"(SELECT\s+(.*)\s+FROM\s+(\w+)\s*;*)",std::regex::icase);
 
         std::smatch searchInfoCmd;
 
+        //LIMIT, ORDER BY and GROUP BY close the statement in that order from the end,
+        //take them off so the WHERE forms below still match
+        static const std::regex regXLimit(R"(\s+LIMIT\s+(\d+)\s*;*\s*$)",std::regex::icase);
+        if(std::regex_search(inputWithoutSpace,searchInfoCmd,regXLimit)){
+            try{ cmd.limit = std::stoll(searchInfoCmd[1].str()); }catch(...){}
+            inputWithoutSpace = searchInfoCmd.prefix().str();
+        }
+
+        static const std::regex regXOrder(R"(\s+ORDER\s+BY\s+(\w+(?:\.\w+)?)(\s*\(\s*(\*|\w+)\s*\))?(\s+(ASC|DESC))?\s*;*\s*$)",std::regex::icase);
+        if(std::regex_search(inputWithoutSpace,searchInfoCmd,regXOrder)){
+            cmd.orderBy = searchInfoCmd[1].str();
+            if(searchInfoCmd[2].matched){
+                //same spelling as the aggregate's result column
+                std::transform(cmd.orderBy.begin(), cmd.orderBy.end(), cmd.orderBy.begin(), ::toupper);
+                cmd.orderBy += "(" + searchInfoCmd[3].str() + ")";
+            }
+            std::string direction = searchInfoCmd[5].str();
+            std::transform(direction.begin(), direction.end(), direction.begin(), ::toupper);
+            cmd.orderDescending = direction == "DESC";
+            inputWithoutSpace = searchInfoCmd.prefix().str();
+        }
+
+        static const std::regex regXGroup(R"(\s+GROUP\s+BY\s+([\w\s,]+?)\s*;*\s*$)",std::regex::icase);
+        if(std::regex_search(inputWithoutSpace,searchInfoCmd,regXGroup)){
+            std::stringstream allColumns(searchInfoCmd[1].str());
+            std::string column;
+            while(getline(allColumns,column,',')){
+                column = trimSpace(column);
+                if(!column.empty()) cmd.groupBy.push_back(column);
+            }
+            inputWithoutSpace = searchInfoCmd.prefix().str();
+        }
+
+        if(std::regex_match(inputWithoutSpace,searchInfoCmd,regXJoin)){
+
+            parseColumnList(searchInfoCmd[1].str(), cmd);
+            cmd.table = searchInfoCmd[2].str();
+            cmd.joinTable = searchInfoCmd[4].str();
+
+            //ON may name the tables in either order
+            if(searchInfoCmd[5].str() == cmd.table && searchInfoCmd[7].str() == cmd.joinTable){
+                cmd.joinLeftColumn = searchInfoCmd[6].str();
+                cmd.joinRightColumn = searchInfoCmd[8].str();
+            }else if(searchInfoCmd[5].str() == cmd.joinTable && searchInfoCmd[7].str() == cmd.table){
+                cmd.joinLeftColumn = searchInfoCmd[8].str();
+                cmd.joinRightColumn = searchInfoCmd[6].str();
+            }else{
+                cmd.isValid = false;
+                cmd.error = "JOIN ... ON must compare a column of each table";
+            }
+            return cmd;
+        }
+
+        if(std::regex_match(inputWithoutSpace,searchInfoCmd,regXIn)){
+
+            parseColumnList(searchInfoCmd[1].str(), cmd);
+            cmd.table = trimSpace(searchInfoCmd[2].str());
+            cmd.whereColumn = trimSpace(searchInfoCmd[3].str());
+
+            std::stringstream allValues(searchInfoCmd[4].str());
+            std::string value;
+            while(getline(allValues,value,',')){
+                value = trimSpace(value);
+                //NULL never matches, like = NULL
+                if(value.empty() || isNullLiteral(value)) continue;
+
+                // Remove surrounding quotes (both single and double)
+                if(value.size() >= 2){
+                    if((value.front() == '"' && value.back() == '"') ||
+                       (value.front() == '\'' && value.back() == '\'')){
+                        value = value.substr(1,value.size()-2);
+                    }
+                }
+                cmd.whereValues.push_back(value);
+            }
+            cmd.op = "IN";
+            return cmd;
+        }
+
         //between
         if(std::regex_search(inputWithoutSpace,searchInfoCmd,regXBetween)){
 
+            parseColumnList(searchInfoCmd[1].str(), cmd);
             cmd.table = trimSpace(searchInfoCmd[2].str());
             cmd.whereColumn = trimSpace(searchInfoCmd[3].str());
             std::string value1 = trimSpace(searchInfoCmd[4].str());
@@ -192,6 +357,7 @@ ParsedCommand Parser::parse(const std::string &input){
             return cmd;
         }else if(std::regex_search(inputWithoutSpace,searchInfoCmd,regXEqual)){//equal
             
+            parseColumnList(searchInfoCmd[1].str(), cmd);
             cmd.table = trimSpace(searchInfoCmd[2].str());
             cmd.whereColumn = trimSpace(searchInfoCmd[3].str());
             std::string value1 = trimSpace(searchInfoCmd[4].str());
@@ -211,6 +377,12 @@ ParsedCommand Parser::parse(const std::string &input){
             cmd.op = "=";
             return cmd;
             
+        }else if(std::regex_match(inputWithoutSpace,searchInfoCmd,regXAll)){
+
+            parseColumnList(searchInfoCmd[1].str(), cmd);
+            cmd.table = trimSpace(searchInfoCmd[2].str());
+            return cmd;
+
         }else{
 
             cmd.isValid = false;
@@ -226,8 +398,8 @@ ParsedCommand Parser::parse(const std::string &input){
     if(upperCaseInput.rfind("UPDATE",0) == 0){
         cmd.type = "UPDATE";
         
-        std::regex regXBetween(R"(UPDATE\s+(\w+)\s+SET\s+(.*)\s+WHERE\s+(\w+)\s+BETWEEN\s+(\S+)\s+AND\s+(\S+))",std::regex::icase);
-        std::regex regXEqual(R"(UPDATE\s+(\w+)\s+SET\s+(.*)\s+WHERE\s+(\w+)\s*=\s*(\S+))",std::regex::icase);
+        static const std::regex regXBetween(R"(UPDATE\s+(\w+)\s+SET\s+(.*)\s+WHERE\s+(\w+)\s+BETWEEN\s+(\S+)\s+AND\s+(\S+))",std::regex::icase);
+        static const std::regex regXEqual(R"(UPDATE\s+(\w+)\s+SET\s+(.*)\s+WHERE\s+(\w+)\s*=\s*(\S+))",std::regex::icase);
 
         std::smatch updateInfoCmd;
         if(std::regex_search(inputWithoutSpace,updateInfoCmd,regXBetween)){//between
@@ -265,8 +437,10 @@ ParsedCommand Parser::parse(const std::string &input){
                 while(setPos < setClause.size() && isspace(setClause[setPos])) setPos++;
                 
                 std::string colValue;
+                bool quoted = false;
                 // Handle both single and double quotes
                 if(setPos < setClause.size() && (setClause[setPos] == '"' || setClause[setPos] == '\'')){
+                    quoted = true;
                     char quoteChar = setClause[setPos];
                     setPos++; 
                     size_t closeQuote = setClause.find(quoteChar, setPos);
@@ -289,6 +463,7 @@ ParsedCommand Parser::parse(const std::string &input){
                 
                 cmd.columns.push_back({colName, ""});
                 cmd.values.push_back(colValue);
+                cmd.nullValues.push_back(!quoted && isNullLiteral(colValue));
             }
             
             return cmd;
@@ -320,8 +495,10 @@ ParsedCommand Parser::parse(const std::string &input){
                 while(setPos < setClause.size() && isspace(setClause[setPos])) setPos++;
                 
                 std::string colValue;
+                bool quoted = false;
                 // Handle both single and double quotes
                 if(setPos < setClause.size() && (setClause[setPos] == '"' || setClause[setPos] == '\'')){
+                    quoted = true;
                     char quoteChar = setClause[setPos];
                     setPos++; 
                     size_t closeQuote = setClause.find(quoteChar, setPos);
@@ -343,6 +520,7 @@ ParsedCommand Parser::parse(const std::string &input){
                 
                 cmd.columns.push_back({colName, ""});
                 cmd.values.push_back(colValue);
+                cmd.nullValues.push_back(!quoted && isNullLiteral(colValue));
             }
             
             return cmd;
@@ -362,8 +540,8 @@ ParsedCommand Parser::parse(const std::string &input){
     if(upperCaseInput.rfind("DELETE",0) == 0){
         cmd.type = "DELETE";
         
-        std::regex regXBetween(R"(DELETE\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s+BETWEEN\s+(\S+)\s+AND\s+(\S+))",std::regex::icase);
-        std::regex regXEqual(R"(DELETE\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s*=\s*(\S+))",std::regex::icase);
+        static const std::regex regXBetween(R"(DELETE\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s+BETWEEN\s+(\S+)\s+AND\s+(\S+))",std::regex::icase);
+        static const std::regex regXEqual(R"(DELETE\s+FROM\s+(\w+)\s+WHERE\s+(\w+)\s*=\s*(\S+))",std::regex::icase);
 
         std::smatch deleteInfoCmd;
         if(std::regex_search(inputWithoutSpace,deleteInfoCmd,regXBetween)){//between
@@ -3,6 +3,12 @@
 #include <vector>
 #include<utility>
 
+//COUNT(*), COUNT(col), SUM(col), AVG(col), MIN(col), MAX(col) in a SELECT list
+struct AggregateCall{
+    std::string function;   //upper case
+    std::string column;     //"*" for COUNT(*)
+};
+
 struct ParsedCommand{
 
     bool isValid = true;
@@ -13,10 +19,26 @@ struct ParsedCommand{
     std::vector< std::pair<std::string,std::string> > columns; 
     //for insert record
     std::vector<std::string> values;
+    //same length as values, true where the value was a bare NULL
+    std::vector<bool> nullValues;
+    //SELECT column list in the order asked for, empty for *
+    std::vector<std::string> selectColumns;
+    std::vector<AggregateCall> aggregates;
+    std::vector<std::string> groupBy;
+    //ORDER BY column, or an aggregate as "COUNT(*)"; empty for none
+    std::string orderBy;
+    bool orderDescending = false;
+    long long limit = -1;   //-1 for no LIMIT
+    //SELECT ... FROM table JOIN joinTable ON table.joinLeftColumn = joinTable.joinRightColumn
+    std::string joinTable;
+    std::string joinLeftColumn;
+    std::string joinRightColumn;
     std::string whereColumn;
     std::string whereValue1;
     std::string whereValue2;//for between condition(later implement) 
-    std::string op; // =, between(later implement)
+    std::vector<std::string> whereValues; //IN list, NULLs left out
+    std::string op; // =, BETWEEN, IN, empty for a SELECT without WHERE
+    bool columnar = false; //SEAL TABLE t COLUMNAR
     std::string error;
 };
 
@@ -1,5 +1,11 @@
 #include "client_handler.h"
 #include "commands.h"
+#include "result_set.h"
+#include "result_codec.h"
+#include "trace.h"
+#include "metrics.h"
+#include "query_stats.h"
+#include "output_capture.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
@@ -40,17 +46,39 @@ ClientHandler::ClientHandler(int clientFd,
 }
 
 ClientHandler::~ClientHandler() {
-    if (connected && serverSocketPtr) {
+    // also after the loop ended, e.g. on a frame over the limit, so the client sees the close
+    if (serverSocketPtr) {
         serverSocketPtr->closeClientConnection(clientFd);
     }
 }
 
+/*
+  Requests are read through a buffered FrameReader, so a client may send a
+  whole batch without waiting. They are executed strictly in arrival order and
+  every response carries the request id it answers. While more requests are
+  already buffered, responses are collected and written with one send().
+*/
 void ClientHandler::handleClientCommunication() {
     sendWelcomeMessage();
+    Metrics::connectionOpened();
+    FrameReader reader(clientFd);
+    std::string pendingOutput;
+
+    auto queueResponse = [&](Message response, uint32_t requestId) {
+        Trace::Span span("serialize");
+        response.requestId = requestId;
+        std::string body = MessageProtocol::serializeMessage(response);
+        if (body.size() > MessageProtocol::MAX_FRAME_BYTES) {
+            Message tooLarge = Message::createErrorMessage("Result of " + std::to_string(body.size()) + " bytes is over the frame limit, add a LIMIT");
+            tooLarge.requestId = requestId;
+            body = MessageProtocol::serializeMessage(tooLarge);
+        }
+        MessageProtocol::appendFrame(pendingOutput, body);
+    };
+
     while (connected) {
-        std::string receivedData = serverSocketPtr->receiveDataFromClient(clientFd);
-        
-        if (receivedData.empty()) {
+        std::string receivedData;
+        if (!reader.readFrame(receivedData) || receivedData.empty()) {
             connected = false;
             break;
         }
@@ -58,44 +86,52 @@ void ClientHandler::handleClientCommunication() {
         Message receivedMessage = MessageProtocol::deserializeMessage(receivedData);
         
         if (receivedMessage.type == MSG_DISCONNECT) {
-            Message goodbyeMsg = Message::createSuccessMessage("Goodbye! Connection closed.");
-            std::string serialized = MessageProtocol::serializeMessage(goodbyeMsg);
-            serverSocketPtr->sendDataToClient(clientFd, serialized);
+            queueResponse(Message::createSuccessMessage("Goodbye! Connection closed."), receivedMessage.requestId);
+            MessageProtocol::sendAll(clientFd, pendingOutput);
             
             connected = false;
             break;
         }
         
         if (receivedMessage.type == MSG_PING) {
-            Message pong = Message::createSuccessMessage("PONG");
-            std::string serialized = MessageProtocol::serializeMessage(pong);
-            serverSocketPtr->sendDataToClient(clientFd, serialized);
-            continue;
-        }
-        
-        if (receivedMessage.type == MSG_QUERY) {
-            std::cout << clientId << " query: " << shortQueryText(receivedMessage.text) << std::endl;
-            Message response = processSQLCommand(receivedMessage.text);
+            queueResponse(Message::createSuccessMessage("PONG"), receivedMessage.requestId);
+        } else if (receivedMessage.type == MSG_QUERY) {
+            std::string queryText = shortQueryText(receivedMessage.text);
+            std::cout << clientId << " query: " << queryText << std::endl;
             
-            std::string serializedResponse = MessageProtocol::serializeMessage(response);
-            serverSocketPtr->sendDataToClient(clientFd, serializedResponse);
+            Trace::QueryScope traceScope(queryText);
+            QueryStats::begin();
+            Message response = processSQLCommand(receivedMessage.text);
+            SlowQueryLog::check(clientId, queryText, response.timeUs);
+            queueResponse(response, receivedMessage.requestId);
         } else {
-            Message error_msg = Message::createErrorMessage("Unknown message type");
-            std::string serialized = MessageProtocol::serializeMessage(error_msg);
-            serverSocketPtr->sendDataToClient(clientFd, serialized);
+            queueResponse(Message::createErrorMessage("Unknown message type"), receivedMessage.requestId);
+        }
+
+        if (!reader.hasBufferedFrame()) {
+            if (!MessageProtocol::sendAll(clientFd, pendingOutput)) {
+                std::cerr << "ERROR: Failed to send data to client (fd: " << clientFd << ")" << std::endl;
+                connected = false;
+            }
+            pendingOutput.clear();
         }
     }
 
+    Metrics::connectionClosed();
     std::cout << clientId << " disconnected" << std::endl;
 }
 
 Message ClientHandler::processSQLCommand(const std::string& sqlCommand) {
-    auto start_time = std::chrono::high_resolution_clock::now();
+    auto start_time = std::chrono::steady_clock::now();
     
     try {
         std::string comandType = getCommandType(sqlCommand);
         Message response;
-        ParsedCommand parsedCmd = parserPtr->parse(sqlCommand);
+        ParsedCommand parsedCmd;
+        {
+            Trace::Span span("parse");
+            parsedCmd = parserPtr->parse(sqlCommand);
+        }
         
         if (!parsedCmd.isValid) {
             if (parsedCmd.error == "comment line") {
@@ -104,10 +140,10 @@ Message ClientHandler::processSQLCommand(const std::string& sqlCommand) {
                 response = Message::createErrorMessage("Parse error: " + parsedCmd.error);
             }
         } else {
-            if (comandType == "SELECT" || comandType == "SHOW") {
+            if (comandType == "SELECT" || comandType == "SHOW" || comandType == "STATS") {
                 response = executeSelectQuery(parsedCmd);
             } 
-            else if (comandType == "INSERT" || comandType == "UPDATE" || comandType == "DELETE" || comandType == "CREATE") {
+            else if (comandType == "INSERT" || comandType == "UPDATE" || comandType == "DELETE" || comandType == "CREATE" || comandType == "SEAL") {
                 response = executeWriteCommand(parsedCmd);
             }
             else {
@@ -115,9 +151,9 @@ Message ClientHandler::processSQLCommand(const std::string& sqlCommand) {
             }
         }
         
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-        response.timeMs = duration.count();
+        auto end_time = std::chrono::steady_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+        response.timeUs = static_cast<int>(duration.count());
         
         return response;
         
@@ -128,21 +164,35 @@ Message ClientHandler::processSQLCommand(const std::string& sqlCommand) {
 }
 
 Message ClientHandler::executeSelectQuery(const ParsedCommand& parsedCmd) {
+    uint64_t lockStart = Trace::nowMicros();
     LockGuard lockGuard(lockManager, clientId, LOCK_TYPE_READ);
+    uint64_t lockWaitUs = Trace::nowMicros() - lockStart;
+    Trace::record("lock_wait", lockStart, lockWaitUs);
+    Metrics::recordLockWait(Metrics::LockMode::READ, lockWaitUs);
+    QueryStats::addLockWait(lockWaitUs);
     
     if (!lockGuard.isLocked()) {
         return Message::createErrorMessage("Failed to acquire READ lock");
     }
     
     std::stringstream captured_output;
-    std::streambuf* old_cout = std::cout.rdbuf(captured_output.rdbuf());
-    std::streambuf* old_cerr = std::cerr.rdbuf(captured_output.rdbuf());
-    
-    Commands::execute(parsedCmd);
-    std::cout.rdbuf(old_cout);
-    std::cerr.rdbuf(old_cerr);
+    ResultSet resultSet;
+    {
+        OutputCapture::Scope capture(captured_output, true);
+        Commands::setResultCapture(&resultSet);
+        Commands::execute(parsedCmd);
+        Commands::setResultCapture(nullptr);
+    }
     
     std::string output = captured_output.str();
+
+    // table rows go out as binary columns, printed lines only carry the info text
+    if (resultSet.hasTable) {
+        Trace::Span span("serialize");
+        std::string payload = ResultCodec::encode(resultSet.columns, resultSet.records, resultSet.schema, resultSet.projection);
+        return Message::createResultMessage(output, payload);
+    }
+
     std::vector<std::string> results;
     std::istringstream iss(output);
     std::string line;
@@ -160,17 +210,22 @@ Message ClientHandler::executeSelectQuery(const ParsedCommand& parsedCmd) {
 }
 
 Message ClientHandler::executeWriteCommand(const ParsedCommand& parsedCmd) {
+    uint64_t lockStart = Trace::nowMicros();
     LockGuard lockGuard(lockManager, clientId, LOCK_TYPE_WRITE);
+    uint64_t lockWaitUs = Trace::nowMicros() - lockStart;
+    Trace::record("lock_wait", lockStart, lockWaitUs);
+    Metrics::recordLockWait(Metrics::LockMode::WRITE, lockWaitUs);
+    QueryStats::addLockWait(lockWaitUs);
     
     if (!lockGuard.isLocked()) {
         return Message::createErrorMessage("Failed to acquire WRITE lock");
     }
     
     std::stringstream captured_output;
-    std::streambuf* old_cout = std::cout.rdbuf(captured_output.rdbuf());
-    
-    Commands::execute(parsedCmd);
-    std::cout.rdbuf(old_cout);
+    {
+        OutputCapture::Scope capture(captured_output, false);
+        Commands::execute(parsedCmd);
+    }
     std::string output = captured_output.str();
     
     if (output.empty()) {
@@ -192,6 +247,11 @@ std::string ClientHandler::getCommandType(const std::string& sql) {
     std::string firstWord;
     iss >> firstWord;
     
+    // "STATS;" has no space before the semicolon
+    while (!firstWord.empty() && firstWord.back() == ';') {
+        firstWord.pop_back();
+    }
+    
     std::transform(firstWord.begin(), firstWord.end(), firstWord.begin(), ::toupper); 
     return firstWord;
 }
@@ -2,20 +2,24 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <cstdint>
+#include <sys/socket.h>
+#include <errno.h>
 
 
-Message Message::createQueryMessage(const std::string& sqlQuery) {
+Message Message::createQueryMessage(const std::string& sqlQuery, uint32_t requestId) {
     Message msg;
     msg.type = MSG_QUERY;
+    msg.requestId = requestId;
     msg.text = sqlQuery;
     return msg;
 }
 
-Message Message::createSuccessMessage(const std::string& successText, int timeMs) {
+Message Message::createSuccessMessage(const std::string& successText, int timeUs) {
     Message msg;
     msg.type = MSG_RESPONSE_OK;
     msg.text = successText;
-    msg.timeMs = timeMs;
+    msg.timeUs = timeUs;
     return msg;
 }
 
@@ -26,11 +30,20 @@ Message Message::createErrorMessage(const std::string& error_text) {
     return msg;
 }
 
-Message Message::createDataMessage(const std::vector<std::string>& rows, int timeMs) {
+Message Message::createDataMessage(const std::vector<std::string>& rows, int timeUs) {
     Message msg;
     msg.type = MSG_RESPONSE_DATA;
     msg.rows = rows;
-    msg.timeMs = timeMs;
+    msg.timeUs = timeUs;
+    return msg;
+}
+
+Message Message::createResultMessage(const std::string& infoText, const std::string& resultPayload, int timeUs) {
+    Message msg;
+    msg.type = MSG_RESPONSE_RESULT;
+    msg.text = infoText;
+    msg.payload = resultPayload;
+    msg.timeUs = timeUs;
     return msg;
 }
 
@@ -45,12 +58,17 @@ Message Message::createPingMessage() {
 std::string MessageProtocol::serializeMessage(const Message& msg) {
     std::ostringstream outputStream;
     
-    //Format: TYPE|COMMAND|TIME|ROWS
+    //Format: TYPE|ID|LENGTH|COMMAND|TIME|ROWS  (RESULT carries the binary payload in place of ROWS)
+    //COMMAND is read by its LENGTH, so it may hold '|'
     outputStream << messageTypeToString(msg.type) << "|";
+    outputStream << msg.requestId << "|";
+    outputStream << msg.text.size() << "|";
     outputStream << msg.text << "|";
-    outputStream << msg.timeMs << "|";
+    outputStream << msg.timeUs << "|";
     
-    if (!msg.rows.empty()) {
+    if (msg.type == MSG_RESPONSE_RESULT) {
+        outputStream << msg.payload;
+    } else if (!msg.rows.empty()) {
         outputStream << joinStrings(msg.rows, '\n');
     }
     
@@ -65,42 +83,59 @@ Message MessageProtocol::deserializeMessage(const std::string& rawData) {
         return msg;
     }
     
-    std::vector<std::string> parts;
-    size_t start = 0;
+    // TYPE, ID and LENGTH end at the first three '|'
+    std::string parts[3];
     size_t pos = 0;
-    int pipe_count = 0;
-    
-    while (pos < rawData.length() && pipe_count < 3) {
-        if (rawData[pos] == '|') {
-            parts.push_back(rawData.substr(start, pos - start));
-            start = pos + 1;
-            pipe_count++;
+    for (int i = 0; i < 3; i++) {
+        size_t bar = rawData.find('|', pos);
+        if (bar == std::string::npos) {
+            std::cerr << "WARNING: Invalid message format (not enough parts)" << std::endl;
+            msg.type = MSG_UNKNOWN;
+            return msg;
         }
-        pos++;
+        parts[i] = rawData.substr(pos, bar - pos);
+        pos = bar + 1;
     }
-    
-    if (start < rawData.length()) {
-        parts.push_back(rawData.substr(start));
+
+    size_t textLength = 0;
+    try {
+        textLength = std::stoull(parts[2]);
+    } catch (...) {
+        textLength = std::string::npos;
     }
-    
-    if (parts.size() < 3) {
-        std::cerr << "WARNING: Invalid message format (not enough parts)" << std::endl;
+    size_t timeEnd = std::string::npos;
+    if (textLength <= rawData.size() - pos && pos + textLength < rawData.size() && rawData[pos + textLength] == '|') {
+        timeEnd = rawData.find('|', pos + textLength + 1);
+    }
+    if (timeEnd == std::string::npos) {
+        std::cerr << "WARNING: Invalid message format (bad text length)" << std::endl;
         msg.type = MSG_UNKNOWN;
         return msg;
     }
     
     msg.type = stringToMessageType(parts[0]);
 
-    msg.text = parts[1];
+    try {
+        msg.requestId = static_cast<uint32_t>(std::stoul(parts[1]));
+    } catch (...) {
+        msg.requestId = 0;
+    }
+
+    msg.text = rawData.substr(pos, textLength);
+    pos += textLength + 1;
     
     try {
-        msg.timeMs = std::stoi(parts[2]);
+        msg.timeUs = std::stoi(rawData.substr(pos, timeEnd - pos));
     } catch (...) {
-        msg.timeMs = 0;
+        msg.timeUs = 0;
     }
     
-    if (parts.size() > 3 && !parts[3].empty()) {
-        msg.rows = splitString(parts[3], '\n');
+    if (timeEnd + 1 < rawData.size()) {
+        if (msg.type == MSG_RESPONSE_RESULT) {
+            msg.payload = rawData.substr(timeEnd + 1);
+        } else {
+            msg.rows = splitString(rawData.substr(timeEnd + 1), '\n');
+        }
     }
     
     return msg;
@@ -125,6 +160,77 @@ std::string MessageProtocol::formatResultsAsTable(const std::vector<std::string>
     return table.str();
 }
 
+bool MessageProtocol::sendAll(int socketFd, const std::string& data) {
+    const char* next = data.data();
+    size_t length = data.size();
+    while (length > 0) {
+        ssize_t sent = send(socketFd, next, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        next += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+bool MessageProtocol::receiveAll(int socketFd, char* data, size_t length) {
+    while (length > 0) {
+        ssize_t received = recv(socketFd, data, length, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        length -= received;
+    }
+    return true;
+}
+
+static uint32_t readFrameLength(const unsigned char* header) {
+    return (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16) |
+           (uint32_t(header[2]) << 8) | uint32_t(header[3]);
+}
+
+void MessageProtocol::appendFrame(std::string& out, const std::string& body) {
+    uint32_t length = static_cast<uint32_t>(body.size());
+    out.push_back(static_cast<char>((length >> 24) & 0xFF));
+    out.push_back(static_cast<char>((length >> 16) & 0xFF));
+    out.push_back(static_cast<char>((length >> 8) & 0xFF));
+    out.push_back(static_cast<char>(length & 0xFF));
+    out += body;
+}
+
+bool MessageProtocol::sendFrame(int socketFd, const std::string& body) {
+    if (body.size() > MAX_FRAME_BYTES) {
+        std::cerr << "ERROR: Frame of " << body.size() << " bytes is over the limit" << std::endl;
+        return false;
+    }
+    std::string frame;
+    frame.reserve(4 + body.size());
+    appendFrame(frame, body);
+    return sendAll(socketFd, frame);
+}
+
+bool MessageProtocol::receiveFrame(int socketFd, std::string& body) {
+    unsigned char header[4];
+    if (!receiveAll(socketFd, reinterpret_cast<char*>(header), 4)) {
+        return false;
+    }
+
+    uint32_t length = readFrameLength(header);
+    if (length > MAX_FRAME_BYTES) {
+        std::cerr << "ERROR: Frame of " << length << " bytes is over the limit" << std::endl;
+        return false;
+    }
+    body.assign(length, '\0');
+    if (length == 0) {
+        return true;
+    }
+    return receiveAll(socketFd, &body[0], length);
+}
+
 
 std::string MessageProtocol::messageTypeToString(MessageType type) {
     switch (type) {
@@ -132,6 +238,7 @@ std::string MessageProtocol::messageTypeToString(MessageType type) {
         case MSG_RESPONSE_OK:    return "OK";
         case MSG_RESPONSE_ERROR: return "ERROR";
         case MSG_RESPONSE_DATA:  return "DATA";
+        case MSG_RESPONSE_RESULT: return "RESULT";
         case MSG_PING:           return "PING";
         case MSG_DISCONNECT:     return "DISCONNECT";
         default:                 return "UNKNOWN";
@@ -143,6 +250,7 @@ MessageType MessageProtocol::stringToMessageType(const std::string& typeStr) {
     if (typeStr == "OK")         return MSG_RESPONSE_OK;
     if (typeStr == "ERROR")      return MSG_RESPONSE_ERROR;
     if (typeStr == "DATA")       return MSG_RESPONSE_DATA;
+    if (typeStr == "RESULT")     return MSG_RESPONSE_RESULT;
     if (typeStr == "PING")       return MSG_PING;
     if (typeStr == "DISCONNECT") return MSG_DISCONNECT;
     return MSG_UNKNOWN;
@@ -175,3 +283,54 @@ std::string MessageProtocol::joinStrings(const std::vector<std::string>& strings
     
     return result.str();
 }
+
+
+FrameReader::FrameReader(int socketFd) {
+    this->socketFd = socketFd;
+    readPos = 0;
+}
+
+bool FrameReader::hasCompleteFrame() const {
+    if (buffer.size() - readPos < 4) {
+        return false;
+    }
+    uint32_t length = readFrameLength(reinterpret_cast<const unsigned char*>(buffer.data() + readPos));
+    return buffer.size() - readPos - 4 >= length;
+}
+
+bool FrameReader::readFrame(std::string& body) {
+    const size_t CHUNK_SIZE = 64 * 1024;
+    
+    while (!hasCompleteFrame()) {
+        // a length over the limit is never buffered, the connection is dropped
+        if (buffer.size() - readPos >= 4 &&
+            readFrameLength(reinterpret_cast<const unsigned char*>(buffer.data() + readPos)) > MessageProtocol::MAX_FRAME_BYTES) {
+            std::cerr << "ERROR: Frame is over the limit of " << MessageProtocol::MAX_FRAME_BYTES << " bytes" << std::endl;
+            return false;
+        }
+
+        // drop consumed bytes before growing the buffer
+        if (readPos > 0) {
+            buffer.erase(0, readPos);
+            readPos = 0;
+        }
+        
+        size_t oldSize = buffer.size();
+        buffer.resize(oldSize + CHUNK_SIZE);
+        ssize_t received = recv(socketFd, &buffer[oldSize], CHUNK_SIZE, 0);
+        if (received < 0 && errno == EINTR) {
+            buffer.resize(oldSize);
+            continue;
+        }
+        if (received <= 0) {
+            buffer.resize(oldSize);
+            return false;
+        }
+        buffer.resize(oldSize + received);
+    }
+    
+    uint32_t length = readFrameLength(reinterpret_cast<const unsigned char*>(buffer.data() + readPos));
+    body.assign(buffer, readPos + 4, length);
+    readPos += 4 + length;
+    return true;
+}
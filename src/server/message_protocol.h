@@ -2,12 +2,14 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstdint>
 
 enum MessageType {
     MSG_QUERY,           
     MSG_RESPONSE_OK,     
     MSG_RESPONSE_ERROR,  
     MSG_RESPONSE_DATA,   
+    MSG_RESPONSE_RESULT, 
     MSG_PING,            
     MSG_DISCONNECT,      
     MSG_UNKNOWN         
@@ -16,16 +18,19 @@ enum MessageType {
 class Message {
 public:
     MessageType type;
+    uint32_t requestId;    //echoed back so pipelined responses can be matched
     std::string text;
     std::vector<std::string> rows;
-    int timeMs;
+    std::string payload;   //binary result (see result_codec.h)
+    int timeUs;
     
-    Message() : type(MSG_UNKNOWN), timeMs(0) {}
+    Message() : type(MSG_UNKNOWN), requestId(0), timeUs(0) {}
     
-    static Message createQueryMessage(const std::string& sqlQuery);
-    static Message createSuccessMessage(const std::string& successText, int time_ms = 0);
+    static Message createQueryMessage(const std::string& sqlQuery, uint32_t requestId = 0);
+    static Message createSuccessMessage(const std::string& successText, int time_us = 0);
     static Message createErrorMessage(const std::string& errorText);
-    static Message createDataMessage(const std::vector<std::string>& rows, int time_ms = 0);
+    static Message createDataMessage(const std::vector<std::string>& rows, int time_us = 0);
+    static Message createResultMessage(const std::string& infoText, const std::string& resultPayload, int time_us = 0);
     static Message createPingMessage();
 };
 
@@ -34,12 +39,39 @@ public:
     static std::string serializeMessage(const Message& msg);
     static Message deserializeMessage(const std::string& rawData);
     static std::string formatResultsAsTable(const std::vector<std::string>& rows);
+
+    // Every message on the socket is sent as [4 byte length][body],
+    // so binary payloads and large results arrive complete.
+    // Longer frames are refused on both ends instead of allocated.
+    static const uint32_t MAX_FRAME_BYTES = 256 * 1024 * 1024;
+
+    static bool sendFrame(int socketFd, const std::string& body);
+    static bool receiveFrame(int socketFd, std::string& body);
+    static void appendFrame(std::string& out, const std::string& body);
+    static bool sendAll(int socketFd, const std::string& data);
     
 private:
     static std::string messageTypeToString(MessageType type);
+    static bool receiveAll(int socketFd, char* data, size_t length);
     static MessageType stringToMessageType(const std::string& typeStr);
     static std::vector<std::string> splitString(const std::string& str, char delimiter);
     static std::string joinStrings(const std::vector<std::string>& strings, char delimiter);
 };
 
+// Buffered frame reader, one per connection. Reads the socket in big chunks
+// so a batch of pipelined frames costs a single recv().
+class FrameReader {
+private:
+    int socketFd;
+    std::string buffer;
+    size_t readPos;
+
+    bool hasCompleteFrame() const;
 
+public:
+    explicit FrameReader(int socketFd);
+
+    bool readFrame(std::string& body);
+    // true when another complete frame is already waiting in the buffer
+    bool hasBufferedFrame() const { return hasCompleteFrame(); }
+};
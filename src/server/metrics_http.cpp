@@ -0,0 +1,117 @@
+#include "metrics_http.h"
+#include "message_protocol.h"
+#include "metrics.h"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+MetricsHttpServer::MetricsHttpServer(int port) {
+    this->port = port;
+    listenFd = -1;
+    running = false;
+}
+
+MetricsHttpServer::~MetricsHttpServer() {
+    stop();
+}
+
+bool MetricsHttpServer::start() {
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "ERROR: Failed to create metrics socket! " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int optionValue = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &optionValue, sizeof(optionValue));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, 8) < 0) {
+        std::cerr << "ERROR: Failed to open metrics port " << port << "! " << strerror(errno) << std::endl;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    running = true;
+    worker = std::thread(&MetricsHttpServer::serveLoop, this);
+    return true;
+}
+
+void MetricsHttpServer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+    close(listenFd);
+    listenFd = -1;
+}
+
+void MetricsHttpServer::serveLoop() {
+    while (running) {
+        // wake up now and then to notice stop()
+        struct pollfd listener = {listenFd, POLLIN, 0};
+        if (poll(&listener, 1, 200) <= 0) {
+            continue;
+        }
+
+        int clientFd = accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            continue;
+        }
+        answerRequest(clientFd);
+        close(clientFd);
+    }
+}
+
+void MetricsHttpServer::answerRequest(int clientFd) {
+    std::string request;
+    char buffer[1024];
+
+    // only the request line matters, stop at the end of the headers
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        struct pollfd client = {clientFd, POLLIN, 0};
+        if (poll(&client, 1, 1000) <= 0) {
+            return;
+        }
+        ssize_t received = recv(clientFd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break;
+        }
+        request.append(buffer, received);
+    }
+
+    std::istringstream requestLine(request);
+    std::string method, path;
+    requestLine >> method >> path;
+
+    std::string status = "200 OK";
+    std::string body;
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+    } else if (path == "/metrics" || path == "/") {
+        std::ostringstream metricsText;
+        Metrics::prometheus(metricsText);
+        body = metricsText.str();
+    } else {
+        status = "404 Not Found";
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    MessageProtocol::sendAll(clientFd, response);
+}
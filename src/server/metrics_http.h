@@ -0,0 +1,27 @@
+#pragma once
+#include <atomic>
+#include <thread>
+
+/*
+  Minimal HTTP endpoint for Prometheus scraping.
+
+  Runs on its own thread and answers GET /metrics (and GET /) with
+  Metrics::prometheus(). One request per connection, no keep-alive.
+*/
+class MetricsHttpServer {
+private:
+    int port;
+    int listenFd;
+    std::atomic<bool> running;
+    std::thread worker;
+
+    void serveLoop();
+    void answerRequest(int clientFd);
+
+public:
+    explicit MetricsHttpServer(int port);
+    ~MetricsHttpServer();
+
+    bool start();
+    void stop();
+};
@@ -0,0 +1,68 @@
+#include "output_capture.h"
+#include <iostream>
+#include <mutex>
+
+namespace OutputCapture {
+
+    static thread_local std::ostream* threadOut = nullptr;
+    static thread_local std::ostream* threadErr = nullptr;
+
+    // unbuffered: every write is handed on right away to the thread's target
+    class RoutingBuffer : public std::streambuf {
+    private:
+        std::streambuf* original;
+        bool errorStream;
+
+        // thread locals are read here, in the thread that is writing
+        std::streambuf* destination() const {
+            std::ostream* stream = errorStream ? threadErr : threadOut;
+            return stream ? stream->rdbuf() : original;
+        }
+
+    protected:
+        int overflow(int ch) override {
+            if (ch == traits_type::eof()) return traits_type::not_eof(ch);
+            return destination()->sputc(static_cast<char>(ch));
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize count) override {
+            return destination()->sputn(data, count);
+        }
+
+        int sync() override {
+            return destination()->pubsync();
+        }
+
+    public:
+        RoutingBuffer(std::streambuf* original, bool errorStream)
+            : original(original), errorStream(errorStream) {}
+    };
+
+    static std::once_flag installFlag;
+
+    void install() {
+        std::call_once(installFlag, []() {
+            // never destroyed: std::cout may still be used during exit
+            RoutingBuffer* outRouter = new RoutingBuffer(std::cout.rdbuf(), false);
+            RoutingBuffer* errRouter = new RoutingBuffer(std::cerr.rdbuf(), true);
+            std::cout.rdbuf(outRouter);
+            std::cerr.rdbuf(errRouter);
+        });
+    }
+
+    Scope::Scope(std::ostream& target, bool captureErrors) {
+        install();
+        previousOut = threadOut;
+        previousErr = threadErr;
+        threadOut = &target;
+        if (captureErrors) {
+            threadErr = &target;
+        }
+    }
+
+    Scope::~Scope() {
+        threadOut = previousOut;
+        threadErr = previousErr;
+    }
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <ostream>
+
+/*
+  Per-thread capture of std::cout / std::cerr.
+
+  The command layer prints its results to std::cout. Swapping the global
+  rdbuf to collect them is not safe with several client threads: one
+  client's rows end up in another client's response. install() puts a
+  routing buffer into std::cout and std::cerr once; a Scope then sends the
+  output of the current thread only into its own stream.
+*/
+namespace OutputCapture {
+
+    // idempotent, safe to call from many threads
+    void install();
+
+    class Scope {
+    private:
+        std::ostream* previousOut;
+        std::ostream* previousErr;
+
+    public:
+        Scope(std::ostream& target, bool captureErrors);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+}
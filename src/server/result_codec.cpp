@@ -0,0 +1,203 @@
+#include "result_codec.h"
+#include "varint.h"
+#include "record_codec.h"
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+static const uint8_t RESULT_VERSION = 1;
+
+static void appendVarint(std::string &out, uint64_t value) {
+    uint8_t bytes[Varint::MAX_BYTES];
+    size_t length = Varint::encodeTo(bytes, value);
+    out.append(reinterpret_cast<const char*>(bytes), length);
+}
+
+static const uint8_t *payloadAt(const std::string &in, size_t pos) {
+    return reinterpret_cast<const uint8_t*>(in.data()) + pos;
+}
+
+static bool readVarint(const std::string &in, size_t &pos, uint64_t &value) {
+    if (pos >= in.size()) return false;
+    size_t readBytes = 0;
+    value = Varint::decode(payloadAt(in, pos), payloadAt(in, in.size()), readBytes);
+    pos += readBytes;
+    return readBytes != 0;
+}
+
+std::string ResultCodec::encode(const std::vector<std::pair<std::string,std::string>> &columns,
+                                const std::vector<std::vector<uint8_t>> &records) {
+    return encode(columns, records, RecordCodec::makeSchema(columns, RecordCodec::FORMAT_TAGGED));
+}
+
+std::string ResultCodec::encode(const std::vector<std::pair<std::string,std::string>> &columns,
+                                const std::vector<std::vector<uint8_t>> &records,
+                                const RecordCodec::Schema &schema,
+                                const std::vector<int> &projection) {
+    std::vector<int> sent = projection;
+    std::vector<bool> wanted(columns.size(), projection.empty());
+    if (sent.empty()) {
+        for (size_t c = 0; c < columns.size(); c++) sent.push_back(c);
+    }
+    for (int c : sent) wanted[c] = true;
+
+    std::string out;
+    out.push_back('R');
+    out.push_back(static_cast<char>(RESULT_VERSION));
+
+    appendVarint(out, sent.size());
+    for (int c : sent) {
+        out.push_back(RecordCodec::typeFlag(schema.types[c]));
+        appendVarint(out, columns[c].first.size());
+        out += columns[c].first;
+    }
+
+    std::vector<std::vector<RecordCodec::Field>> batchFields;
+    for (size_t first = 0; first < records.size(); first += BATCH_ROWS) {
+        size_t count = std::min(BATCH_ROWS, records.size() - first);
+        appendVarint(out, count);
+
+        batchFields.resize(count);
+        for (size_t r = 0; r < count; r++) {
+            RecordCodec::decode(schema, records[first + r], batchFields[r], wanted);
+        }
+
+        for (int c : sent) {
+            std::string bitmap((count + 7) / 8, '\0');
+            for (size_t r = 0; r < count; r++) {
+                if (batchFields[r][c].isNull) {
+                    bitmap[r / 8] |= static_cast<char>(1u << (r % 8));
+                }
+            }
+            out += bitmap;
+
+            // stored bytes already match the payload, except v2 BOOLs which live in the
+            // header and DICT codes which go out as their text
+            RecordCodec::ColumnType type = schema.types[c];
+            for (size_t r = 0; r < count; r++) {
+                const RecordCodec::Field &field = batchFields[r][c];
+                if (field.isNull) continue;
+                if (type == RecordCodec::ColumnType::BOOL) {
+                    out.push_back(static_cast<char>(field.intValue));
+                } else if (type == RecordCodec::ColumnType::DICT) {
+                    std::string text = RecordCodec::toString(schema, records[first + r], field, c);
+                    appendVarint(out, text.size());
+                    out += text;
+                } else {
+                    out.append(reinterpret_cast<const char*>(records[first + r].data() + field.start), field.length);
+                }
+            }
+        }
+    }
+
+    appendVarint(out, 0);
+    return out;
+}
+
+bool ResultCodec::decode(const std::string &payload, DecodedResult &result) {
+    result = DecodedResult();
+    if (payload.size() < 2 || payload[0] != 'R' || static_cast<uint8_t>(payload[1]) != RESULT_VERSION) {
+        return false;
+    }
+
+    size_t pos = 2;
+    uint64_t columnCount = 0;
+    if (!readVarint(payload, pos, columnCount)) return false;
+
+    for (uint64_t c = 0; c < columnCount; c++) {
+        ResultColumn column;
+        uint64_t nameLength = 0;
+        if (pos >= payload.size()) return false;
+        column.type = payload[pos++];
+        if (!readVarint(payload, pos, nameLength) || pos + nameLength > payload.size()) return false;
+        column.name = payload.substr(pos, nameLength);
+        pos += nameLength;
+        result.columns.push_back(column);
+    }
+
+    std::vector<uint64_t> intBatch;
+    while (true) {
+        uint64_t count = 0;
+        if (!readVarint(payload, pos, count)) return false;
+        if (count == 0) break;
+
+        for (auto &column : result.columns) {
+            size_t bitmapSize = (count + 7) / 8;
+            if (pos + bitmapSize > payload.size()) return false;
+            const char *bitmap = payload.data() + pos;
+            pos += bitmapSize;
+
+            // present INT values sit back to back, decode them in one pass
+            size_t present = 0;
+            if (column.type == 'I') {
+                for (uint64_t r = 0; r < count; r++) {
+                    if (!((static_cast<uint8_t>(bitmap[r / 8]) >> (r % 8)) & 1)) present++;
+                }
+                intBatch.resize(present);
+                size_t used = Varint::decodeBatch(payloadAt(payload, pos), payloadAt(payload, payload.size()),
+                                                  intBatch.data(), present);
+                if (used == 0 && present > 0) return false;
+                pos += used;
+                present = 0;
+            }
+
+            for (uint64_t r = 0; r < count; r++) {
+                bool isNull = (static_cast<uint8_t>(bitmap[r / 8]) >> (r % 8)) & 1;
+                column.isNull.push_back(isNull);
+
+                if (column.type == 'I') {
+                    column.ints.push_back(isNull ? 0 : intBatch[present++]);
+                } else if (column.type == 'B') {
+                    uint64_t value = 0;
+                    if (!isNull) {
+                        if (pos >= payload.size()) return false;
+                        value = static_cast<uint8_t>(payload[pos++]);
+                    }
+                    column.ints.push_back(value);
+                } else if (column.type == 'F') {
+                    float value = 0.0f;
+                    if (!isNull) {
+                        if (pos + 4 > payload.size()) return false;
+                        memcpy(&value, payload.data() + pos, 4);
+                        pos += 4;
+                    }
+                    column.floats.push_back(value);
+                } else {
+                    std::string value;
+                    if (!isNull) {
+                        uint64_t length = 0;
+                        if (!readVarint(payload, pos, length) || pos + length > payload.size()) return false;
+                        value = payload.substr(pos, length);
+                        pos += length;
+                    }
+                    column.texts.push_back(std::move(value));
+                }
+            }
+        }
+        result.rowCount += count;
+    }
+
+    return true;
+}
+
+std::string ResultCodec::cellToString(const ResultColumn &column, size_t row) {
+    if (row >= column.isNull.size()) {
+        return "?";
+    }
+    if (column.isNull[row]) {
+        return "NULL";
+    }
+
+    if (column.type == 'I') {
+        return std::to_string(column.ints[row]);
+    }
+    if (column.type == 'B') {
+        return column.ints[row] ? "true" : "false";
+    }
+    if (column.type == 'F') {
+        std::ostringstream oss;
+        oss << column.floats[row];
+        return oss.str();
+    }
+    return column.texts[row];
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "record_codec.h"
+
+/*
+  Binary columnar encoding for query results.
+
+  Layout:
+    'R' version
+    varint columnCount, then per column: type byte (I/F/B/S), varint nameLength, name
+    batches until a batch with rowCount 0:
+        varint rowCount
+        per column: null bitmap (1 bit per row), then values of the non-null rows
+            I -> varint, F -> 4 raw bytes, B -> 1 byte, S -> varint length + bytes
+
+  Field bytes are copied straight out of the stored records (format 1 or 2,
+  see record_codec.h), so the server never turns a value into text.
+  With a projection only those columns are decoded and sent, in its order.
+*/
+
+struct ResultColumn{
+    std::string name;
+    char type = 'S';
+    std::vector<bool> isNull;
+    std::vector<uint64_t> ints;      //I and B columns
+    std::vector<float> floats;       //F columns
+    std::vector<std::string> texts;  //S columns
+};
+
+struct DecodedResult{
+    std::vector<ResultColumn> columns;
+    size_t rowCount = 0;
+};
+
+class ResultCodec{
+public:
+    static constexpr size_t BATCH_ROWS = 1024;
+
+    static std::string encode(const std::vector<std::pair<std::string,std::string>> &columns,
+                              const std::vector<std::vector<uint8_t>> &records);
+    static std::string encode(const std::vector<std::pair<std::string,std::string>> &columns,
+                              const std::vector<std::vector<uint8_t>> &records,
+                              const RecordCodec::Schema &schema,
+                              const std::vector<int> &projection = {});
+    static bool decode(const std::string &payload, DecodedResult &result);
+    static std::string cellToString(const ResultColumn &column, size_t row);
+};
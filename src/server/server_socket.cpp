@@ -1,11 +1,15 @@
 #include "server_socket.h"
+#include "message_protocol.h"
 #include <iostream>
 #include <cstring>
 #include <errno.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 
 ServerSocket::ServerSocket(int port) {
     this->port = port;
     serverFd = -1;
+    unixFd = -1;
     running = false;
     
     memset(&address, 0, sizeof(address));
@@ -47,18 +51,80 @@ bool ServerSocket::initializeServer() {
         return false;
     }
     
+    // port 0 lets the kernel pick a free port (benchmarks), report the real one
+    if (port == 0) {
+        socklen_t addressLength = sizeof(address);
+        getsockname(serverFd, (struct sockaddr*)&address, &addressLength);
+        port = ntohs(address.sin_port);
+    }
+    
     running = true;
     
     return true;
 }
 
+bool ServerSocket::initializeUnixSocket(const std::string& socketPath) {
+    struct sockaddr_un unixAddress;
+    memset(&unixAddress, 0, sizeof(unixAddress));
+    
+    if (socketPath.empty() || socketPath.size() >= sizeof(unixAddress.sun_path)) {
+        std::cerr << "ERROR: Invalid unix socket path: " << socketPath << std::endl;
+        return false;
+    }
+    
+    unixFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (unixFd < 0) {
+        std::cerr << "ERROR: Failed to create unix socket! " << strerror(errno) << std::endl;
+        return false;
+    }
+    
+    // remove a stale socket file left by an earlier run
+    unlink(socketPath.c_str());
+    
+    unixAddress.sun_family = AF_UNIX;
+    strncpy(unixAddress.sun_path, socketPath.c_str(), sizeof(unixAddress.sun_path) - 1);
+    
+    if (bind(unixFd, (struct sockaddr*)&unixAddress, sizeof(unixAddress)) < 0) {
+        std::cerr << "ERROR: Failed to bind unix socket " << socketPath << "! "
+                  << strerror(errno) << std::endl;
+        close(unixFd);
+        unixFd = -1;
+        return false;
+    }
+    
+    if (listen(unixFd, 10) < 0) {
+        std::cerr << "ERROR: Failed to listen on unix socket! " << strerror(errno) << std::endl;
+        close(unixFd);
+        unixFd = -1;
+        unlink(socketPath.c_str());
+        return false;
+    }
+    
+    unixPath = socketPath;
+    return true;
+}
+
 int ServerSocket::acceptClientConnection() {
-    struct sockaddr_in clientAddress;
-    socklen_t clientAddressLength = sizeof(clientAddress);
+    // wait on TCP and (if enabled) unix listener at the same time
+    struct pollfd listeners[2];
+    int listenerCount = 0;
+    listeners[listenerCount++] = {serverFd, POLLIN, 0};
+    if (unixFd >= 0) {
+        listeners[listenerCount++] = {unixFd, POLLIN, 0};
+    }
+    
+    int ready = poll(listeners, listenerCount, -1);
+    if (ready <= 0 || !running) {
+        if (running && errno != EINTR) {
+            std::cerr << "ERROR: Failed to wait for client connection! " << strerror(errno) << std::endl;
+        }
+        return -1;
+    }
+    
+    bool fromUnix = listenerCount > 1 && (listeners[1].revents & POLLIN);
+    int listenFd = fromUnix ? unixFd : serverFd;
     
-    int clientFd = accept(serverFd,
-                          (struct sockaddr*)&clientAddress,
-                          &clientAddressLength);
+    int clientFd = accept(listenFd, nullptr, nullptr);
     
     if (clientFd < 0) {
         if (running) {
@@ -67,6 +133,12 @@ int ServerSocket::acceptClientConnection() {
         return -1;
     }
 
+    if (!fromUnix) {
+        // small request/response frames, don't let Nagle hold them back
+        int noDelay = 1;
+        setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
     return clientFd;
 }
 
@@ -81,9 +153,7 @@ bool ServerSocket::sendDataToClient(int clientFd, const std::string& data) {
         return false;
     }
     
-    ssize_t byteSent = send(clientFd, data.c_str(), data.length(), 0);
-    
-    if (byteSent < 0) {
+    if (!MessageProtocol::sendFrame(clientFd, data)) {
         std::cerr << "ERROR: Failed to send data to client (fd: " << clientFd << ")" << std::endl;
         return false;
     }
@@ -96,24 +166,13 @@ std::string ServerSocket::receiveDataFromClient(int clientFd) {
         return "";
     }
     
-    const int BUFFER_SIZE = 4096;
-    char receiveBuffer[BUFFER_SIZE];
-    memset(receiveBuffer, 0, BUFFER_SIZE);
-    
-    ssize_t bytesReceived = recv(clientFd, receiveBuffer, BUFFER_SIZE - 1, 0);
-    
-    if (bytesReceived < 0) {
-        std::cerr << "ERROR: Failed to receive data from client (fd: " << clientFd << ")" << std::endl;
+    // empty string means the client closed the connection or sent garbage
+    std::string frame;
+    if (!MessageProtocol::receiveFrame(clientFd, frame)) {
         return "";
     }
     
-    if (bytesReceived == 0) {
-        return "";
-    }
-    
-    receiveBuffer[bytesReceived] = '\0';
-    
-    return std::string(receiveBuffer);
+    return frame;
 }
 
 void ServerSocket::shutdownServer() {
@@ -124,5 +183,11 @@ void ServerSocket::shutdownServer() {
             close(serverFd);
             serverFd = -1;
         }
+        
+        if (unixFd >= 0) {
+            close(unixFd);
+            unixFd = -1;
+            unlink(unixPath.c_str());
+        }
     }
 }
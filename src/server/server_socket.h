@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -12,11 +13,16 @@ private:
     struct sockaddr_in address;
     bool running;
     
+    // optional Unix domain socket for clients on the same host
+    int unixFd;
+    std::string unixPath;
+    
 public:
     ServerSocket(int port = 8080);
     ~ServerSocket();
     
     bool initializeServer();
+    bool initializeUnixSocket(const std::string& socketPath);
     int acceptClientConnection();
     void closeClientConnection(int clientFd);
     bool sendDataToClient(int clientFd, const std::string& data);
@@ -24,6 +30,9 @@ public:
     int getPort() const { 
         return port;
     }
+    const std::string& getUnixPath() const {
+        return unixPath;
+    }
     bool isRunning() const { 
         return running;
     }
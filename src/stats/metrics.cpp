@@ -0,0 +1,260 @@
+#include "metrics.h"
+#include <chrono>
+#include <iomanip>
+
+namespace Metrics{
+
+    static const int STATEMENT_COUNT = static_cast<int>(Statement::COUNT);
+
+    //per second query counters for the recent QPS window
+    static const int RATE_SLOTS = 16;
+    static const int RATE_WINDOW_SECONDS = 10;
+
+    struct RateSlot{
+        std::atomic<uint64_t> second{0};
+        std::atomic<uint64_t> count{0};
+    };
+
+    static Histogram queryLatency[STATEMENT_COUNT];
+    static RateSlot queryRate[STATEMENT_COUNT][RATE_SLOTS];
+    static Histogram lockWait[2];
+
+    static std::atomic<uint64_t> indexHits{0};
+    static std::atomic<uint64_t> indexMisses{0};
+    static std::atomic<uint64_t> dataBytesRead{0};
+    static std::atomic<uint64_t> dataBytesWritten{0};
+    static std::atomic<uint64_t> indexBytesRead{0};
+    static std::atomic<uint64_t> indexBytesWritten{0};
+    static std::atomic<int64_t> activeConnections{0};
+    static std::atomic<uint64_t> totalConnections{0};
+
+    static const auto startTime = std::chrono::steady_clock::now();
+
+    static uint64_t secondsSinceStart(){
+        return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    Statement statementFromType(const std::string &type){
+        if(type == "CREATE") return Statement::CREATE;
+        if(type == "INSERT") return Statement::INSERT;
+        if(type == "SELECT") return Statement::SELECT;
+        if(type == "SHOW") return Statement::SHOW;
+        if(type == "UPDATE") return Statement::UPDATE;
+        if(type == "DELETE") return Statement::DELETE;
+        if(type == "STATS") return Statement::STATS;
+        return Statement::OTHER;
+    }
+
+    const char* statementName(Statement statement){
+        static const char* names[] = {"create", "insert", "select", "show", "update", "delete", "stats", "other"};
+        return names[static_cast<int>(statement)];
+    }
+
+    int Histogram::bucketIndex(uint64_t value){
+        if(value < SUB_BUCKETS) return static_cast<int>(value);
+
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - SUB_BUCKET_BITS;
+        int sub = static_cast<int>((value >> shift) & (SUB_BUCKETS - 1));
+        return (shift + 1) * SUB_BUCKETS + sub;
+    }
+
+    uint64_t Histogram::bucketUpperEdge(int index){
+        if(index < SUB_BUCKETS) return static_cast<uint64_t>(index);
+
+        int shift = index / SUB_BUCKETS - 1;
+        uint64_t sub = index % SUB_BUCKETS;
+        uint64_t lower = (SUB_BUCKETS + sub) << shift;
+        return lower + ((uint64_t(1) << shift) - 1);
+    }
+
+    void Histogram::record(uint64_t value){
+        buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        totalSum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t seen = maxValue.load(std::memory_order_relaxed);
+        while(value > seen && !maxValue.compare_exchange_weak(seen, value, std::memory_order_relaxed)){}
+    }
+
+    uint64_t Histogram::count() const{
+        return total.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Histogram::sum() const{
+        return totalSum.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Histogram::max() const{
+        return maxValue.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Histogram::percentile(double p) const{
+        uint64_t n = count();
+        if(n == 0) return 0;
+
+        //rank of the wanted sample, 1 based
+        uint64_t rank = static_cast<uint64_t>(p * n + 0.5);
+        if(rank < 1) rank = 1;
+        if(rank > n) rank = n;
+
+        uint64_t seen = 0;
+        for(int i = 0; i < BUCKET_COUNT; i++){
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if(seen >= rank){
+                uint64_t edge = bucketUpperEdge(i);
+                return edge < max() ? edge : max();
+            }
+        }
+        return max();
+    }
+
+    void recordQuery(Statement statement, uint64_t durationUs){
+        int type = static_cast<int>(statement);
+        queryLatency[type].record(durationUs);
+
+        uint64_t second = secondsSinceStart() + 1;   //0 marks an unused slot
+        RateSlot &slot = queryRate[type][second % RATE_SLOTS];
+        uint64_t slotSecond = slot.second.load(std::memory_order_relaxed);
+        if(slotSecond != second && slot.second.compare_exchange_strong(slotSecond, second)){
+            slot.count.store(0, std::memory_order_relaxed);
+        }
+        slot.count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //average over the last RATE_WINDOW_SECONDS finished seconds
+    static double recentQps(int type){
+        uint64_t now = secondsSinceStart() + 1;
+        uint64_t total = 0;
+        for(int i = 0; i < RATE_SLOTS; i++){
+            const RateSlot &slot = queryRate[type][i];
+            uint64_t second = slot.second.load(std::memory_order_relaxed);
+            if(second < now && second + RATE_WINDOW_SECONDS >= now){
+                total += slot.count.load(std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t window = now - 1 < RATE_WINDOW_SECONDS ? now - 1 : RATE_WINDOW_SECONDS;
+        return window == 0 ? 0.0 : static_cast<double>(total) / window;
+    }
+
+    void recordLockWait(LockMode mode, uint64_t waitUs){
+        lockWait[mode == LockMode::READ ? 0 : 1].record(waitUs);
+    }
+
+    void indexCacheHit(){ indexHits.fetch_add(1, std::memory_order_relaxed); }
+    void indexCacheMiss(){ indexMisses.fetch_add(1, std::memory_order_relaxed); }
+
+    void addDataBytesRead(uint64_t bytes){ dataBytesRead.fetch_add(bytes, std::memory_order_relaxed); }
+    void addDataBytesWritten(uint64_t bytes){ dataBytesWritten.fetch_add(bytes, std::memory_order_relaxed); }
+    void addIndexBytesRead(uint64_t bytes){ indexBytesRead.fetch_add(bytes, std::memory_order_relaxed); }
+    void addIndexBytesWritten(uint64_t bytes){ indexBytesWritten.fetch_add(bytes, std::memory_order_relaxed); }
+
+    void connectionOpened(){
+        activeConnections.fetch_add(1, std::memory_order_relaxed);
+        totalConnections.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void connectionClosed(){
+        activeConnections.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    static double indexHitRatio(){
+        uint64_t hits = indexHits.load(std::memory_order_relaxed);
+        uint64_t lookups = hits + indexMisses.load(std::memory_order_relaxed);
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+    }
+
+    void report(std::ostream &out){
+        uint64_t uptime = secondsSinceStart();
+
+        out << "uptime_seconds " << uptime << "\n";
+        out << "-------------------------------------------------\n";
+        out << "| type | count | qps(10s) | p50 us | p99 us | p999 us | max us\n";
+        out << "-------------------------------------------------\n";
+        out << std::fixed << std::setprecision(1);
+        for(int i = 0; i < STATEMENT_COUNT; i++){
+            const Histogram &h = queryLatency[i];
+            if(h.count() == 0) continue;
+            out << "| " << statementName(static_cast<Statement>(i))
+                << " | " << h.count()
+                << " | " << recentQps(i)
+                << " | " << h.percentile(0.50)
+                << " | " << h.percentile(0.99)
+                << " | " << h.percentile(0.999)
+                << " | " << h.max() << "\n";
+        }
+
+        const char* modes[] = {"read", "write"};
+        for(int i = 0; i < 2; i++){
+            out << "lock_wait_" << modes[i] << " count " << lockWait[i].count()
+                << " p50 " << lockWait[i].percentile(0.50) << "us"
+                << " p99 " << lockWait[i].percentile(0.99) << "us"
+                << " max " << lockWait[i].max() << "us\n";
+        }
+
+        out << std::setprecision(3);
+        out << "index_cache hits " << indexHits.load() << " misses " << indexMisses.load()
+            << " hit_ratio " << indexHitRatio() << "\n";
+        out << "data_bytes read " << dataBytesRead.load() << " written " << dataBytesWritten.load() << "\n";
+        out << "index_bytes read " << indexBytesRead.load() << " written " << indexBytesWritten.load() << "\n";
+        out << "connections active " << activeConnections.load() << " total " << totalConnections.load() << "\n";
+        out << std::defaultfloat;
+    }
+
+    static void writeSummary(std::ostream &out, const std::string &name, const std::string &labels, const Histogram &h){
+        std::string prefix = labels.empty() ? "{" : "{" + labels + ",";
+        out << name << prefix << "quantile=\"0.5\"} " << h.percentile(0.50) << "\n";
+        out << name << prefix << "quantile=\"0.99\"} " << h.percentile(0.99) << "\n";
+        out << name << prefix << "quantile=\"0.999\"} " << h.percentile(0.999) << "\n";
+        out << name << "_sum{" << labels << "} " << h.sum() << "\n";
+        out << name << "_count{" << labels << "} " << h.count() << "\n";
+    }
+
+    void prometheus(std::ostream &out){
+        out << "# TYPE picodb_uptime_seconds gauge\n";
+        out << "picodb_uptime_seconds " << secondsSinceStart() << "\n";
+
+        out << "# TYPE picodb_queries_total counter\n";
+        for(int i = 0; i < STATEMENT_COUNT; i++){
+            out << "picodb_queries_total{type=\"" << statementName(static_cast<Statement>(i)) << "\"} "
+                << queryLatency[i].count() << "\n";
+        }
+
+        out << "# TYPE picodb_qps gauge\n";
+        for(int i = 0; i < STATEMENT_COUNT; i++){
+            out << "picodb_qps{type=\"" << statementName(static_cast<Statement>(i)) << "\"} "
+                << recentQps(i) << "\n";
+        }
+
+        out << "# TYPE picodb_query_latency_us summary\n";
+        for(int i = 0; i < STATEMENT_COUNT; i++){
+            std::string labels = std::string("type=\"") + statementName(static_cast<Statement>(i)) + "\"";
+            writeSummary(out, "picodb_query_latency_us", labels, queryLatency[i]);
+        }
+
+        out << "# TYPE picodb_lock_wait_us summary\n";
+        writeSummary(out, "picodb_lock_wait_us", "mode=\"read\"", lockWait[0]);
+        writeSummary(out, "picodb_lock_wait_us", "mode=\"write\"", lockWait[1]);
+
+        out << "# TYPE picodb_index_cache_hits_total counter\n";
+        out << "picodb_index_cache_hits_total " << indexHits.load() << "\n";
+        out << "# TYPE picodb_index_cache_misses_total counter\n";
+        out << "picodb_index_cache_misses_total " << indexMisses.load() << "\n";
+        out << "# TYPE picodb_index_cache_hit_ratio gauge\n";
+        out << "picodb_index_cache_hit_ratio " << indexHitRatio() << "\n";
+
+        out << "# TYPE picodb_bytes_read_total counter\n";
+        out << "picodb_bytes_read_total{file=\"data\"} " << dataBytesRead.load() << "\n";
+        out << "picodb_bytes_read_total{file=\"index\"} " << indexBytesRead.load() << "\n";
+        out << "# TYPE picodb_bytes_written_total counter\n";
+        out << "picodb_bytes_written_total{file=\"data\"} " << dataBytesWritten.load() << "\n";
+        out << "picodb_bytes_written_total{file=\"index\"} " << indexBytesWritten.load() << "\n";
+
+        out << "# TYPE picodb_connections_active gauge\n";
+        out << "picodb_connections_active " << activeConnections.load() << "\n";
+        out << "# TYPE picodb_connections_total counter\n";
+        out << "picodb_connections_total " << totalConnections.load() << "\n";
+    }
+
+}
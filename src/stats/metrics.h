@@ -0,0 +1,81 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <atomic>
+#include <ostream>
+
+/*
+  Process wide counters for capacity planning.
+
+  Everything is a relaxed atomic, so recording from many client threads
+  never takes a lock. Latencies go into log-linear histograms: values are
+  grouped by power of two and every power of two is split into 16 equal
+  sub buckets, which keeps the percentile error under ~6%.
+
+  STATS prints report(), the server can also expose prometheus() over HTTP.
+*/
+namespace Metrics{
+
+    enum class Statement{
+        CREATE,
+        INSERT,
+        SELECT,
+        SHOW,
+        UPDATE,
+        DELETE,
+        STATS,
+        OTHER,
+        COUNT
+    };
+
+    Statement statementFromType(const std::string &type);
+    const char* statementName(Statement statement);
+
+    class Histogram{
+        public:
+            static const int SUB_BUCKET_BITS = 4;
+            static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+            static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+            void record(uint64_t value);
+            uint64_t count() const;
+            uint64_t sum() const;
+            uint64_t max() const;
+            //p in [0,1], returns the upper edge of the bucket holding it
+            uint64_t percentile(double p) const;
+
+        private:
+            std::atomic<uint64_t> buckets[BUCKET_COUNT] = {};
+            std::atomic<uint64_t> total{0};
+            std::atomic<uint64_t> totalSum{0};
+            std::atomic<uint64_t> maxValue{0};
+
+            static int bucketIndex(uint64_t value);
+            static uint64_t bucketUpperEdge(int index);
+    };
+
+    enum class LockMode{
+        READ,
+        WRITE
+    };
+
+    void recordQuery(Statement statement, uint64_t durationUs);
+    void recordLockWait(LockMode mode, uint64_t waitUs);
+
+    void indexCacheHit();
+    void indexCacheMiss();
+
+    void addDataBytesRead(uint64_t bytes);
+    void addDataBytesWritten(uint64_t bytes);
+    void addIndexBytesRead(uint64_t bytes);
+    void addIndexBytesWritten(uint64_t bytes);
+
+    void connectionOpened();
+    void connectionClosed();
+
+    //human readable, one metric per line
+    void report(std::ostream &out);
+    //Prometheus text exposition format
+    void prometheus(std::ostream &out);
+
+}
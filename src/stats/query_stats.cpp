@@ -0,0 +1,114 @@
+#include "query_stats.h"
+#include <atomic>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <ctime>
+
+namespace QueryStats{
+
+    static thread_local Counters counters;
+
+    void begin(){
+        counters = Counters();
+    }
+
+    const Counters& current(){
+        return counters;
+    }
+
+    void addRecordRead(uint64_t bytes){
+        counters.recordsRead++;
+        counters.bytesRead += bytes;
+    }
+
+    void addBytesRead(uint64_t bytes){
+        counters.bytesRead += bytes;
+    }
+
+    void addReads(uint64_t records, uint64_t bytes){
+        counters.recordsRead += records;
+        counters.bytesRead += bytes;
+    }
+
+    void addIndexEntries(uint64_t entries){
+        counters.indexEntries += entries;
+    }
+
+    void addLockWait(uint64_t waitUs){
+        counters.lockWaitUs += waitUs;
+    }
+
+    void usePlan(const char *plan){
+        std::string &current = counters.plan;
+        if(current.empty()){
+            current = plan;
+        }else if(current.find(plan) == std::string::npos){
+            current += " + ";
+            current += plan;
+        }
+    }
+
+}
+
+namespace SlowQueryLog{
+
+    static std::atomic<bool> logEnabled(false);
+    static std::atomic<uint64_t> slowThresholdUs(0);
+    static std::mutex logMutex;
+    static std::ofstream logFile;
+
+    void configure(uint64_t thresholdUs, const std::string &path){
+        std::lock_guard<std::mutex> guard(logMutex);
+        if(logFile.is_open()) logFile.close();
+        if(!path.empty()){
+            logFile.open(path, std::ios::app);
+            if(!logFile){
+                std::cerr << "ERROR: cannot open slow query log " << path << ", using stderr\n";
+            }
+        }
+        slowThresholdUs = thresholdUs;
+        logEnabled = true;
+    }
+
+    bool isEnabled(){
+        return logEnabled.load(std::memory_order_relaxed);
+    }
+
+    static void writeQuoted(std::ostream &out, const std::string &text){
+        out << '"';
+        for(char ch : text){
+            if(ch == '"' || ch == '\\') out << '\\';
+            out << ch;
+        }
+        out << '"';
+    }
+
+    void check(const std::string &clientId, const std::string &queryText, uint64_t durationUs){
+        if(!isEnabled() || durationUs < slowThresholdUs.load(std::memory_order_relaxed)) return;
+
+        const QueryStats::Counters &stats = QueryStats::current();
+
+        char timeText[32];
+        std::time_t now = std::time(nullptr);
+        std::tm localTime;
+        localtime_r(&now, &localTime);
+        std::strftime(timeText, sizeof(timeText), "%Y-%m-%d %H:%M:%S", &localTime);
+
+        std::lock_guard<std::mutex> guard(logMutex);
+        std::ostream &out = logFile.is_open() ? static_cast<std::ostream&>(logFile) : std::cerr;
+
+        out << timeText << " [SLOW] " << clientId
+            << " duration_us=" << durationUs
+            << " lock_wait_us=" << stats.lockWaitUs
+            << " plan=";
+        writeQuoted(out, stats.plan.empty() ? "none" : stats.plan);
+        out << " records_read=" << stats.recordsRead
+            << " bytes_read=" << stats.bytesRead
+            << " index_entries=" << stats.indexEntries
+            << " query=";
+        writeQuoted(out, queryText);
+        out << std::endl;
+    }
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+/*
+  Per-query I/O accounting and the slow query log.
+
+  The counters are thread local: a query runs start to finish on one
+  thread, so FileManager and the indexes can add to them without locking.
+  The server resets them before each query and hands them to the slow log
+  afterwards.
+*/
+namespace QueryStats{
+
+    struct Counters{
+        uint64_t recordsRead = 0;
+        uint64_t bytesRead = 0;       //from the .data file
+        uint64_t indexEntries = 0;    //index entries looked at while probing
+        uint64_t lockWaitUs = 0;
+        std::string plan;             //access paths used, e.g. "hash lookup"
+    };
+
+    void begin();
+    const Counters& current();
+
+    void addRecordRead(uint64_t bytes);
+    void addBytesRead(uint64_t bytes);
+    //reads another thread did for this query (parallel scan workers)
+    void addReads(uint64_t records, uint64_t bytes);
+    void addIndexEntries(uint64_t entries);
+    void addLockWait(uint64_t waitUs);
+    void usePlan(const char *plan);
+
+}
+
+namespace SlowQueryLog{
+
+    //empty path writes to stderr
+    void configure(uint64_t thresholdUs, const std::string &path);
+    bool isEnabled();
+
+    //writes one line when durationUs reaches the threshold
+    void check(const std::string &clientId, const std::string &queryText, uint64_t durationUs);
+
+}
@@ -0,0 +1,194 @@
+#include "trace.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+namespace Trace{
+
+    struct TraceEvent{
+        const char *name = nullptr;
+        uint64_t queryId = 0;
+        uint32_t threadId = 0;
+        uint64_t startUs = 0;
+        uint64_t durationUs = 0;
+        std::string queryText;   //only filled for the "query" span
+    };
+
+    static const size_t RING_CAPACITY = 1 << 16;
+
+    static std::atomic<bool> tracingEnabled(false);
+    static std::mutex ringMutex;
+    static std::vector<TraceEvent> ring;
+    static uint64_t ringWrites = 0;
+
+    static std::atomic<uint64_t> nextQueryId(1);
+    static std::atomic<uint32_t> nextThreadId(1);
+
+    static thread_local uint64_t currentQueryId = 0;
+    static thread_local uint32_t currentThreadId = 0;
+
+    static uint32_t threadIdForTrace(){
+        if(currentThreadId == 0) currentThreadId = nextThreadId++;
+        return currentThreadId;
+    }
+
+    static void push(TraceEvent &&event){
+        std::lock_guard<std::mutex> guard(ringMutex);
+        if(ring.size() < RING_CAPACITY){
+            ring.push_back(std::move(event));
+        }else{
+            ring[ringWrites % RING_CAPACITY] = std::move(event);
+        }
+        ringWrites++;
+    }
+
+    void setEnabled(bool enabled){
+        tracingEnabled = enabled;
+    }
+
+    bool isEnabled(){
+        return tracingEnabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t nowMicros(){
+        using namespace std::chrono;
+        return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    void record(const char *name, uint64_t startUs, uint64_t durationUs){
+        if(!isEnabled()) return;
+
+        TraceEvent event;
+        event.name = name;
+        event.queryId = currentQueryId;
+        event.threadId = threadIdForTrace();
+        event.startUs = startUs;
+        event.durationUs = durationUs;
+        push(std::move(event));
+    }
+
+    void clear(){
+        std::lock_guard<std::mutex> guard(ringMutex);
+        ring.clear();
+        ringWrites = 0;
+    }
+
+    static void writeJsonString(std::ostream &out, const std::string &text){
+        out << '"';
+        for(unsigned char ch : text){
+            if(ch == '"' || ch == '\\') out << '\\' << ch;
+            else if(ch < 0x20) out << ' ';
+            else out << ch;
+        }
+        out << '"';
+    }
+
+    bool dumpChromeTrace(const std::string &path){
+        std::vector<TraceEvent> events;
+        {
+            std::lock_guard<std::mutex> guard(ringMutex);
+            //oldest first
+            size_t first = ring.size() < RING_CAPACITY ? 0 : ringWrites % RING_CAPACITY;
+            for(size_t i = 0; i < ring.size(); i++){
+                events.push_back(ring[(first + i) % ring.size()]);
+            }
+        }
+
+        std::ofstream out(path);
+        if(!out){
+            std::cerr << "[ERROR] Cannot write trace file " << path << "\n";
+            return false;
+        }
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for(size_t i = 0; i < events.size(); i++){
+            const TraceEvent &e = events[i];
+            out << "{\"name\":\"" << e.name << "\",\"cat\":\"picodb\",\"ph\":\"X\""
+                << ",\"ts\":" << e.startUs << ",\"dur\":" << e.durationUs
+                << ",\"pid\":1,\"tid\":" << e.threadId
+                << ",\"args\":{\"query\":" << e.queryId;
+            if(!e.queryText.empty()){
+                out << ",\"sql\":";
+                writeJsonString(out, e.queryText);
+            }
+            out << "}}" << (i + 1 < events.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+        return true;
+    }
+
+    Span::Span(const char *name){
+        this->name = name;
+        active = isEnabled();
+        startUs = active ? nowMicros() : 0;
+    }
+
+    Span::~Span(){
+        if(active){
+            record(name, startUs, nowMicros() - startUs);
+        }
+    }
+
+    StageTotal::StageTotal(const char *name){
+        this->name = name;
+        active = isEnabled();
+    }
+
+    StageTotal::~StageTotal(){
+        if(active && firstUs != 0){
+            record(name, firstUs, totalUs);
+        }
+    }
+
+    void StageTotal::begin(){
+        if(!active) return;
+        pieceUs = nowMicros();
+        if(firstUs == 0) firstUs = pieceUs;
+    }
+
+    void StageTotal::end(){
+        if(active) totalUs += nowMicros() - pieceUs;
+    }
+
+    uint64_t currentQuery(){
+        return currentQueryId;
+    }
+
+    QueryWorker::QueryWorker(uint64_t queryId){
+        previousId = currentQueryId;
+        currentQueryId = queryId;
+    }
+
+    QueryWorker::~QueryWorker(){
+        currentQueryId = previousId;
+    }
+
+    QueryScope::QueryScope(const std::string &queryText){
+        active = isEnabled();
+        startUs = 0;
+        if(!active) return;
+
+        currentQueryId = nextQueryId++;
+        startUs = nowMicros();
+        this->queryText = queryText;
+    }
+
+    QueryScope::~QueryScope(){
+        if(!active) return;
+
+        TraceEvent event;
+        event.name = "query";
+        event.queryId = currentQueryId;
+        event.threadId = threadIdForTrace();
+        event.startUs = startUs;
+        event.durationUs = nowMicros() - startUs;
+        event.queryText = queryText;
+        push(std::move(event));
+
+        currentQueryId = 0;
+    }
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+/*
+  Lightweight per-query tracing.
+
+  Spans are kept in a fixed size ring buffer (oldest are overwritten) and can
+  be written out as Chrome trace_event JSON (open in chrome://tracing or
+  ui.perfetto.dev). When tracing is off a Span costs one atomic load.
+
+  Stage names used by PicoDB:
+    query, parse, lock_wait, index_load, index_probe, record_io, decode, serialize
+*/
+namespace Trace{
+
+    void setEnabled(bool enabled);
+    bool isEnabled();
+
+    //monotonic clock in microseconds
+    uint64_t nowMicros();
+
+    void record(const char *name, uint64_t startUs, uint64_t durationUs);
+    bool dumpChromeTrace(const std::string &path);
+    void clear();
+
+    //times one stage of the current query
+    class Span{
+        private:
+            const char *name;
+            uint64_t startUs;
+            bool active;
+
+        public:
+            explicit Span(const char *name);
+            ~Span();
+    };
+
+    //a stage done in many short pieces (decoding row by row): begin/end around each piece,
+    //recorded once as a span from the first piece's start, as long as all pieces together,
+    //so a big result does not push the other stages out of the ring
+    class StageTotal{
+        private:
+            const char *name;
+            bool active;
+            uint64_t firstUs = 0;
+            uint64_t pieceUs = 0;
+            uint64_t totalUs = 0;
+
+        public:
+            explicit StageTotal(const char *name);
+            ~StageTotal();
+            void begin();
+            void end();
+    };
+
+    //id of the query this thread runs, 0 outside a QueryScope
+    uint64_t currentQuery();
+
+    //spans of a helper thread (scan worker) carry the id of the query it works for until the end of the scope
+    class QueryWorker{
+        private:
+            uint64_t previousId;
+
+        public:
+            explicit QueryWorker(uint64_t queryId);
+            ~QueryWorker();
+    };
+
+    //marks the whole query, spans recorded inside it carry its id and text
+    class QueryScope{
+        private:
+            uint64_t startUs;
+            bool active;
+            std::string queryText;
+
+        public:
+            explicit QueryScope(const std::string &queryText);
+            ~QueryScope();
+    };
+
+}
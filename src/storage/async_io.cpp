@@ -0,0 +1,343 @@
+#include "async_io.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+static atomic<unsigned> depthSetting{AsyncIO::DEFAULT_QUEUE_DEPTH};
+
+/*
+  One thread's io_uring: the submission and completion rings are shared
+  with the kernel through mmap, head/tail updates are ordered with acquire
+  and release. inFlight never passes depth, so the completion ring (twice
+  as big) cannot overflow. A read the kernel cut short waits in retry until
+  there is room in the queue again.
+*/
+struct Ring{
+    int fd = -1;
+    unsigned entries = 0;
+    unsigned depth = 0;           //as asked for, entries is rounded up to a power of two
+    unsigned failedDepth = 0;     //depth whose setup failed, not tried again
+    unsigned inFlight = 0;
+    vector<AsyncIO::Read*> retry;
+
+    void *sqMap = nullptr, *cqMap = nullptr;
+    size_t sqMapSize = 0, cqMapSize = 0;
+    io_uring_sqe *sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+    unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    ~Ring(){ drain(); close(); }
+
+    bool open(unsigned depth);
+    bool drain();
+    void close();
+    void forget();
+    void queue(AsyncIO::Read *read);
+    bool enter(unsigned submit, unsigned wait);
+    void reap();
+};
+
+static thread_local Ring ring;
+
+static int uringSetup(unsigned entries, io_uring_params *params){
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringEnter(int fd, unsigned submit, unsigned wait, unsigned flags){
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+}
+
+//continue a read with pread from where it stands
+static void preadRest(AsyncIO::Read &read){
+    size_t got = read.result > 0 ? static_cast<size_t>(read.result) : 0;
+    while(got < read.length){
+        ssize_t n = pread(read.fd, read.buffer + got, read.length - got, read.offset + got);
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0){
+            read.result = -errno;
+            read.done = true;
+            return;
+        }
+        if(n == 0) break;
+        got += n;
+    }
+    read.result = got;
+    read.done = true;
+}
+
+bool Ring::open(unsigned depth){
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = uringSetup(depth, &params);
+    if(fd < 0){
+        failedDepth = depth;
+        return false;
+    }
+
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single) sqMapSize = cqMapSize = max(sqMapSize, cqMapSize);
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sqMap == MAP_FAILED){
+        sqMap = nullptr;
+        close();
+        failedDepth = depth;
+        return false;
+    }
+    cqMap = single ? sqMap : mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(cqMap == MAP_FAILED || sqeMap == MAP_FAILED){
+        if(cqMap == MAP_FAILED) cqMap = nullptr;
+        if(sqeMap != MAP_FAILED) sqes = static_cast<io_uring_sqe*>(sqeMap);
+        close();
+        failedDepth = depth;
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqeMap);
+
+    char *sq = static_cast<char*>(sqMap);
+    char *cq = static_cast<char*>(cqMap);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    entries = params.sq_entries;
+    this->depth = depth;
+    return true;
+}
+
+/*
+  Before the ring goes away every read it holds must be back: the kernel
+  writes into a read's buffer until its completion is posted, and the
+  caller finishes unfinished reads with pread or reuses the buffer. SQEs
+  the kernel never took (the failed enter did not submit them) are taken
+  back and their reads left undone; for the rest the completions are waited
+  for, polling the completion ring when enter keeps failing. False when
+  some never came, the ring must not be unmapped then.
+*/
+bool Ring::drain(){
+    if(fd < 0) return true;
+
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    unsigned tail = *sqTail;
+    inFlight -= min(inFlight, tail - head);
+    __atomic_store_n(sqTail, head, __ATOMIC_RELEASE);
+
+    for(unsigned polls = 0; inFlight > 0 && polls < 10000; polls++){
+        reap();
+        if(inFlight == 0) break;
+        if(!enter(0, 1)) usleep(1000);
+    }
+    reap();
+    return inFlight == 0;
+}
+
+void Ring::close(){
+    if(sqes) munmap(sqes, sqesSize);
+    if(cqMap && cqMap != sqMap) munmap(cqMap, cqMapSize);
+    if(sqMap) munmap(sqMap, sqMapSize);
+    if(fd >= 0) ::close(fd);
+    forget();
+}
+
+//back to no ring, without giving anything back to the kernel
+void Ring::forget(){
+    fd = -1;
+    entries = 0;
+    depth = 0;
+    inFlight = 0;
+    sqes = nullptr;
+    sqMap = cqMap = nullptr;
+    //reads waiting here are not done, finish and readAll pread them
+    retry.clear();
+}
+
+void Ring::queue(AsyncIO::Read *read){
+    size_t got = read->result > 0 ? static_cast<size_t>(read->result) : 0;
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe &sqe = sqes[index];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = read->fd;
+    sqe.off = read->offset + got;
+    sqe.addr = reinterpret_cast<uint64_t>(read->buffer + got);
+    sqe.len = static_cast<uint32_t>(min<size_t>(read->length - got, 1u << 30));
+    sqe.user_data = reinterpret_cast<uint64_t>(read);
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    inFlight++;
+}
+
+bool Ring::enter(unsigned submit, unsigned wait){
+    while(true){
+        int result = uringEnter(fd, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if(result >= 0) return true;
+        if(errno != EINTR) return false;
+    }
+}
+
+void Ring::reap(){
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    while(head != tail){
+        const io_uring_cqe &cqe = cqes[head & *cqMask];
+        AsyncIO::Read *read = reinterpret_cast<AsyncIO::Read*>(cqe.user_data);
+        inFlight--;
+        head++;
+
+        if(cqe.res == -EAGAIN || cqe.res == -EINTR){
+            retry.push_back(read);
+        }else if(cqe.res < 0){
+            //IORING_OP_READ unknown to this kernel and the like
+            preadRest(*read);
+        }else if(cqe.res == 0){
+            read->done = true;
+        }else{
+            read->result += cqe.res;
+            if(static_cast<size_t>(read->result) >= read->length) read->done = true;
+            else retry.push_back(read);
+        }
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+}
+
+//this thread's ring at the configured depth, false for pread
+static bool ringReady(){
+    unsigned depth = depthSetting;
+    if(ring.fd >= 0 && ring.inFlight > 0) return true;   //no resizing under running reads
+    if(ring.fd >= 0 && ring.depth == depth) return true;
+    if(ring.fd >= 0) ring.close();
+    if(depth == 0 || depth == ring.failedDepth) return false;
+    return ring.open(depth);
+}
+
+//enter failed, nothing more goes through this ring
+static void dropRing(){
+    ring.failedDepth = depthSetting;
+    if(ring.drain()){
+        ring.close();
+        return;
+    }
+    //kernel still owns buffers after 10 s: keep its mappings, this thread just stops using the ring
+    cerr << "ERROR io_uring reads did not complete, ring left open" << endl;
+    ring.forget();
+}
+
+void AsyncIO::setQueueDepth(unsigned depth){
+    depthSetting = min(depth, 4096u);
+}
+
+unsigned AsyncIO::queueDepth(){
+    return depthSetting;
+}
+
+bool AsyncIO::available(){
+    return ringReady();
+}
+
+void AsyncIO::readAll(vector<Read> &reads){
+    for(Read &read : reads){
+        read.result = 0;
+        read.done = false;
+    }
+    //a lone read gains nothing from a queue, and a cache miss would cost an io_uring worker hand off
+    if(reads.size() == 1){
+        preadRest(reads[0]);
+        return;
+    }
+
+    size_t next = 0;       //first read not queued yet
+    size_t undone = 0;     //first read maybe not done
+    while(true){
+        while(undone < reads.size() && reads[undone].done) undone++;
+        if(undone == reads.size()) return;
+
+        if(!ringReady()){
+            for(size_t i = undone; i < reads.size(); i++){
+                if(!reads[i].done) preadRest(reads[i]);
+            }
+            return;
+        }
+
+        unsigned submit = 0;
+        while(ring.inFlight < ring.depth && (!ring.retry.empty() || next < reads.size())){
+            Read *read;
+            if(!ring.retry.empty()){
+                read = ring.retry.back();
+                ring.retry.pop_back();
+            }else{
+                read = &reads[next++];
+            }
+            ring.queue(read);
+            submit++;
+        }
+        if(!ring.enter(submit, ring.inFlight > 0 ? 1 : 0)){
+            dropRing();
+            continue;
+        }
+        ring.reap();
+    }
+}
+
+void AsyncIO::start(Read &read){
+    read.result = 0;
+    read.done = false;
+    if(!ringReady()){
+        preadRest(read);
+        return;
+    }
+
+    //make room, completions of other reads just get recorded
+    while(ring.inFlight >= ring.depth){
+        if(!ring.enter(0, 1)){
+            dropRing();
+            preadRest(read);
+            return;
+        }
+        ring.reap();
+    }
+    ring.queue(&read);
+    if(!ring.enter(1, 0)){
+        dropRing();
+        preadRest(read);
+    }
+}
+
+void AsyncIO::finish(Read &read){
+    while(!read.done){
+        if(ring.fd < 0){
+            preadRest(read);
+            return;
+        }
+
+        unsigned submit = 0;
+        while(ring.inFlight < ring.depth && !ring.retry.empty()){
+            ring.queue(ring.retry.back());
+            ring.retry.pop_back();
+            submit++;
+        }
+        if(!ring.enter(submit, 1)){
+            dropRing();
+            continue;
+        }
+        ring.reap();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+
+/*
+  Positional file reads with many in flight at once.
+
+  Every thread owns an io_uring (set up on first use, raw syscalls, no
+  liburing) of queueDepth() entries. readAll puts up to that many reads in
+  the submission queue, enters the kernel once for the lot and refills the
+  queue as completions come in, so a cold disk sees a deep queue instead of
+  one read at a time. start/finish let one read run behind other work, for
+  read ahead in scans.
+
+  Without io_uring (old kernel, seccomp, queue depth 0) the same calls do
+  plain pread, one read after the other.
+*/
+class AsyncIO{
+    public:
+        struct Read{
+            int fd = -1;
+            uint64_t offset = 0;
+            uint8_t *buffer = nullptr;
+            size_t length = 0;
+            //bytes read (less at end of file) or -errno, valid once done
+            ssize_t result = 0;
+            bool done = false;
+        };
+
+        static const unsigned DEFAULT_QUEUE_DEPTH = 64;
+
+        //entries per thread ring, takes effect on each thread's next read; 0 means pread only
+        static void setQueueDepth(unsigned depth);
+        static unsigned queueDepth();
+
+        //true when this thread's reads go through io_uring
+        static bool available();
+
+        //every read, short reads are continued until length or end of file
+        static void readAll(std::vector<Read> &reads);
+
+        //one read left running until finish, read must stay in place till then
+        static void start(Read &read);
+        static void finish(Read &read);
+};
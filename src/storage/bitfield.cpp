@@ -28,4 +28,28 @@ namespace Bitfield{
         return out;
 
     }
-}
\ No newline at end of file
+
+    size_t bytesFor(size_t n){
+        return (n + 7) / 8;
+    }
+
+    void pack(const std::vector<bool> &flags, uint8_t *out){
+        for(size_t i = 0; i < bytesFor(flags.size()); ++i){
+            out[i] = 0;
+        }
+        for(size_t i = 0; i < flags.size(); ++i){
+            if(flags[i]) set(out, i, true);
+        }
+    }
+
+    std::vector<bool> unpack(const uint8_t *bytes, size_t n){
+        std::vector<bool> out;
+        out.reserve(n);
+
+        for(size_t i = 0; i < n; ++i){
+            out.push_back(get(bytes, i));
+        }
+
+        return out;
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 namespace Bitfield{
 
@@ -9,5 +10,19 @@ namespace Bitfield{
 
     //unpack bool
     std::vector<bool> unpack(uint8_t b, size_t n);
+
+    //any number of flags: flag i is bit i%8 of byte i/8
+    size_t bytesFor(size_t n);
+    void pack(const std::vector<bool> &flags, uint8_t *out);
+    std::vector<bool> unpack(const uint8_t *bytes, size_t n);
+
+    inline bool get(const uint8_t *bytes, size_t i){
+        return (bytes[i >> 3] >> (i & 7)) & 1;
+    }
+
+    inline void set(uint8_t *bytes, size_t i, bool value){
+        if(value) bytes[i >> 3] |= static_cast<uint8_t>(1u << (i & 7));
+        else bytes[i >> 3] &= static_cast<uint8_t>(~(1u << (i & 7)));
+    }
     
-}
\ No newline at end of file
+}
@@ -0,0 +1,114 @@
+#include "dictionary.h"
+#include "varint.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+void Dictionary::load(const string &table, const string &column){
+    string path = "data/" + table + "/" + table + "." + column + ".dict";
+    if(loadedStamp.matches(path)){
+        return;
+    }
+
+    filePath = path;
+    values.clear();
+    codes.clear();
+    loadedStamp.forget();
+
+    if(!fs::exists(filePath)){
+        return;
+    }
+
+    ifstream in(filePath, ios::binary);
+    if(!in){
+        cerr << "Error to open dictionary file " << filePath << "\n";
+        return;
+    }
+
+    vector<uint8_t> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    const uint8_t *pos = bytes.data();
+    const uint8_t *end = bytes.data() + bytes.size();
+
+    while(pos < end){
+        size_t readBytes = 0;
+        uint64_t length = Varint::decode(pos, end, readBytes);
+        if(readBytes == 0 || length > static_cast<uint64_t>(end - pos - readBytes)){
+            cerr << "Dictionary file " << filePath << " is cut short\n";
+            break;
+        }
+        pos += readBytes;
+
+        codes[string(reinterpret_cast<const char*>(pos), length)] = values.size();
+        values.emplace_back(reinterpret_cast<const char*>(pos), length);
+        pos += length;
+    }
+
+    loadedStamp.remember(filePath);
+}
+
+bool Dictionary::find(const string &value, uint64_t &code) const{
+    auto it = codes.find(value);
+    if(it == codes.end()) return false;
+    code = it->second;
+    return true;
+}
+
+bool Dictionary::codeFor(const string &value, uint64_t &code){
+    if(find(value, code)) return true;
+
+    error_code ec;
+    uintmax_t oldSize = fs::exists(filePath, ec) ? fs::file_size(filePath, ec) : 0;
+    if(ec){
+        cerr << "Error to read size of dictionary file " << filePath << "\n";
+        return false;
+    }
+
+    ofstream out(filePath, ios::binary | ios::app);
+    uint8_t length[Varint::MAX_BYTES];
+    size_t lengthSize = Varint::encodeTo(length, value.size());
+    out.write(reinterpret_cast<const char*>(length), lengthSize);
+    out.write(value.data(), value.size());
+    out.close();
+    if(!out){
+        //a half written entry would shift every code after it, cut it off again
+        cerr << "Error to write dictionary file " << filePath << "\n";
+        uintmax_t newSize = fs::exists(filePath, ec) ? fs::file_size(filePath, ec) : oldSize;
+        if(!ec && newSize != oldSize) fs::resize_file(filePath, oldSize, ec);
+        if(ec) cerr << "Dictionary file " << filePath << " may end in a partial entry\n";
+        IndexFileStamp::fileChanged(filePath);
+        return false;
+    }
+
+    code = values.size();
+    values.push_back(value);
+    codes[value] = code;
+
+    IndexFileStamp::fileChanged(filePath);
+    loadedStamp.remember(filePath);
+    return true;
+}
+
+const string &Dictionary::text(uint64_t code) const{
+    static const string unknown;
+    return code < values.size() ? values[code] : unknown;
+}
+
+size_t Dictionary::size() const{
+    return values.size();
+}
+
+//per thread like the SELECT indexes, the file stamp keeps the copies in step
+static thread_local unordered_map<string, Dictionary> dictionaries;
+
+Dictionary* Dictionary::forColumn(const string &table, const string &column){
+    Dictionary &dictionary = dictionaries[table + "/" + column];
+    dictionary.load(table, column);
+    return &dictionary;
+}
+
+void Dictionary::trimThreadCache(){
+    if(dictionaries.size() > IndexFileStamp::CACHED_TABLES) dictionaries.clear();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "index_cache.h"
+
+/*
+  Value list of one DICT column, kept next to .meta as <table>.<column>.dict.
+
+  Entry i of the file is the text for code i: [varint length][bytes].
+  Codes are handed out in first-seen order and never change, so the file is
+  only ever appended and records written earlier stay valid.
+*/
+class Dictionary{
+    private:
+        std::string filePath;
+        std::vector<std::string> values;
+        std::unordered_map<std::string, uint64_t> codes;
+        IndexFileStamp loadedStamp;
+
+    public:
+        //reads the file unless the loaded copy is still current
+        void load(const std::string &table, const std::string &column);
+
+        //code of an existing value, false if the column never held it
+        bool find(const std::string &value, uint64_t &code) const;
+        //code of value, a new value is added and appended to the file;
+        //false (and no new code) if the file could not be written
+        bool codeFor(const std::string &value, uint64_t &code);
+        //text of code, empty for an unknown code
+        const std::string &text(uint64_t code) const;
+        size_t size() const;
+
+        //this thread's copy of the dictionary, loaded and up to date
+        static Dictionary* forColumn(const std::string &table, const std::string &column);
+        //after a command: drop this thread's copies once there are more than IndexFileStamp::CACHED_TABLES
+        static void trimThreadCache();
+};
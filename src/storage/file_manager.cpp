@@ -1,20 +1,55 @@
 #include"file_manager.h"
 #include"varint.h"
+#include"trace.h"
+#include"metrics.h"
+#include"query_stats.h"
+#include"segment_store.h"
+#include"zone_map.h"
+#include"async_io.h"
 #include<fstream>
 #include<filesystem>
 #include<iostream>
 #include<sstream>
+#include<algorithm>
+#include<atomic>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<fcntl.h>
+#include<sys/stat.h>
+#include<unistd.h>
 
 using namespace std;
 namespace fs = std::filesystem;
 
+//copy the bytes of one varint length (max 10) from the stream, returns how many
+static size_t readLengthBytes(istream &in, uint8_t *lengthBuffer){
+    size_t n = 0;
+    char c;
+    while(n < Varint::MAX_BYTES && in.get(c)){
+        lengthBuffer[n++] = static_cast<uint8_t>(c);
+        if((lengthBuffer[n - 1] & 0x80) == 0){
+            break;
+        }
+    }
+    return n;
+}
+
+//offsets below this live in sealed segments, .data holds the rest
+static uint64_t tailBase(const string &table){
+    const SegmentStore *sealed = SegmentStore::forTable(table);
+    return sealed ? sealed->tailBase() : 0;
+}
+
 uint64_t FileManager::appendRecord(const string &table,vector<uint8_t> &records){
+    Trace::Span span("record_io");
 
     fs::create_directories("data/" + table);
     string filePath = "data/" + table +'/' + table +".data";
 
-    uint64_t offset = 0;
-    if(fs::exists(filePath)) offset = fs::file_size(filePath);
+    uint64_t base = tailBase(table);
+    uint64_t position = fs::exists(filePath) ? fs::file_size(filePath) : 0;
+    uint64_t offset = base + position;
 
     ofstream out(filePath,ios::binary | ios::app);
     if(!out){
@@ -22,10 +57,11 @@ uint64_t FileManager::appendRecord(const string &table,vector<uint8_t> &records)
         return 0;
     }
 
-    auto compressInt = Varint::encode(records.size()); 
+    uint8_t lengthBytes[Varint::MAX_BYTES];
+    size_t lengthSize = Varint::encodeTo(lengthBytes, records.size());
 
     //write length first uing varint
-    out.write(reinterpret_cast<const char*>(compressInt.data()), compressInt.size());
+    out.write(reinterpret_cast<const char*>(lengthBytes), lengthSize);
 
     if(!(records.empty())){
         //write data to the file
@@ -33,15 +69,23 @@ uint64_t FileManager::appendRecord(const string &table,vector<uint8_t> &records)
     }
 
     out.close();
+    Metrics::addDataBytesWritten(lengthSize + records.size());
+    ZoneMap::recordAdded(table, base, position, records, position);
     return offset;
 
 }
 
 vector<uint8_t> FileManager::readRecord(const string &table,uint64_t offset){
+    Trace::Span span("record_io");
 
     vector<uint8_t> recordData;
     string filePath = "data/" + table + '/' + table +".data";
 
+    const SegmentStore *sealed = SegmentStore::forTable(table);
+    if(sealed && offset < sealed->tailBase()){
+        return sealed->readRecord(offset);
+    }
+
     //check file exists
     if(!fs::exists(filePath)){
         cerr << "Data file not found" << endl;
@@ -55,24 +99,14 @@ vector<uint8_t> FileManager::readRecord(const string &table,uint64_t offset){
     }
 
     //move to offset
-    in.seekg(offset);
+    in.seekg(offset - (sealed ? sealed->tailBase() : 0));
 
     //read varint length
-    vector<uint8_t> lengthBuffer;
-    
-    //max 10 bytes for varint 64 bit
-    for(size_t i = 0; i < 10; ++i){ 
-        
-        char c;
-        in.get(c);
-        lengthBuffer.push_back(static_cast<uint8_t>(c));
-        if((lengthBuffer.back() & 0x80) == 0){
-            break;  
-        }
-    }
+    uint8_t lengthBuffer[Varint::MAX_BYTES];
+    size_t lengthSize = readLengthBytes(in, lengthBuffer);
 
     size_t readBytes = 0;
-    uint64_t recordLength = Varint::decode(lengthBuffer, 0, readBytes);
+    uint64_t recordLength = Varint::decode(lengthBuffer, lengthBuffer + lengthSize, readBytes);
     
     if(recordLength == 0){
         in.close();
@@ -84,11 +118,509 @@ vector<uint8_t> FileManager::readRecord(const string &table,uint64_t offset){
         in.read(reinterpret_cast<char*>(recordData.data()), recordLength);
     }
     in.close();
+    Metrics::addDataBytesRead(lengthSize + recordData.size());
+    QueryStats::addRecordRead(lengthSize + recordData.size());
     return recordData;
     
 
 }
 
+/*
+  Batched point reads. Every READ_BATCH offsets are sorted; sealed ones go
+  to SegmentStore in block order (its block cache then decompresses each
+  block once), .data ones are cut into runs whose neighbours lie at most
+  MERGE_GAP bytes apart, and each run is one read of up to MAX_RUN bytes
+  plus room for the last record. The runs of a batch (at most IO_BYTES of
+  them) are handed to AsyncIO together, so they are all in the disk queue
+  at once. A record the run did not cover (a long last record) falls back
+  to readRecord.
+*/
+static const size_t READ_BATCH = 4096;
+static const uint64_t MERGE_GAP = 32 * 1024;
+static const uint64_t MAX_RUN = 1 << 20;
+static const uint64_t LAST_RECORD_ROOM = 4096;
+static const uint64_t IO_BYTES = 16 << 20;
+
+namespace{
+struct Run{
+    size_t first, end;     //positions in the sorted order
+    uint64_t from;         //.data position of the buffer
+    vector<uint8_t> buffer;
+};
+}
+
+void FileManager::readRecords(const string &table, const vector<uint64_t> &offsets,
+                              const function<void(size_t, const vector<uint8_t>&)> &visit){
+    Trace::Span span("record_io");
+
+    const SegmentStore *sealed = SegmentStore::forTable(table);
+    uint64_t base = sealed ? sealed->tailBase() : 0;
+    string filePath = "data/" + table + '/' + table +".data";
+
+    int fd = -1;
+    uint64_t fileSize = 0;
+    bool opened = false;
+    vector<size_t> order;
+    vector<vector<uint8_t>> records;
+    vector<Run> runs;
+    vector<AsyncIO::Read> reads;
+
+    //parse the records of the runs read so far
+    auto takeRuns = [&](size_t first){
+        reads.resize(runs.size());
+        for(size_t r = 0; r < runs.size(); r++){
+            reads[r].fd = fd;
+            reads[r].offset = runs[r].from;
+            reads[r].buffer = runs[r].buffer.data();
+            reads[r].length = runs[r].buffer.size();
+        }
+        AsyncIO::readAll(reads);
+
+        for(size_t r = 0; r < runs.size(); r++){
+            vector<uint8_t> &buffer = runs[r].buffer;
+            buffer.resize(reads[r].result > 0 ? reads[r].result : 0);
+            Metrics::addDataBytesRead(buffer.size());
+            QueryStats::addBytesRead(buffer.size());
+
+            for(size_t k = runs[r].first; k < runs[r].end; k++){
+                uint64_t relative = offsets[order[k]] - base - runs[r].from;
+                vector<uint8_t> &record = records[order[k] - first];
+                if(relative >= buffer.size()) continue;
+
+                size_t readBytes = 0;
+                uint64_t recordLength = Varint::decode(buffer.data() + relative, buffer.data() + buffer.size(), readBytes);
+                if(readBytes == 0){
+                    record = readRecord(table, offsets[order[k]]);
+                    continue;
+                }
+                if(recordLength == 0) continue;   //tombstone
+                if(relative + readBytes + recordLength > buffer.size()){
+                    record = readRecord(table, offsets[order[k]]);
+                    continue;
+                }
+                record.assign(buffer.begin() + relative + readBytes, buffer.begin() + relative + readBytes + recordLength);
+                QueryStats::addRecordRead(0);   //bytes counted per run
+            }
+        }
+        runs.clear();
+    };
+
+    for(size_t first = 0; first < offsets.size(); first += READ_BATCH){
+        size_t count = min(READ_BATCH, offsets.size() - first);
+        order.resize(count);
+        for(size_t i = 0; i < count; i++) order[i] = first + i;
+        sort(order.begin(), order.end(), [&](size_t a, size_t b){ return offsets[a] < offsets[b]; });
+        records.assign(count, vector<uint8_t>());
+
+        uint64_t queued = 0;
+        size_t k = 0;
+        while(k < count){
+            uint64_t offset = offsets[order[k]];
+            if(offset < base){
+                records[order[k] - first] = sealed->readRecord(offset);
+                k++;
+                continue;
+            }
+
+            if(!opened){
+                opened = true;
+                fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+                struct stat info;
+                if(fd >= 0 && fstat(fd, &info) == 0) fileSize = info.st_size;
+                if(fd < 0) cerr << "Data file not found" << endl;
+            }
+
+            size_t end = k + 1;
+            while(end < count && offsets[order[end]] - offsets[order[end - 1]] <= MERGE_GAP &&
+                  offsets[order[end]] - offset < MAX_RUN){
+                end++;
+            }
+
+            uint64_t from = offset - base;
+            uint64_t to = min(offsets[order[end - 1]] - base + LAST_RECORD_ROOM, fileSize);
+            if(fd >= 0 && from < to){
+                runs.push_back({k, end, from, vector<uint8_t>(to - from)});
+                queued += to - from;
+                if(queued >= IO_BYTES){
+                    takeRuns(first);
+                    queued = 0;
+                }
+            }
+            k = end;
+        }
+        takeRuns(first);
+
+        for(size_t i = 0; i < count; i++) visit(first + i, records[i]);
+    }
+    if(fd >= 0) close(fd);
+}
+
+/*
+  Sequential scan over the whole data file.
+
+  The file is read in large chunks instead of byte by byte. Records that
+  cross a chunk border are kept in the window and completed by the next read.
+  While a chunk is parsed the next one is already being read (AsyncIO read
+  ahead), up to the end of the range.
+  Tombstone format: [0x00][skip_bytes_varint][remaining_old_data]
+  tailBase is the record offset of the first byte (see segment_store.h).
+  Only records starting in [from, to) are visited, from must be a record start.
+ */
+static bool scanTail(const string &filePath, uint64_t tailBase, const function<void(uint64_t, const vector<uint8_t>&)> &visit,
+                     uint64_t from = 0, uint64_t to = UINT64_MAX){
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        cerr << "ERROR opening data file" << endl;
+        return false;
+    }
+
+    //a zone map range is often one block, no need to pull in a whole chunk
+    const size_t CHUNK_SIZE = to - from < (1 << 20) ? max<uint64_t>(to - from, 4096) : (1 << 20);
+    vector<uint8_t> window;
+    size_t pos = 0;            //parse position inside window
+    uint64_t windowStart = tailBase + from;  //record offset of window[0]
+    uint64_t filePos = from;   //next byte to read
+    bool fileEnd = false;
+    vector<uint8_t> recordData;
+
+    vector<uint8_t> aheadBuffer(CHUNK_SIZE);
+    AsyncIO::Read ahead;
+    bool aheadRunning = false;
+    auto startAhead = [&](size_t length){
+        ahead.fd = fd;
+        ahead.offset = filePos;
+        ahead.buffer = aheadBuffer.data();
+        ahead.length = length;
+        AsyncIO::start(ahead);
+        aheadRunning = true;
+    };
+
+    //make sure at least 'need' bytes are available after pos
+    auto ensure = [&](size_t need) -> bool{
+        while(window.size() - pos < need && !fileEnd){
+            window.erase(window.begin(), window.begin() + pos);
+            windowStart += pos;
+            pos = 0;
+
+            //past the range only the rest of its last record is missing
+            size_t missing = need - (window.size() - pos);
+            if(!aheadRunning) startAhead(filePos < to ? CHUNK_SIZE : min<size_t>(CHUNK_SIZE, max<size_t>(missing, 4096)));
+            AsyncIO::finish(ahead);
+            aheadRunning = false;
+            size_t got = ahead.result > 0 ? ahead.result : 0;
+            window.insert(window.end(), aheadBuffer.begin(), aheadBuffer.begin() + got);
+            filePos += got;
+            Metrics::addDataBytesRead(got);
+            QueryStats::addBytesRead(got);
+            if(got < ahead.length) fileEnd = true;
+            else if(filePos < to) startAhead(CHUNK_SIZE);
+        }
+        return window.size() - pos >= need;
+    };
+
+    //read one varint from window
+    auto readLength = [&](uint64_t &value) -> bool{
+        if(!ensure(1)) return false;
+        ensure(Varint::MAX_BYTES);
+        size_t readBytes = 0;
+        value = Varint::decode(window.data() + pos, window.data() + window.size(), readBytes);
+        if(readBytes == 0) return false;
+        pos += readBytes;
+        return true;
+    };
+
+    while(true){
+        uint64_t recordOffset = windowStart + pos;
+        if(recordOffset - tailBase >= to) break;
+        uint64_t recordLength = 0;
+        if(!readLength(recordLength)) break;
+
+        if(recordLength == 0){
+            uint64_t bytesToSkip = 0;
+            if(!readLength(bytesToSkip)) break;
+            if(!ensure(bytesToSkip)) break;
+            pos += bytesToSkip;
+            continue;
+        }
+
+        if(!ensure(recordLength)) break;
+        recordData.assign(window.begin() + pos, window.begin() + pos + recordLength);
+        pos += recordLength;
+        QueryStats::addRecordRead(0);   //bytes already counted per chunk
+        visit(recordOffset, recordData);
+    }
+
+    //the kernel may still write into aheadBuffer
+    if(aheadRunning) AsyncIO::finish(ahead);
+    close(fd);
+    return true;
+}
+
+//sealed blocks come first, they hold the lower offsets
+bool FileManager::scanRecords(const string &table, const function<void(uint64_t, const vector<uint8_t>&)> &visit){
+    Trace::Span span("record_io");
+    QueryStats::usePlan("full scan");
+
+    string filePath = "data/" + table + '/' + table +".data";
+    if(!fs::exists(filePath)){
+        return false;
+    }
+
+    const SegmentStore *sealed = SegmentStore::forTable(table);
+    if(sealed){
+        sealed->scan(visit);
+    }
+    return scanTail(filePath, sealed ? sealed->tailBase() : 0, visit);
+}
+
+/*
+  Tail blocks [first, last) that are live and pass blockFilter (every live
+  block without one), neighbouring blocks read in one scanTail.
+ */
+static bool scanBlocks(const string &filePath, uint64_t base, const vector<ZoneBlock> &blocks, size_t first, size_t last,
+                       const function<bool(const vector<RecordCodec::ColumnRange>&)> &blockFilter,
+                       const function<void(uint64_t, const vector<uint8_t>&)> &visit){
+    auto wanted = [&](size_t i){
+        return blocks[i].live > 0 && blocks[i].firstRecord != ZoneBlock::NO_RECORD && (!blockFilter || blockFilter(blocks[i].ranges));
+    };
+
+    size_t i = first;
+    while(i < last){
+        if(!wanted(i)){
+            i++;
+            continue;
+        }
+
+        size_t runEnd = i + 1;
+        while(runEnd < last && wanted(runEnd)) runEnd++;
+        if(!scanTail(filePath, base, visit, blocks[i].firstRecord, runEnd * ZoneMap::BLOCK_SIZE)) return false;
+        i = runEnd;
+    }
+    return true;
+}
+
+/*
+  With a block filter the zone map (zone_map.h) picks the tail blocks to
+  read, runs of neighbouring blocks are read in one go. Sealed column groups
+  are filtered by their own min/max.
+ */
+bool FileManager::scanColumns(const string &table, const RecordCodec::Schema &schema, const vector<bool> &wanted,
+                              const function<void(uint64_t, const vector<uint8_t>&, const vector<RecordCodec::Field>&)> &visit,
+                              const function<bool(const vector<RecordCodec::ColumnRange>&)> &blockFilter){
+    Trace::Span span("record_io");
+
+    string filePath = "data/" + table + '/' + table +".data";
+    if(!fs::exists(filePath)){
+        QueryStats::usePlan("full scan");
+        return false;
+    }
+
+    const SegmentStore *sealed = SegmentStore::forTable(table);
+    uint64_t base = sealed ? sealed->tailBase() : 0;
+    const ZoneMap *zones = blockFilter ? ZoneMap::forScan(table, base, fs::file_size(filePath)) : nullptr;
+    QueryStats::usePlan(zones ? "zone map scan" : "full scan");
+
+    if(sealed){
+        sealed->scanColumns(schema, wanted, visit, blockFilter);
+    }
+
+    vector<RecordCodec::Field> fields;
+    auto decodeRecord = [&](uint64_t offset, const vector<uint8_t> &recordData){
+        RecordCodec::decode(schema, recordData, fields, wanted);
+        visit(offset, recordData, fields);
+    };
+    if(!zones){
+        return scanTail(filePath, base, decodeRecord);
+    }
+
+    return scanBlocks(filePath, base, zones->zones(), 0, zones->zones().size(), blockFilter, decodeRecord);
+}
+
+/*
+  Parallel scan. The zone map doubles as the tail's offset directory: every
+  block knows where its first record starts, so a share of whole blocks is
+  parsed from there without reading anything before it. The tail is cut into
+  shares of at most SHARE_BYTES; a round gives one share to each worker (the
+  calling thread is worker 0) and afterwards calls shareDone for the workers
+  in file order. The other workers are started once per scan and wait
+  between rounds; they count their reads in their own QueryStats, added to
+  the caller's after each round, and trace under the caller's query.
+  Helper threads come from one process-wide budget of scanThreads() - 1, so
+  concurrent scans (server connections) share the cores instead of each
+  starting its own full set; a scan that gets no helper runs serially.
+*/
+static const uint64_t PARALLEL_MIN_BYTES = 2 << 20;
+static const uint64_t SHARE_BYTES = 8 << 20;
+static const size_t SERIAL_ROUND = 1024;
+static atomic<size_t> scanThreadCount{max(1u, thread::hardware_concurrency())};
+static atomic<size_t> busyHelpers{0};      //helper threads alive over all scans
+
+//takes up to wanted helpers from the shared budget, returns how many it got
+static size_t takeHelpers(size_t wanted){
+    size_t busy = busyHelpers.load();
+    for(;;){
+        size_t budget = scanThreadCount - 1;
+        size_t granted = busy < budget ? min(wanted, budget - busy) : 0;
+        if(granted == 0 || busyHelpers.compare_exchange_weak(busy, busy + granted)) return granted;
+    }
+}
+
+void FileManager::setScanThreads(size_t threads){
+    scanThreadCount = max<size_t>(1, min<size_t>(threads, 256));
+}
+
+size_t FileManager::scanThreads(){
+    return scanThreadCount;
+}
+
+bool FileManager::scanParallel(const string &table, const RecordCodec::Schema &schema, const vector<bool> &wanted,
+                               const function<void(size_t, uint64_t, const vector<uint8_t>&, const vector<RecordCodec::Field>&)> &visit,
+                               const function<void(size_t)> &shareDone,
+                               const function<bool(const vector<RecordCodec::ColumnRange>&)> &blockFilter){
+    string filePath = "data/" + table + '/' + table +".data";
+    const SegmentStore *sealed = SegmentStore::forTable(table);
+    uint64_t base = sealed ? sealed->tailBase() : 0;
+    uint64_t dataSize = fs::exists(filePath) ? fs::file_size(filePath) : 0;
+    size_t threads = scanThreadCount;
+    const ZoneMap *zones = threads > 1 && dataSize >= PARALLEL_MIN_BYTES ? ZoneMap::forScan(table, base, dataSize) : nullptr;
+
+    //helpers for this scan, handed back to the budget when it returns
+    size_t helpers = 0;
+    if(zones){
+        helpers = takeHelpers(threads - 1);
+        if(helpers == 0) zones = nullptr;
+    }
+    struct HelperRelease{
+        size_t count;
+        ~HelperRelease(){ busyHelpers -= count; }
+    } release{helpers};
+
+    //small tail, one thread, no offset directory or no free helper: the plain scan as worker 0,
+    //shareDone every SERIAL_ROUND rows so kept rows do not pile up
+    if(!zones){
+        size_t rows = 0;
+        bool found = scanColumns(table, schema, wanted,
+            [&](uint64_t offset, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+                visit(0, offset, bytes, fields);
+                if(++rows % SERIAL_ROUND == 0 && shareDone) shareDone(0);
+            }, blockFilter);
+        if(shareDone) shareDone(0);
+        return found;
+    }
+
+    Trace::Span span("record_io");
+    QueryStats::usePlan("parallel scan");
+    if(sealed){
+        sealed->scanColumns(schema, wanted,
+            [&](uint64_t offset, const vector<uint8_t> &bytes, const vector<RecordCodec::Field> &fields){
+                visit(0, offset, bytes, fields);
+            }, blockFilter);
+        if(shareDone) shareDone(0);
+    }
+
+    const vector<ZoneBlock> &blocks = zones->zones();
+    threads = helpers + 1;
+    uint64_t shareBytes = min(SHARE_BYTES, (dataSize + threads - 1) / threads);
+    size_t shareBlocks = max<uint64_t>(1, (shareBytes + ZoneMap::BLOCK_SIZE - 1) / ZoneMap::BLOCK_SIZE);
+
+    size_t workerCount = min<size_t>(threads, (blocks.size() + shareBlocks - 1) / shareBlocks);
+
+    vector<pair<size_t,size_t>> shares;     //this round's, by worker
+    vector<char> shareOk(workerCount, true);
+    vector<QueryStats::Counters> reads(workerCount);
+    auto runShare = [&](size_t worker){
+        vector<RecordCodec::Field> fields;
+        shareOk[worker] = scanBlocks(filePath, base, blocks, shares[worker].first, shares[worker].second, blockFilter,
+            [&](uint64_t offset, const vector<uint8_t> &recordData){
+                RecordCodec::decode(schema, recordData, fields, wanted);
+                visit(worker, offset, recordData, fields);
+            });
+    };
+
+    //workers 1.. live for the whole scan (and keep their io_uring): each round they wait
+    //for the caller to hand out the shares, run theirs and report back
+    mutex roundMutex;
+    condition_variable roundReady, roundDone;
+    size_t round = 0;          //rounds handed out so far
+    size_t running = 0;        //workers not back from this round
+    bool scanOver = false;
+    uint64_t queryId = Trace::currentQuery();
+
+    vector<thread> workers;
+    for(size_t worker = 1; worker < workerCount; worker++){
+        workers.emplace_back([&, worker](){
+            Trace::QueryWorker trace(queryId);
+            for(size_t seen = 0; ; seen++){
+                {
+                    unique_lock<mutex> lock(roundMutex);
+                    roundReady.wait(lock, [&](){ return scanOver || round > seen; });
+                    if(round == seen) return;
+                }
+                //the last round can have fewer shares than workers
+                if(worker < shares.size()){
+                    Trace::Span span("record_io");
+                    QueryStats::begin();
+                    runShare(worker);
+                    reads[worker] = QueryStats::current();
+                }
+                lock_guard<mutex> lock(roundMutex);
+                if(--running == 0) roundDone.notify_one();
+            }
+        });
+    }
+
+    bool ok = true;
+    size_t next = 0;
+    while(next < blocks.size() && ok){
+        {
+            lock_guard<mutex> lock(roundMutex);
+            shares.clear();
+            while(shares.size() < workerCount && next < blocks.size()){
+                shares.push_back({next, min(blocks.size(), next + shareBlocks)});
+                next = shares.back().second;
+            }
+            running = workers.size();
+            round++;
+        }
+        roundReady.notify_all();
+        runShare(0);
+        {
+            unique_lock<mutex> lock(roundMutex);
+            roundDone.wait(lock, [&](){ return running == 0; });
+        }
+
+        for(size_t worker = 0; worker < shares.size(); worker++){
+            if(worker > 0) QueryStats::addReads(reads[worker].recordsRead, reads[worker].bytesRead);
+            if(shareDone) shareDone(worker);
+            ok = ok && shareOk[worker];
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(roundMutex);
+        scanOver = true;
+    }
+    roundReady.notify_all();
+    for(thread &worker : workers) worker.join();
+    return ok;
+}
+
+bool FileManager::countRecords(const string &table, uint64_t &count){
+    count = 0;
+    string filePath = "data/" + table + '/' + table +".data";
+    if(!fs::exists(filePath)) return false;
+
+    const SegmentStore *sealed = SegmentStore::forTable(table);
+    if(sealed && !sealed->liveRecords(count)) return false;
+
+    const ZoneMap *zones = ZoneMap::forScan(table, sealed ? sealed->tailBase() : 0, fs::file_size(filePath));
+    if(!zones) return false;
+
+    for(const ZoneBlock &block : zones->zones()) count += block.live;
+    QueryStats::usePlan("row count metadata");
+    return true;
+}
+
 /*
   Overwrite record at specific offset with new data
   Used for in-place UPDATE operations
@@ -97,8 +629,13 @@ vector<uint8_t> FileManager::readRecord(const string &table,uint64_t offset){
   Only allow in-place update if EXACT same size (varint + data)
   This prevents any corruption of adjacent records.
   For any size change, return false to trigger append + tombstone.
+  Sealed records are never rewritten either.
  */
 bool FileManager::overwriteRecord(const string &table, uint64_t offset, vector<uint8_t> &records){
+    Trace::Span span("record_io");
+
+    uint64_t base = tailBase(table);
+    if(offset < base) return false;
 
     string filePath = "data/" + table + '/' + table +".data";
     if(!fs::exists(filePath)){
@@ -112,32 +649,26 @@ bool FileManager::overwriteRecord(const string &table, uint64_t offset, vector<u
         return false;  
     }
 
-    file.seekg(offset);
-    vector<uint8_t> lengthBuffer;
-    
-    for(size_t i = 0; i < 10; ++i){ 
-        char c;
-        file.get(c);
-        lengthBuffer.push_back(static_cast<uint8_t>(c));
-        if((lengthBuffer.back() & 0x80) == 0){
-            break  ;  
-        }
-    }
+    file.seekg(offset - base);
+    uint8_t lengthBuffer[Varint::MAX_BYTES];
+    size_t lengthSize = readLengthBytes(file, lengthBuffer);
 
     size_t oldVarIntSize = 0;
-    uint64_t oldRecordLength = Varint::decode(lengthBuffer, 0, oldVarIntSize);
+    uint64_t oldRecordLength = Varint::decode(lengthBuffer, lengthBuffer + lengthSize, oldVarIntSize);
     
-    auto newVarInt = Varint::encode(records.size());
-    uint64_t newVarIntSize = newVarInt.size();
+    uint8_t newVarInt[Varint::MAX_BYTES];
+    uint64_t newVarIntSize = Varint::encodeTo(newVarInt, records.size());
     
     uint64_t oldTotalSize = oldVarIntSize + oldRecordLength;
     uint64_t newTotalSize = newVarIntSize + records.size();
     
     if(newTotalSize == oldTotalSize){
-        file.seekp(offset);
-        file.write(reinterpret_cast<const char*>(newVarInt.data()), newVarIntSize);
+        file.seekp(offset - base);
+        file.write(reinterpret_cast<const char*>(newVarInt), newVarIntSize);
         file.write(reinterpret_cast<const char*>(records.data()), records.size());
         file.close();
+        Metrics::addDataBytesWritten(newTotalSize);
+        ZoneMap::recordChanged(table, base, offset - base, records, fs::file_size(filePath));
         return true;
     }
     
@@ -147,6 +678,13 @@ bool FileManager::overwriteRecord(const string &table, uint64_t offset, vector<u
 }
 
 void FileManager::markDeleted(const string &table, uint64_t offset){
+    Trace::Span span("record_io");
+
+    uint64_t base = tailBase(table);
+    if(offset < base){
+        SegmentStore::markDeleted(table, offset);
+        return;
+    }
 
     string filePath = "data/" + table + '/' + table +".data";
     if(!fs::exists(filePath)){
@@ -160,22 +698,18 @@ void FileManager::markDeleted(const string &table, uint64_t offset){
         return;  
     }
 
-    file.seekg(offset);
-    vector<uint8_t> lengthBuffer;
-    
-    for(size_t i = 0; i < 10; ++i){ 
-        char c;
-        file.get(c);
-        lengthBuffer.push_back(static_cast<uint8_t>(c));
-        if((lengthBuffer.back() & 0x80) == 0){
-            break;  
-        }
-    }
+    file.seekg(offset - base);
+    uint8_t lengthBuffer[Varint::MAX_BYTES];
+    size_t lengthSize = readLengthBytes(file, lengthBuffer);
 
     size_t readBytes = 0;
-    uint64_t recordLength = Varint::decode(lengthBuffer, 0, readBytes);
+    uint64_t recordLength = Varint::decode(lengthBuffer, lengthBuffer + lengthSize, readBytes);
+    if(readBytes == 0){
+        cerr << "Bad record length at offset " << offset << endl;
+        return;
+    }
     
-    file.seekp(offset);
+    file.seekp(offset - base);
     uint8_t zero = 0x00;
     file.write(reinterpret_cast<const char*>(&zero), 1);
 
@@ -188,15 +722,17 @@ void FileManager::markDeleted(const string &table, uint64_t offset){
     */
 
     uint64_t remainingAfterTombstone = (readBytes - 1) + recordLength;
-    auto skipVarint = Varint::encode(remainingAfterTombstone);
-    uint64_t actualSkip = remainingAfterTombstone - skipVarint.size();
-    skipVarint = Varint::encode(actualSkip);
+    uint64_t actualSkip = remainingAfterTombstone - Varint::encodedSize(remainingAfterTombstone);
+    uint8_t skipVarint[Varint::MAX_BYTES];
+    size_t skipSize = Varint::encodeTo(skipVarint, actualSkip);
     
-    file.write(reinterpret_cast<const char*>(skipVarint.data()), skipVarint.size());  
+    file.write(reinterpret_cast<const char*>(skipVarint), skipSize);  
     file.close();
+    Metrics::addDataBytesWritten(1 + skipSize);
+    ZoneMap::recordRemoved(table, base, offset - base, fs::file_size(filePath));
 }
 
-void FileManager::writeMeta(const string &table, vector<pair<string,string>> &cols, const string &primaryCol){
+void FileManager::writeMeta(const string &table, vector<pair<string,string>> &cols, const string &primaryCol, int format){
 
     fs::create_directories("data/" + table);
     string filePath = "data/" + table +"/" + table + ".meta";
@@ -208,6 +744,9 @@ void FileManager::writeMeta(const string &table, vector<pair<string,string>> &co
     }
 
     columnRecord << "COLUMN: " << cols.size() << "\n";
+    if(format != RecordCodec::FORMAT_TAGGED){
+        columnRecord << "FORMAT: " << format << "\n";
+    }
 
     //write meta
     for(auto &c : cols){
@@ -223,8 +762,14 @@ void FileManager::writeMeta(const string &table, vector<pair<string,string>> &co
 }
 
 bool FileManager::readMeta(const string &table, vector <pair<string,string>> &cols,string &primaryCol){
+    int format = RecordCodec::FORMAT_TAGGED;
+    return readMeta(table, cols, primaryCol, format);
+}
+
+bool FileManager::readMeta(const string &table, vector <pair<string,string>> &cols,string &primaryCol, int &format){
     cols.clear();
     primaryCol ="";
+    format = RecordCodec::FORMAT_TAGGED;
 
     string filePath = "data/" + table +"/" + table + ".meta";
     if(!fs::exists(filePath)) return false;
@@ -248,6 +793,11 @@ bool FileManager::readMeta(const string &table, vector <pair<string,string>> &co
         string colName, colType, primaryK;
         iss >> colName >> colType >> primaryK;
 
+        if(colName == "FORMAT:"){
+            try{ format = stoi(colType); }catch(...){}
+            continue;
+        }
+
         cols.push_back({colName,colType});
 
         if(primaryK == "PRIMARY"){
@@ -2,6 +2,8 @@
 #include<vector>
 #include<cstdint>
 #include<string>
+#include<functional>
+#include"record_codec.h"
 
 class FileManager{
 
@@ -13,16 +15,52 @@ class FileManager{
         //Reading record form table
         static std::vector<uint8_t> readRecord(const std::string &table, uint64_t offset);
 
+        //Read many records at once: offsets are sorted and nearby ones share one large read.
+        //visit gets (position in offsets, record) in the order of offsets, a deleted record comes empty
+        static void readRecords(const std::string &table, const std::vector<uint64_t> &offsets,
+                                const std::function<void(size_t index, const std::vector<uint8_t> &record)> &visit);
+
         //Overwrite record at offset,Returns true if successful, false if record is smaller than space available
         static bool overwriteRecord(const std::string &table, uint64_t offset, std::vector<uint8_t> &records);
 
+        //Walk every live record in file order, tombstones are skipped. Returns false if table has no data file
+        static bool scanRecords(const std::string &table, const std::function<void(uint64_t offset, const std::vector<uint8_t> &record)> &visit);
+
+        //Same walk for queries that use only some columns: wanted[i] marks column i, fields of the
+        //others stay NULL. Columnar sealed blocks decode just the wanted columns, fields point into bytes
+        //(column data there, not a record; with no column wanted bytes is always the stored record).
+        //blockFilter gets the per column min/max of a block and returns false when no row in it can match
+        static bool scanColumns(const std::string &table, const RecordCodec::Schema &schema, const std::vector<bool> &wanted,
+                                const std::function<void(uint64_t offset, const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &fields)> &visit,
+                                const std::function<bool(const std::vector<RecordCodec::ColumnRange> &ranges)> &blockFilter = nullptr);
+
+        //scanColumns over many threads: the tail is cut into shares at zone map blocks, each worker
+        //(0 is the calling thread) decodes its share and calls visit(worker, ...) on its own thread.
+        //After each round shareDone(worker) runs on the calling thread for the workers in file order,
+        //so rows kept per worker can be emitted in order. Small tails and tables without a zone map
+        //run on the calling thread as worker 0 alone, with a shareDone(0) every 1024 rows
+        static bool scanParallel(const std::string &table, const RecordCodec::Schema &schema, const std::vector<bool> &wanted,
+                                 const std::function<void(size_t worker, uint64_t offset, const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &fields)> &visit,
+                                 const std::function<void(size_t worker)> &shareDone = nullptr,
+                                 const std::function<bool(const std::vector<RecordCodec::ColumnRange> &ranges)> &blockFilter = nullptr);
+
+        //most workers scanParallel uses (default: the hardware threads)
+        static void setScanThreads(size_t threads);
+        static size_t scanThreads();
+
+        //Live record count without a scan: sealed directory count plus the zone map's per block counts.
+        //False when one of them is missing or stale, the caller has to scan
+        static bool countRecords(const std::string &table, uint64_t &count);
+
         //Mark record as deleted (tombstone approach)
         static void markDeleted(const std::string &table, uint64_t offset);
 
-        //for write meta
-        static void writeMeta(const std::string &table, std::vector<std::pair<std::string,std::string>> &cols, const std::string &primaryCol = ""); 
+        //for write meta, new tables use the v2 record format (see record_codec.h)
+        static void writeMeta(const std::string &table, std::vector<std::pair<std::string,std::string>> &cols, const std::string &primaryCol = "", int format = RecordCodec::FORMAT_BITMAP); 
 
         //for read meta
         static bool readMeta(const std::string &table, std::vector<std::pair<std::string,std::string>> &cols, std::string &primaryCol);
+        //same, plus the record format; tables without a FORMAT line are v1
+        static bool readMeta(const std::string &table, std::vector<std::pair<std::string,std::string>> &cols, std::string &primaryCol, int &format);
 
 };
\ No newline at end of file
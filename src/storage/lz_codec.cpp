@@ -0,0 +1,122 @@
+#include "lz_codec.h"
+#include <cstring>
+
+namespace LZ{
+
+    static const size_t MIN_MATCH = 4;
+    static const size_t MAX_DISTANCE = 65535;
+    static const int HASH_BITS = 13;
+    //the last bytes always go out as literals so the decoder never reads past a match
+    static const size_t END_LITERALS = 5;
+
+    static uint32_t hash4(const uint8_t *p){
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    static void writeLength(std::vector<uint8_t> &out, size_t length){
+        while(length >= 255){
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<uint8_t>(length));
+    }
+
+    static void writeSequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literalCount,
+                              size_t distance, size_t matchLength){
+        size_t matchCode = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+        uint8_t token = static_cast<uint8_t>((literalCount < 15 ? literalCount : 15) << 4);
+        token |= static_cast<uint8_t>(matchCode < 15 ? matchCode : 15);
+        out.push_back(token);
+
+        if(literalCount >= 15) writeLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+
+        if(matchLength == 0) return;   //last sequence
+        out.push_back(static_cast<uint8_t>(distance & 0xFF));
+        out.push_back(static_cast<uint8_t>(distance >> 8));
+        if(matchCode >= 15) writeLength(out, matchCode - 15);
+    }
+
+    void compress(const uint8_t *input, size_t size, std::vector<uint8_t> &out){
+        out.clear();
+        out.reserve(size / 2 + 16);
+
+        std::vector<uint32_t> table(1u << HASH_BITS, UINT32_MAX);
+        size_t anchor = 0;
+        size_t pos = 0;
+        size_t limit = size > END_LITERALS + MIN_MATCH ? size - END_LITERALS : 0;
+
+        while(pos + MIN_MATCH <= limit){
+            uint32_t h = hash4(input + pos);
+            uint32_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(pos);
+
+            if(candidate == UINT32_MAX || pos - candidate > MAX_DISTANCE ||
+               memcmp(input + candidate, input + pos, MIN_MATCH) != 0){
+                pos++;
+                continue;
+            }
+
+            size_t length = MIN_MATCH;
+            while(pos + length < limit && input[candidate + length] == input[pos + length]){
+                length++;
+            }
+
+            writeSequence(out, input + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+        }
+
+        writeSequence(out, input + anchor, size - anchor, 0, 0);
+    }
+
+    static bool readLength(const uint8_t *input, size_t size, size_t &ip, size_t &length){
+        uint8_t byte;
+        do{
+            if(ip >= size) return false;
+            byte = input[ip++];
+            length += byte;
+        }while(byte == 255);
+        return true;
+    }
+
+    bool decompress(const uint8_t *input, size_t size, uint8_t *out, size_t rawSize){
+        size_t ip = 0;
+        size_t op = 0;
+
+        while(ip < size){
+            uint8_t token = input[ip++];
+
+            size_t literalCount = token >> 4;
+            if(literalCount == 15 && !readLength(input, size, ip, literalCount)) return false;
+            if(literalCount > size - ip || literalCount > rawSize - op) return false;
+            memcpy(out + op, input + ip, literalCount);
+            ip += literalCount;
+            op += literalCount;
+
+            if(ip == size) break;   //last sequence has no match
+
+            if(size - ip < 2) return false;
+            size_t distance = input[ip] | (static_cast<size_t>(input[ip + 1]) << 8);
+            ip += 2;
+            if(distance == 0 || distance > op) return false;
+
+            size_t matchLength = token & 15;
+            if(matchLength == 15 && !readLength(input, size, ip, matchLength)) return false;
+            matchLength += MIN_MATCH;
+            if(matchLength > rawSize - op) return false;
+
+            const uint8_t *from = out + op - distance;
+            if(distance >= matchLength){
+                memcpy(out + op, from, matchLength);
+            }else{
+                for(size_t i = 0; i < matchLength; i++) out[op + i] = from[i];   //overlapping run
+            }
+            op += matchLength;
+        }
+
+        return op == rawSize;
+    }
+}
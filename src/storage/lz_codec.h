@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+  Small LZ77 block codec for sealed segments, no outside library.
+
+  A block is a list of sequences:
+    token        high nibble literal count, low nibble match length - 4
+                 (15 means more length bytes follow, each 255 adds and continues)
+    literals
+    offset       2 bytes little endian, distance back into the output
+  The last sequence only has literals. Matches are found with a 4 byte hash
+  table, so compression is one pass and decompression is plain copying.
+*/
+namespace LZ{
+
+    void compress(const uint8_t *input, size_t size, std::vector<uint8_t> &out);
+
+    //rawSize is the exact decompressed size, false on damaged input
+    bool decompress(const uint8_t *input, size_t size, uint8_t *out, size_t rawSize);
+
+}
@@ -0,0 +1,333 @@
+#include "record_codec.h"
+#include "varint.h"
+#include "bitfield.h"
+#include "dictionary.h"
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+
+namespace RecordCodec{
+
+    ColumnType columnType(const std::string &typeName){
+        std::string upper = typeName;
+        for(auto &c : upper) c = toupper(c);
+
+        if(upper == "INT") return ColumnType::INT;
+        if(upper == "FLOAT") return ColumnType::FLOAT;
+        if(upper == "BOOL") return ColumnType::BOOL;
+        if(upper == "DICT") return ColumnType::DICT;
+        return ColumnType::TEXT;
+    }
+
+    char typeFlag(ColumnType type){
+        switch(type){
+            case ColumnType::INT: return 'I';
+            case ColumnType::FLOAT: return 'F';
+            case ColumnType::BOOL: return 'B';
+            default: return 'S';
+        }
+    }
+
+    Schema makeSchema(const std::vector<std::pair<std::string,std::string>> &metaInfo, int format,
+                      const std::string &table){
+        Schema schema;
+        schema.format = format;
+        schema.headerBits = metaInfo.size();
+
+        for(auto &col : metaInfo){
+            ColumnType type = columnType(col.second);
+            //v1 records have no code field, keep the text
+            if(type == ColumnType::DICT && format == FORMAT_TAGGED) type = ColumnType::TEXT;
+
+            schema.types.push_back(type);
+            schema.boolBit.push_back(type == ColumnType::BOOL ? schema.headerBits++ : 0);
+            schema.dicts.push_back(type == ColumnType::DICT && !table.empty() ? Dictionary::forColumn(table, col.first) : nullptr);
+        }
+        return schema;
+    }
+
+    static uint64_t parseInt(const std::string &value){
+        try{
+            if(!value.empty()) return std::stoull(value);
+        }catch(...){}
+        return 0;
+    }
+
+    static float parseFloat(const std::string &value){
+        try{
+            if(!value.empty()) return std::stof(value);
+        }catch(...){}
+        return 0.0f;
+    }
+
+    static bool parseBool(const std::string &value){
+        return value == "true" || value == "1";
+    }
+
+    static void appendFloat(std::vector<uint8_t> &out, float value){
+        uint8_t temp[4];
+        memcpy(temp, &value, 4);
+        out.insert(out.end(), temp, temp + 4);
+    }
+
+    static void appendText(std::vector<uint8_t> &out, const std::string &value){
+        Varint::append(out, value.size());
+        out.insert(out.end(), value.begin(), value.end());
+    }
+
+    static std::vector<uint8_t> encodeTagged(const Schema &schema, const std::vector<std::string> &values){
+        std::vector<uint8_t> out;
+        static const std::string empty;
+
+        for(size_t i = 0; i < schema.types.size(); i++){
+            const std::string &value = i < values.size() ? values[i] : empty;
+            out.push_back(typeFlag(schema.types[i]));
+
+            switch(schema.types[i]){
+                case ColumnType::INT: Varint::append(out, parseInt(value)); break;
+                case ColumnType::FLOAT: appendFloat(out, parseFloat(value)); break;
+                case ColumnType::BOOL: out.push_back(parseBool(value) ? 1 : 0); break;
+                case ColumnType::TEXT:
+                case ColumnType::DICT: appendText(out, value); break;
+            }
+        }
+        return out;
+    }
+
+    bool encode(const Schema &schema, const std::vector<std::string> &values, const std::vector<bool> &nulls,
+                std::vector<uint8_t> &out){
+        if(schema.format == FORMAT_TAGGED){
+            out = encodeTagged(schema, values);
+            return true;
+        }
+
+        out.assign(Bitfield::bytesFor(schema.headerBits), 0);
+        static const std::string empty;
+        uint64_t code = 0;
+
+        for(size_t i = 0; i < schema.types.size(); i++){
+            if(i < nulls.size() && nulls[i]){
+                Bitfield::set(out.data(), i, true);
+                continue;
+            }
+            const std::string &value = i < values.size() ? values[i] : empty;
+
+            switch(schema.types[i]){
+                case ColumnType::INT: Varint::append(out, parseInt(value)); break;
+                case ColumnType::FLOAT: appendFloat(out, parseFloat(value)); break;
+                case ColumnType::BOOL: Bitfield::set(out.data(), schema.boolBit[i], parseBool(value)); break;
+                case ColumnType::TEXT: appendText(out, value); break;
+                case ColumnType::DICT:
+                    code = 0;
+                    if(schema.dicts[i] && !schema.dicts[i]->codeFor(value, code)) return false;
+                    Varint::append(out, code);
+                    break;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> encode(const Schema &schema, const std::vector<std::string> &values, const std::vector<bool> &nulls){
+        std::vector<uint8_t> out;
+        encode(schema, values, nulls, out);
+        return out;
+    }
+
+    //read one stored value of the given type at pos, false if it runs past the record
+    static bool readValue(ColumnType type, const std::vector<uint8_t> &record, size_t &pos, Field &field){
+        const uint8_t *end = record.data() + record.size();
+        size_t r = 0;
+        field.start = pos;
+
+        switch(type){
+            case ColumnType::INT:
+            case ColumnType::DICT:
+                field.intValue = Varint::decode(record.data() + pos, end, r);
+                if(r == 0) return false;
+                pos += r;
+                break;
+            case ColumnType::FLOAT:
+                if(pos + 4 > record.size()) return false;
+                memcpy(&field.floatValue, record.data() + pos, 4);
+                pos += 4;
+                break;
+            case ColumnType::BOOL:
+                if(pos + 1 > record.size()) return false;
+                field.intValue = record[pos++] ? 1 : 0;
+                break;
+            case ColumnType::TEXT:
+                field.intValue = Varint::decode(record.data() + pos, end, r);
+                if(r == 0 || pos + r + field.intValue > record.size()) return false;
+                field.textStart = pos + r;
+                pos += r + field.intValue;
+                break;
+        }
+        field.length = pos - field.start;
+        return true;
+    }
+
+    static ColumnType typeFromFlag(char flag, bool &known){
+        known = true;
+        switch(flag){
+            case 'I': return ColumnType::INT;
+            case 'F': return ColumnType::FLOAT;
+            case 'B': return ColumnType::BOOL;
+            case 'S': return ColumnType::TEXT;
+        }
+        known = false;
+        return ColumnType::TEXT;
+    }
+
+    //step over one stored value without decoding it
+    static bool skipValue(ColumnType type, const std::vector<uint8_t> &record, size_t &pos){
+        size_t r = 0;
+        uint64_t length = 0;
+
+        switch(type){
+            case ColumnType::INT:
+            case ColumnType::DICT:
+                while(pos < record.size() && (record[pos] & 0x80)) pos++;
+                if(pos >= record.size()) return false;
+                pos++;
+                return true;
+            case ColumnType::FLOAT:
+                pos += 4;
+                return pos <= record.size();
+            case ColumnType::BOOL:
+                pos += 1;
+                return pos <= record.size();
+            case ColumnType::TEXT:
+                length = Varint::decode(record.data() + pos, record.data() + record.size(), r);
+                if(r == 0 || pos + r + length > record.size()) return false;
+                pos += r + length;
+                return true;
+        }
+        return false;
+    }
+
+    static bool decodeTagged(const Schema &schema, const std::vector<uint8_t> &record, std::vector<Field> &fields,
+                             const std::vector<bool> *wanted){
+        size_t pos = 0;
+
+        for(size_t i = 0; i < schema.types.size(); i++){
+            if(pos >= record.size()) return false;
+
+            //walk by the stored tag, a field whose tag disagrees with the schema reads as NULL
+            bool known = false;
+            ColumnType stored = typeFromFlag(record[pos++], known);
+            if(!known) return false;
+
+            if(wanted && !(*wanted)[i]){
+                if(!skipValue(stored, record, pos)) return false;
+                continue;
+            }
+
+            Field field;
+            if(!readValue(stored, record, pos, field)) return false;
+            if(stored == schema.types[i]){
+                field.isNull = false;
+                fields[i] = field;
+            }
+        }
+        return true;
+    }
+
+    static bool decodeFields(const Schema &schema, const std::vector<uint8_t> &record, std::vector<Field> &fields,
+                             const std::vector<bool> *wanted){
+        fields.assign(schema.types.size(), Field());
+
+        if(schema.format == FORMAT_TAGGED){
+            return decodeTagged(schema, record, fields, wanted);
+        }
+
+        size_t pos = Bitfield::bytesFor(schema.headerBits);
+        if(record.size() < pos) return false;
+        const uint8_t *header = record.data();
+
+        for(size_t i = 0; i < schema.types.size(); i++){
+            if(Bitfield::get(header, i)) continue;
+
+            if(wanted && !(*wanted)[i]){
+                if(schema.types[i] != ColumnType::BOOL && !skipValue(schema.types[i], record, pos)) return false;
+                continue;
+            }
+
+            Field &field = fields[i];
+            if(schema.types[i] == ColumnType::BOOL){
+                field.intValue = Bitfield::get(header, schema.boolBit[i]) ? 1 : 0;
+                field.start = pos;
+            }else if(!readValue(schema.types[i], record, pos, field)){
+                field = Field();
+                return false;
+            }
+            field.isNull = false;
+        }
+        return true;
+    }
+
+    bool decode(const Schema &schema, const std::vector<uint8_t> &record, std::vector<Field> &fields){
+        return decodeFields(schema, record, fields, nullptr);
+    }
+
+    bool decode(const Schema &schema, const std::vector<uint8_t> &record, std::vector<Field> &fields, const std::vector<bool> &wanted){
+        return decodeFields(schema, record, fields, &wanted);
+    }
+
+    bool decodeField(const Schema &schema, size_t column, const std::vector<uint8_t> &bytes, size_t &pos, Field &field){
+        field = Field();
+        if(!readValue(schema.types[column], bytes, pos, field)) return false;
+        field.isNull = false;
+        return true;
+    }
+
+    void ColumnRange::add(ColumnType type, const Field &field){
+        if(field.isNull) return;
+
+        if(type == ColumnType::INT){
+            if(!known || field.intValue < minInt) minInt = field.intValue;
+            if(!known || field.intValue > maxInt) maxInt = field.intValue;
+            known = true;
+        }else if(type == ColumnType::FLOAT){
+            if(!known || field.floatValue < minFloat) minFloat = field.floatValue;
+            if(!known || field.floatValue > maxFloat) maxFloat = field.floatValue;
+            known = true;
+        }
+    }
+
+    std::string toString(const Schema &schema, const std::vector<uint8_t> &record, const Field &field, size_t column){
+        if(field.isNull) return "NULL";
+
+        switch(schema.types[column]){
+            case ColumnType::INT:
+                return std::to_string(field.intValue);
+            case ColumnType::FLOAT:{
+                char text[32];
+                snprintf(text, sizeof(text), "%g", field.floatValue);   //same as cout << float
+                return text;
+            }
+            case ColumnType::BOOL:
+                return field.intValue ? "true" : "false";
+            case ColumnType::TEXT:
+                return std::string(reinterpret_cast<const char*>(record.data() + field.textStart), field.intValue);
+            case ColumnType::DICT:
+                return schema.dicts[column] ? schema.dicts[column]->text(field.intValue) : std::to_string(field.intValue);
+        }
+        return "";
+    }
+
+    void decodeValues(const Schema &schema, const std::vector<uint8_t> &record,
+                      std::vector<std::string> &values, std::vector<bool> &nulls){
+        std::vector<Field> fields;
+        decode(schema, record, fields);
+
+        values.assign(fields.size(), "");
+        nulls.assign(fields.size(), false);
+        for(size_t i = 0; i < fields.size(); i++){
+            if(fields[i].isNull){
+                nulls[i] = true;
+            }else{
+                values[i] = toString(schema, record, fields[i], i);
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+class Dictionary;
+
+/*
+  Record layout, chosen per table by the FORMAT line in .meta.
+
+  v1 (tables created before FORMAT existed): every field starts with a tag
+      'I' varint | 'F' 4 raw bytes | 'B' 1 byte | 'S' varint length + bytes
+
+  v2: [header bitmap][fields in column order, no tags]
+      header bit i            -> column i is NULL
+      header bit columns + k  -> value of the k-th BOOL column
+      INT varint, FLOAT 4 raw bytes, TEXT varint length + bytes.
+      BOOL and NULL fields take no bytes after the header.
+      DICT (TEXT with a dictionary) stores the varint code of the value.
+
+  The schema already fixes every type, so v2 only pays one bit per column
+  for NULL instead of one tag byte per field.
+*/
+namespace RecordCodec{
+
+    const int FORMAT_TAGGED = 1;
+    const int FORMAT_BITMAP = 2;
+
+    enum class ColumnType{ INT, FLOAT, BOOL, TEXT, DICT };
+
+    ColumnType columnType(const std::string &typeName);
+    //'I','F','B','S' as used by v1 records and result payloads, DICT reads as 'S'
+    char typeFlag(ColumnType type);
+
+    struct Schema{
+        int format = FORMAT_TAGGED;
+        std::vector<ColumnType> types;
+        std::vector<size_t> boolBit;   //header bit holding the value, BOOL columns only
+        std::vector<Dictionary*> dicts;  //DICT columns only, nullptr elsewhere
+        size_t headerBits = 0;
+    };
+
+    //pass the table to load the dictionaries of its DICT columns
+    Schema makeSchema(const std::vector<std::pair<std::string,std::string>> &metaInfo, int format,
+                      const std::string &table = "");
+
+    //one decoded field, start/length point at the stored value bytes inside the record
+    struct Field{
+        bool isNull = true;
+        uint64_t intValue = 0;     //INT value, BOOL 0/1, TEXT length, DICT code
+        float floatValue = 0.0f;
+        size_t start = 0;
+        size_t length = 0;
+        size_t textStart = 0;      //TEXT bytes after the length varint
+    };
+
+    //min/max of an INT or FLOAT column over a set of rows, other types stay unknown
+    struct ColumnRange{
+        bool known = false;
+        uint64_t minInt = 0, maxInt = 0;
+        float minFloat = 0.0f, maxFloat = 0.0f;
+
+        void add(ColumnType type, const Field &field);
+    };
+
+    //values are text as typed by the user, nulls[i] marks a NULL (ignored by v1);
+    //false if a new DICT value could not be added to its dictionary, out is unusable then
+    bool encode(const Schema &schema, const std::vector<std::string> &values, const std::vector<bool> &nulls,
+                std::vector<uint8_t> &out);
+    //same for schemas without dictionaries (query results), which cannot fail
+    std::vector<uint8_t> encode(const Schema &schema, const std::vector<std::string> &values, const std::vector<bool> &nulls);
+
+    //one Field per column; false on a damaged record, fields not reached stay NULL
+    bool decode(const Schema &schema, const std::vector<uint8_t> &record, std::vector<Field> &fields);
+    //same, but only columns with wanted[i] are decoded, the rest are skipped by length and stay NULL
+    bool decode(const Schema &schema, const std::vector<uint8_t> &record, std::vector<Field> &fields, const std::vector<bool> &wanted);
+
+    //v2 only: read the stored bytes of one non BOOL column at pos, as laid out in a record
+    bool decodeField(const Schema &schema, size_t column, const std::vector<uint8_t> &bytes, size_t &pos, Field &field);
+
+    //text form for printing and index keys, "NULL" for null fields
+    std::string toString(const Schema &schema, const std::vector<uint8_t> &record, const Field &field, size_t column);
+
+    //decode straight to text, null fields give "" and nulls[i] = true
+    void decodeValues(const Schema &schema, const std::vector<uint8_t> &record,
+                      std::vector<std::string> &values, std::vector<bool> &nulls);
+}
@@ -0,0 +1,807 @@
+#include "segment_store.h"
+#include "lz_codec.h"
+#include "varint.h"
+#include "bitfield.h"
+#include "metrics.h"
+#include "query_stats.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const char DIRECTORY_MAGIC_V1[4] = {'P', 'S', 'E', 'G'};
+static const char DIRECTORY_MAGIC[4] = {'P', 'S', 'G', '2'};
+
+//chunks of a COLUMN_GROUP before the column chunks
+static const size_t OFFSET_CHUNK = 0;
+static const size_t HEADER_CHUNK = 1;
+static const size_t FIRST_COLUMN_CHUNK = 2;
+
+static string tablePath(const string &table, const string &extension){
+    return "data/" + table + "/" + table + extension;
+}
+
+static bool readFile(const string &filePath, vector<uint8_t> &bytes){
+    ifstream in(filePath, ios::binary);
+    if(!in) return false;
+    bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    return true;
+}
+
+//push a file or directory to disk, the seal's commit order relies on it
+static bool syncPath(const string &path){
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+static bool readVarint(const uint8_t *&pos, const uint8_t *end, uint64_t &value){
+    size_t readBytes = 0;
+    value = Varint::decode(pos, end, readBytes);
+    pos += readBytes;
+    return readBytes != 0;
+}
+
+//read size bytes at filePos of the segment file
+static bool readPacked(const string &segPath, uint64_t filePos, uint64_t size, vector<uint8_t> &packed){
+    ifstream in(segPath, ios::binary);
+    if(!in){
+        cerr << "ERROR opening segment file" << endl;
+        return false;
+    }
+
+    packed.resize(size);
+    in.seekg(filePos);
+    in.read(reinterpret_cast<char*>(packed.data()), size);
+    if(static_cast<uint64_t>(in.gcount()) != size){
+        cerr << "Segment file " << segPath << " is cut short\n";
+        return false;
+    }
+    Metrics::addDataBytesRead(size);
+    QueryStats::addBytesRead(size);
+    return true;
+}
+
+/* ---------- COLUMN_GROUP header ---------- */
+
+struct ColumnGroup{
+    uint64_t rows = 0;
+    uint64_t headerBytes = 0;    //record header size of every row
+    RecordCodec::Schema schema;  //types only, enough to walk the column chunks
+    vector<RecordCodec::ColumnRange> ranges;
+    vector<uint64_t> rawSizes;
+    vector<uint64_t> packedSizes;
+    vector<uint64_t> positions;  //in .seg
+};
+
+static void appendGroupHeader(vector<uint8_t> &out, const ColumnGroup &group){
+    Varint::append(out, group.rows);
+    Varint::append(out, group.schema.types.size());
+    Varint::append(out, group.headerBytes);
+
+    for(size_t c = 0; c < group.schema.types.size(); c++){
+        const RecordCodec::ColumnRange &range = group.ranges[c];
+        Varint::append(out, static_cast<uint64_t>(group.schema.types[c]));
+        Varint::append(out, range.known ? 1 : 0);
+        if(!range.known) continue;
+
+        if(group.schema.types[c] == RecordCodec::ColumnType::FLOAT){
+            uint32_t bits[2];
+            memcpy(&bits[0], &range.minFloat, 4);
+            memcpy(&bits[1], &range.maxFloat, 4);
+            Varint::append(out, bits[0]);
+            Varint::append(out, bits[1]);
+        }else{
+            Varint::append(out, range.minInt);
+            Varint::append(out, range.maxInt);
+        }
+    }
+
+    for(size_t i = 0; i < group.rawSizes.size(); i++){
+        Varint::append(out, group.rawSizes[i]);
+        Varint::append(out, group.packedSizes[i]);
+    }
+}
+
+static bool parseGroupHeader(const uint8_t *pos, const uint8_t *end, uint64_t firstChunkPos, ColumnGroup &group){
+    uint64_t columns = 0;
+    if(!readVarint(pos, end, group.rows) || !readVarint(pos, end, columns) ||
+       !readVarint(pos, end, group.headerBytes)){
+        return false;
+    }
+
+    group.schema = RecordCodec::Schema();
+    group.schema.format = RecordCodec::FORMAT_BITMAP;
+    group.schema.headerBits = columns;
+    group.ranges.assign(columns, RecordCodec::ColumnRange());
+
+    for(uint64_t c = 0; c < columns; c++){
+        uint64_t type = 0, known = 0;
+        if(!readVarint(pos, end, type) || !readVarint(pos, end, known) ||
+           type > static_cast<uint64_t>(RecordCodec::ColumnType::DICT)){
+            return false;
+        }
+        group.schema.types.push_back(static_cast<RecordCodec::ColumnType>(type));
+        bool isBool = group.schema.types[c] == RecordCodec::ColumnType::BOOL;
+        group.schema.boolBit.push_back(isBool ? group.schema.headerBits++ : 0);
+        if(!known) continue;
+
+        RecordCodec::ColumnRange &range = group.ranges[c];
+        uint64_t low = 0, high = 0;
+        if(!readVarint(pos, end, low) || !readVarint(pos, end, high)) return false;
+        range.known = true;
+        if(group.schema.types[c] == RecordCodec::ColumnType::FLOAT){
+            uint32_t bits[2] = {static_cast<uint32_t>(low), static_cast<uint32_t>(high)};
+            memcpy(&range.minFloat, &bits[0], 4);
+            memcpy(&range.maxFloat, &bits[1], 4);
+        }else{
+            range.minInt = low;
+            range.maxInt = high;
+        }
+    }
+
+    uint64_t filePos = firstChunkPos;
+    for(uint64_t i = 0; i < FIRST_COLUMN_CHUNK + columns; i++){
+        uint64_t rawSize = 0, packedSize = 0;
+        if(!readVarint(pos, end, rawSize) || !readVarint(pos, end, packedSize)) return false;
+        group.rawSizes.push_back(rawSize);
+        group.packedSizes.push_back(packedSize);
+        group.positions.push_back(filePos);
+        filePos += packedSize;
+    }
+    return true;
+}
+
+static bool readGroupHeader(const string &segPath, const SegmentBlock &block, ColumnGroup &group){
+    //the header is small, one short read normally covers it
+    vector<uint8_t> bytes;
+    if(!readPacked(segPath, block.filePos, min<uint64_t>(block.packedSize, 512), bytes)) return false;
+
+    size_t readBytes = 0;
+    uint64_t headerLength = Varint::decode(bytes.data(), bytes.data() + bytes.size(), readBytes);
+    if(readBytes == 0 || readBytes + headerLength > block.packedSize) return false;
+    if(readBytes + headerLength > bytes.size() &&
+       !readPacked(segPath, block.filePos, readBytes + headerLength, bytes)){
+        return false;
+    }
+
+    const uint8_t *header = bytes.data() + readBytes;
+    if(!parseGroupHeader(header, header + headerLength, block.filePos + readBytes + headerLength, group)){
+        cerr << "Damaged column group at " << block.filePos << " in " << segPath << "\n";
+        return false;
+    }
+    return true;
+}
+
+//decompress chunk i of a group and append it to out
+static bool readChunk(const string &segPath, const ColumnGroup &group, size_t chunk, vector<uint8_t> &out){
+    static thread_local vector<uint8_t> packed;
+    if(!readPacked(segPath, group.positions[chunk], group.packedSizes[chunk], packed)) return false;
+
+    size_t oldSize = out.size();
+    out.resize(oldSize + group.rawSizes[chunk]);
+    if(!LZ::decompress(packed.data(), packed.size(), out.data() + oldSize, group.rawSizes[chunk])){
+        cerr << "Damaged chunk at " << group.positions[chunk] << " in " << segPath << "\n";
+        return false;
+    }
+    return true;
+}
+
+//a live record of the .data file being sealed, positions inside that file
+struct SealedRow{
+    size_t offset = 0;
+    size_t payload = 0;
+    size_t length = 0;
+};
+
+//one column group per sealed range; false when a record does not split cleanly into columns
+static bool buildColumnGroup(const RecordCodec::Schema &schema, const vector<uint8_t> &tail,
+                             const vector<SealedRow> &rows, size_t blockStart, vector<uint8_t> &out){
+    ColumnGroup group;
+    group.rows = rows.size();
+    group.schema.types = schema.types;
+    group.headerBytes = Bitfield::bytesFor(schema.headerBits);
+    group.ranges.assign(schema.types.size(), RecordCodec::ColumnRange());
+
+    vector<vector<uint8_t>> chunks(FIRST_COLUMN_CHUNK + schema.types.size());
+    vector<uint8_t> record;
+    vector<RecordCodec::Field> fields;
+    size_t previous = blockStart;
+
+    for(const SealedRow &row : rows){
+        record.assign(tail.begin() + row.payload, tail.begin() + row.payload + row.length);
+        if(!RecordCodec::decode(schema, record, fields) || record.size() < group.headerBytes) return false;
+
+        size_t used = group.headerBytes;
+        Varint::append(chunks[OFFSET_CHUNK], row.offset - previous);
+        previous = row.offset;
+        chunks[HEADER_CHUNK].insert(chunks[HEADER_CHUNK].end(), record.begin(), record.begin() + group.headerBytes);
+
+        for(size_t c = 0; c < fields.size(); c++){
+            const RecordCodec::Field &field = fields[c];
+            group.ranges[c].add(schema.types[c], field);
+            if(field.isNull || schema.types[c] == RecordCodec::ColumnType::BOOL) continue;
+
+            chunks[FIRST_COLUMN_CHUNK + c].insert(chunks[FIRST_COLUMN_CHUNK + c].end(),
+                                                   record.begin() + field.start, record.begin() + field.start + field.length);
+            used += field.length;
+        }
+        if(used != record.size()) return false;
+    }
+
+    vector<uint8_t> packedChunks;
+    vector<uint8_t> packed;
+    for(auto &chunk : chunks){
+        LZ::compress(chunk.data(), chunk.size(), packed);
+        group.rawSizes.push_back(chunk.size());
+        group.packedSizes.push_back(packed.size());
+        packedChunks.insert(packedChunks.end(), packed.begin(), packed.end());
+    }
+
+    vector<uint8_t> header;
+    appendGroupHeader(header, group);
+    out.clear();
+    Varint::append(out, header.size());
+    out.insert(out.end(), header.begin(), header.end());
+    out.insert(out.end(), packedChunks.begin(), packedChunks.end());
+    return true;
+}
+
+//walk the records of a decompressed row block, tombstones written before the seal are skipped
+static void forEachRecord(const vector<uint8_t> &raw, uint64_t start,
+                          const function<void(uint64_t offset, const uint8_t *data, uint64_t length)> &visit){
+    const uint8_t *pos = raw.data();
+    const uint8_t *end = raw.data() + raw.size();
+
+    while(pos < end){
+        uint64_t recordOffset = start + (pos - raw.data());
+        uint64_t recordLength = 0;
+        if(!readVarint(pos, end, recordLength)) break;
+
+        if(recordLength == 0){
+            uint64_t bytesToSkip = 0;
+            if(!readVarint(pos, end, bytesToSkip) || bytesToSkip > static_cast<uint64_t>(end - pos)) break;
+            pos += bytesToSkip;
+            continue;
+        }
+
+        if(recordLength > static_cast<uint64_t>(end - pos)) break;
+        visit(recordOffset, pos, recordLength);
+        pos += recordLength;
+    }
+}
+
+//moves the temp files of a seal that got as far as its .sealing mark into place (see seal)
+static bool finishSeal(const string &table){
+    string markPath = tablePath(table, ".sealing");
+    if(!fs::exists(markPath)) return true;
+
+    static mutex finishMutex;
+    lock_guard<mutex> lock(finishMutex);
+    if(!fs::exists(markPath)) return true;   //another thread was first
+
+    error_code ec;
+    for(const char *extension : {".segidx", ".data"}){
+        string path = tablePath(table, extension);
+        if(fs::exists(path + ".tmp")) fs::rename(path + ".tmp", path, ec);
+        if(ec){
+            cerr << "ERROR replacing " << path << ": " << ec.message() << endl;
+            return false;
+        }
+        IndexFileStamp::fileChanged(path);
+    }
+    //the renames must be on disk before the mark goes
+    if(!syncPath("data/" + table)){
+        cerr << "ERROR syncing data/" << table << endl;
+        return false;
+    }
+    fs::remove(markPath, ec);
+    return true;
+}
+
+/* ---------- SegmentStore ---------- */
+
+bool SegmentStore::load(const string &table){
+    string directoryPath = tablePath(table, ".segidx");
+    string deadPath = tablePath(table, ".dead");
+    finishSeal(table);
+
+    if(!fs::exists(directoryPath)){
+        directoryStamp.forget();
+        blocks.clear();
+        base = 0;
+        return false;
+    }
+
+    if(!directoryStamp.matches(directoryPath)){
+        segPath = tablePath(table, ".seg");
+        blocks.clear();
+        base = 0;
+        sealedRecords = 0;
+        recordsKnown = false;
+
+        vector<uint8_t> bytes;
+        bool readOk = readFile(directoryPath, bytes) && bytes.size() >= 4;
+        bool hasLayout = readOk && memcmp(bytes.data(), DIRECTORY_MAGIC, 4) == 0;
+        if(!readOk || (!hasLayout && memcmp(bytes.data(), DIRECTORY_MAGIC_V1, 4) != 0)){
+            cerr << "Segment directory " << directoryPath << " is damaged\n";
+            directoryStamp.forget();
+            return false;
+        }
+
+        const uint8_t *pos = bytes.data() + 4;
+        const uint8_t *end = bytes.data() + bytes.size();
+        uint64_t count = 0;
+        if(!readVarint(pos, end, base) || !readVarint(pos, end, count)){
+            cerr << "Segment directory " << directoryPath << " is damaged\n";
+            directoryStamp.forget();
+            return false;
+        }
+
+        for(uint64_t i = 0; i < count; i++){
+            SegmentBlock block;
+            if((hasLayout && !readVarint(pos, end, block.layout)) ||
+               !readVarint(pos, end, block.start) || !readVarint(pos, end, block.rawSize) ||
+               !readVarint(pos, end, block.filePos) || !readVarint(pos, end, block.packedSize)){
+                cerr << "Segment directory " << directoryPath << " is cut short\n";
+                break;
+            }
+            blocks.push_back(block);
+        }
+        recordsKnown = hasLayout && blocks.size() == count && readVarint(pos, end, sealedRecords);
+        directoryStamp.remember(directoryPath);
+    }
+
+    if(!fs::exists(deadPath)){
+        deadStamp.forget();
+        dead.clear();
+    }else if(!deadStamp.matches(deadPath)){
+        dead.clear();
+        vector<uint8_t> bytes;
+        readFile(deadPath, bytes);
+
+        const uint8_t *pos = bytes.data();
+        const uint8_t *end = bytes.data() + bytes.size();
+        uint64_t offset = 0;
+        while(pos < end && readVarint(pos, end, offset)){
+            dead.insert(offset);
+        }
+        deadStamp.remember(deadPath);
+    }
+    return true;
+}
+
+bool SegmentStore::liveRecords(uint64_t &count) const{
+    if(!recordsKnown || dead.size() > sealedRecords) return false;
+    count = sealedRecords - dead.size();
+    return true;
+}
+
+//per thread like the SELECT indexes, the file stamps keep the copies in step
+static thread_local unordered_map<string, SegmentStore> stores;
+
+const SegmentStore* SegmentStore::forTable(const string &table){
+    SegmentStore &store = stores[table];
+    return store.load(table) ? &store : nullptr;
+}
+
+void SegmentStore::trimThreadCache(){
+    if(stores.size() > IndexFileStamp::CACHED_TABLES) stores.clear();
+}
+
+//raw .data bytes of the block's range; a column group is put back together record by record
+bool SegmentStore::readBlock(const SegmentBlock &block, vector<uint8_t> &raw) const{
+    if(block.layout == ROW_BLOCK){
+        static thread_local vector<uint8_t> packed;
+        if(!readPacked(segPath, block.filePos, block.packedSize, packed)) return false;
+
+        raw.resize(block.rawSize);
+        if(!LZ::decompress(packed.data(), packed.size(), raw.data(), raw.size())){
+            cerr << "Damaged block at " << block.filePos << " in " << segPath << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    ColumnGroup group;
+    if(!readGroupHeader(segPath, block, group)) return false;
+
+    vector<uint8_t> bytes;
+    vector<size_t> chunkStart;
+    for(size_t chunk = 0; chunk < group.rawSizes.size(); chunk++){
+        chunkStart.push_back(bytes.size());
+        if(!readChunk(segPath, group, chunk, bytes)) return false;
+    }
+
+    //zero bytes between records read as empty tombstones
+    raw.assign(block.rawSize, 0);
+    vector<size_t> cursor(chunkStart.begin() + FIRST_COLUMN_CHUNK, chunkStart.end());
+    const uint8_t *offsetPos = bytes.data() + chunkStart[OFFSET_CHUNK];
+    const uint8_t *offsetEnd = bytes.data() + chunkStart[HEADER_CHUNK];
+    uint64_t relative = 0;
+    vector<uint8_t> record;
+    RecordCodec::Field field;
+
+    for(uint64_t row = 0; row < group.rows; row++){
+        uint64_t delta = 0;
+        if(!readVarint(offsetPos, offsetEnd, delta)) return false;
+        relative += delta;
+
+        const uint8_t *header = bytes.data() + chunkStart[HEADER_CHUNK] + row * group.headerBytes;
+        record.assign(header, header + group.headerBytes);
+        for(size_t c = 0; c < group.schema.types.size(); c++){
+            if(Bitfield::get(header, c) || group.schema.types[c] == RecordCodec::ColumnType::BOOL) continue;
+
+            size_t pos = cursor[c];
+            if(!RecordCodec::decodeField(group.schema, c, bytes, pos, field)) return false;
+            record.insert(record.end(), bytes.begin() + cursor[c], bytes.begin() + pos);
+            cursor[c] = pos;
+        }
+
+        uint8_t length[Varint::MAX_BYTES];
+        size_t lengthSize = Varint::encodeTo(length, record.size());
+        if(relative + lengthSize + record.size() > raw.size()) return false;
+        memcpy(raw.data() + relative, length, lengthSize);
+        memcpy(raw.data() + relative + lengthSize, record.data(), record.size());
+    }
+    return true;
+}
+
+vector<uint8_t> SegmentStore::readRecord(uint64_t offset) const{
+    vector<uint8_t> recordData;
+    if(offset >= base || dead.count(offset)) return recordData;
+
+    //last block whose start is <= offset
+    auto it = upper_bound(blocks.begin(), blocks.end(), offset,
+                          [](uint64_t value, const SegmentBlock &block){ return value < block.start; });
+    if(it == blocks.begin()) return recordData;
+    const SegmentBlock &block = *(it - 1);
+    if(offset - block.start >= block.rawSize) return recordData;
+
+    //point reads tend to hit the same block again, keep the last one per thread
+    static thread_local string cachedPath;
+    static thread_local uint64_t cachedPos = UINT64_MAX;
+    static thread_local vector<uint8_t> cachedBlock;
+
+    if(cachedPos != block.filePos || cachedPath != segPath){
+        cachedPos = UINT64_MAX;
+        if(!readBlock(block, cachedBlock)) return recordData;
+        cachedPath = segPath;
+        cachedPos = block.filePos;
+    }
+
+    const uint8_t *pos = cachedBlock.data() + (offset - block.start);
+    const uint8_t *end = cachedBlock.data() + cachedBlock.size();
+    size_t readBytes = 0;
+    uint64_t recordLength = Varint::decode(pos, end, readBytes);
+    if(readBytes == 0 || recordLength == 0 || recordLength > static_cast<uint64_t>(end - pos - readBytes)){
+        return recordData;
+    }
+
+    recordData.assign(pos + readBytes, pos + readBytes + recordLength);
+    QueryStats::addRecordRead(0);   //bytes counted per block
+    return recordData;
+}
+
+void SegmentStore::scan(const function<void(uint64_t, const vector<uint8_t>&)> &visit) const{
+    vector<uint8_t> raw;
+    vector<uint8_t> recordData;
+
+    for(const SegmentBlock &block : blocks){
+        if(!readBlock(block, raw)) continue;
+
+        forEachRecord(raw, block.start, [&](uint64_t offset, const uint8_t *data, uint64_t length){
+            if(dead.count(offset)) return;
+            recordData.assign(data, data + length);
+            QueryStats::addRecordRead(0);
+            visit(offset, recordData);
+        });
+    }
+}
+
+void SegmentStore::scanColumnGroup(const SegmentBlock &block, const RecordCodec::Schema &schema, const vector<bool> &wanted,
+                                   const function<void(uint64_t, const vector<uint8_t>&, const vector<RecordCodec::Field>&)> &visit,
+                                   const function<bool(const vector<RecordCodec::ColumnRange>&)> &blockFilter) const{
+    ColumnGroup group;
+    if(!readGroupHeader(segPath, block, group)) return;
+    if(group.schema.types.size() != schema.types.size()){
+        cerr << "Column group at " << block.filePos << " does not match the table\n";
+        return;
+    }
+    if(blockFilter && !blockFilter(group.ranges)) return;
+
+    //offsets, headers and the wanted column chunks, nothing else is read
+    static thread_local vector<uint8_t> bytes;
+    bytes.clear();
+    if(!readChunk(segPath, group, OFFSET_CHUNK, bytes)) return;
+    size_t headerStart = bytes.size();
+    if(!readChunk(segPath, group, HEADER_CHUNK, bytes)) return;
+
+    vector<size_t> cursor(schema.types.size(), 0);
+    for(size_t c = 0; c < schema.types.size(); c++){
+        if(!wanted[c] || schema.types[c] == RecordCodec::ColumnType::BOOL) continue;
+        cursor[c] = bytes.size();
+        if(!readChunk(segPath, group, FIRST_COLUMN_CHUNK + c, bytes)) return;
+    }
+
+    const uint8_t *offsetPos = bytes.data();
+    const uint8_t *offsetEnd = bytes.data() + headerStart;
+    uint64_t offset = block.start;
+    vector<RecordCodec::Field> fields(schema.types.size());
+
+    for(uint64_t row = 0; row < group.rows; row++){
+        uint64_t delta = 0;
+        if(!readVarint(offsetPos, offsetEnd, delta)) return;
+        offset += delta;
+
+        const uint8_t *header = bytes.data() + headerStart + row * group.headerBytes;
+        for(size_t c = 0; c < fields.size(); c++){
+            fields[c] = RecordCodec::Field();
+            if(!wanted[c] || Bitfield::get(header, c)) continue;
+
+            if(schema.types[c] == RecordCodec::ColumnType::BOOL){
+                fields[c].isNull = false;
+                fields[c].intValue = Bitfield::get(header, group.schema.boolBit[c]) ? 1 : 0;
+            }else if(!RecordCodec::decodeField(group.schema, c, bytes, cursor[c], fields[c])){
+                return;
+            }
+        }
+
+        if(dead.count(offset)) continue;
+        QueryStats::addRecordRead(0);
+        visit(offset, bytes, fields);
+    }
+}
+
+void SegmentStore::scanColumns(const RecordCodec::Schema &schema, const vector<bool> &wanted,
+                               const function<void(uint64_t, const vector<uint8_t>&, const vector<RecordCodec::Field>&)> &visit,
+                               const function<bool(const vector<RecordCodec::ColumnRange>&)> &blockFilter) const{
+    vector<uint8_t> raw;
+    vector<uint8_t> recordData;
+    vector<RecordCodec::Field> fields;
+    //no column wanted: the caller keeps the records as stored, column groups are rebuilt by readBlock
+    bool anyWanted = find(wanted.begin(), wanted.end(), true) != wanted.end();
+
+    for(const SegmentBlock &block : blocks){
+        if(block.layout == COLUMN_GROUP && anyWanted){
+            scanColumnGroup(block, schema, wanted, visit, blockFilter);
+            continue;
+        }
+        if(!readBlock(block, raw)) continue;
+
+        forEachRecord(raw, block.start, [&](uint64_t offset, const uint8_t *data, uint64_t length){
+            if(dead.count(offset)) return;
+            recordData.assign(data, data + length);
+            RecordCodec::decode(schema, recordData, fields, wanted);
+            QueryStats::addRecordRead(0);
+            visit(offset, recordData, fields);
+        });
+    }
+}
+
+void SegmentStore::markDeleted(const string &table, uint64_t offset){
+    string deadPath = tablePath(table, ".dead");
+
+    ofstream out(deadPath, ios::binary | ios::app);
+    if(!out){
+        cerr << "ERROR opening dead list" << endl;
+        return;
+    }
+
+    uint8_t bytes[Varint::MAX_BYTES];
+    size_t size = Varint::encodeTo(bytes, offset);
+    out.write(reinterpret_cast<const char*>(bytes), size);
+    out.close();
+
+    Metrics::addDataBytesWritten(size);
+    IndexFileStamp::fileChanged(deadPath);
+}
+
+/*
+  Seal: .data is read a block at a time, cut into blocks of about BLOCK_SIZE
+  at record borders and appended to .seg. The directory and the leftover
+  tail (a half written last record, normally nothing) go to temp files
+  first. The new directory only fits the new tail, so the two renames must
+  not be seen apart: creating the empty .sealing file is the commit point,
+  after it the seal counts as done and finishSeal moves both files in place,
+  here or on the next load if the process died in between. Without the mark
+  the temp files are left over and the old layout stays.
+  .seg and both temp files are fsynced before the mark is created and the
+  directory after it, so a crash never leaves a mark pointing at blocks or
+  files that did not reach the disk.
+  A range whose records do not split into columns stays a row block.
+  Runs under the write lock like every other writing command.
+*/
+bool SegmentStore::seal(const string &table, SealResult &result, const RecordCodec::Schema *columnar){
+    result = SealResult();
+
+    string dataPath = tablePath(table, ".data");
+    string directoryPath = tablePath(table, ".segidx");
+    string segmentPath = tablePath(table, ".seg");
+    string markPath = tablePath(table, ".sealing");
+
+    ifstream data(dataPath, ios::binary);
+    if(!data){
+        return false;
+    }
+
+    vector<SegmentBlock> allBlocks;
+    uint64_t tailBase = 0;
+    uint64_t sealedBefore = 0;
+    bool countKnown = true;
+    if(const SegmentStore *current = forTable(table)){
+        allBlocks = current->blocks;
+        tailBase = current->base;
+        sealedBefore = current->sealedRecords;
+        countKnown = current->recordsKnown;
+    }
+    //forTable finishes an earlier seal, its mark must not commit the temp files of this one
+    if(fs::exists(markPath)){
+        cerr << "ERROR an earlier seal of " << table << " could not be finished" << endl;
+        return false;
+    }
+
+    ofstream segment(segmentPath, ios::binary | ios::app);
+    if(!segment){
+        cerr << "ERROR opening segment file" << endl;
+        return false;
+    }
+    uint64_t segmentSize = fs::exists(segmentPath) ? fs::file_size(segmentPath) : 0;
+
+    //window of .data from tailStart on, bytes of finished blocks are dropped
+    vector<uint8_t> tail;
+    uint64_t tailStart = 0;
+    bool dataEnd = false;
+    auto readMore = [&](){
+        if(dataEnd) return false;
+        size_t old = tail.size();
+        tail.resize(old + BLOCK_SIZE);
+        data.read(reinterpret_cast<char*>(tail.data() + old), BLOCK_SIZE);
+        size_t got = data.gcount();
+        tail.resize(old + got);
+        if(got < BLOCK_SIZE) dataEnd = true;
+        Metrics::addDataBytesRead(got);
+        return got > 0;
+    };
+
+    vector<uint8_t> packed;
+    vector<SealedRow> rows;
+    size_t blockStart = 0;
+    auto flushBlock = [&](size_t blockEnd){
+        if(blockEnd == blockStart) return;
+
+        SegmentBlock block;
+        if(columnar && buildColumnGroup(*columnar, tail, rows, blockStart, packed)){
+            block.layout = COLUMN_GROUP;
+        }else{
+            LZ::compress(tail.data() + blockStart, blockEnd - blockStart, packed);
+        }
+        segment.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+
+        block.start = tailBase + tailStart + blockStart;
+        block.rawSize = blockEnd - blockStart;
+        block.filePos = segmentSize;
+        block.packedSize = packed.size();
+        allBlocks.push_back(block);
+
+        segmentSize += packed.size();
+        result.blocks++;
+        result.rawBytes += block.rawSize;
+        result.packedBytes += block.packedSize;
+        blockStart = blockEnd;
+        rows.clear();
+    };
+
+    //walk the records, blocks are only cut between two of them
+    size_t pos = 0;
+    while(pos < tail.size() || readMore()){
+        const uint8_t *end = tail.data() + tail.size();
+        const uint8_t *p = tail.data() + pos;
+        uint64_t recordLength = 0;
+        //a record running past the window is read on, at the end of .data it is the leftover
+        if(!readVarint(p, end, recordLength)){
+            if(readMore()) continue;
+            break;
+        }
+
+        if(recordLength == 0){
+            uint64_t bytesToSkip = 0;
+            if(!readVarint(p, end, bytesToSkip) || bytesToSkip > static_cast<uint64_t>(end - p)){
+                if(readMore()) continue;
+                break;
+            }
+            //the old bytes behind a tombstone are never read again, zeros compress better
+            memset(tail.data() + (p - tail.data()), 0, bytesToSkip);
+            p += bytesToSkip;
+        }else{
+            if(recordLength > static_cast<uint64_t>(end - p)){
+                if(readMore()) continue;
+                break;
+            }
+            SealedRow row;
+            row.offset = pos;
+            row.payload = p - tail.data();
+            row.length = recordLength;
+            rows.push_back(row);
+            p += recordLength;
+            result.records++;
+        }
+
+        pos = p - tail.data();
+        if(pos - blockStart >= BLOCK_SIZE){
+            flushBlock(pos);
+            tail.erase(tail.begin(), tail.begin() + blockStart);
+            tailStart += blockStart;
+            pos -= blockStart;
+            blockStart = 0;
+        }
+    }
+    flushBlock(pos);
+    segment.close();
+    if(data.bad()){
+        cerr << "ERROR reading " << dataPath << endl;
+        return false;
+    }
+    if(!segment || (result.blocks > 0 && !syncPath(segmentPath))){
+        cerr << "ERROR writing segment file" << endl;
+        return false;
+    }
+    Metrics::addDataBytesWritten(result.packedBytes);
+
+    if(result.blocks == 0) return true;
+
+    vector<uint8_t> directory(DIRECTORY_MAGIC, DIRECTORY_MAGIC + 4);
+    Varint::append(directory, tailBase + tailStart + pos);
+    Varint::append(directory, allBlocks.size());
+    for(const SegmentBlock &block : allBlocks){
+        Varint::append(directory, block.layout);
+        Varint::append(directory, block.start);
+        Varint::append(directory, block.rawSize);
+        Varint::append(directory, block.filePos);
+        Varint::append(directory, block.packedSize);
+    }
+    if(countKnown) Varint::append(directory, sealedBefore + result.records);
+
+    {
+        ofstream out(directoryPath + ".tmp", ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(directory.data()), directory.size());
+        ofstream rest(dataPath + ".tmp", ios::binary | ios::trunc);
+        rest.write(reinterpret_cast<const char*>(tail.data() + pos), tail.size() - pos);
+        out.close();
+        rest.close();
+        if(!out || !rest || !syncPath(directoryPath + ".tmp") || !syncPath(dataPath + ".tmp")){
+            cerr << "ERROR writing segment directory" << endl;
+            return false;
+        }
+    }
+
+    {
+        ofstream mark(markPath, ios::binary | ios::trunc);
+        if(!mark){
+            cerr << "ERROR writing " << markPath << endl;
+            return false;
+        }
+    }
+    //the mark only commits once it is in the directory on disk
+    if(!syncPath("data/" + table)){
+        cerr << "ERROR syncing " << markPath << endl;
+        error_code ec;
+        fs::remove(markPath, ec);
+        return false;
+    }
+    if(!finishSeal(table)){
+        //committed all the same, the next load tries again
+        cerr << "ERROR seal of " << table << " left for the next load to finish" << endl;
+    }
+    return true;
+}
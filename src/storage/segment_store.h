@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <unordered_set>
+#include "index_cache.h"
+#include "record_codec.h"
+
+/*
+  Sealed (cold) part of a table, written by SEAL TABLE.
+
+  Records keep their offsets after sealing: the .data file becomes the
+  active tail and starts at tailBase, everything below it lives in LZ
+  compressed blocks of <table>.seg. <table>.segidx is the block directory
+      [magic "PSG2"][tailBase][block count]
+      per block: [layout][logical start][raw size][position in .seg][compressed size]
+      [records sealed so far]   (missing in directories of older builds)
+  (all varints, "PSEG" directories have no layout and only row blocks), so
+  a point read finds its block by binary search and decompresses only that
+  block. Sealed blocks are never rewritten, a delete of a sealed record adds
+  its offset to <table>.dead instead. <table>.sealing marks a seal whose new
+  directory and tail still wait in temp files, the next load moves them in.
+
+  Block layouts:
+    ROW_BLOCK     the .data bytes of the range, compressed as one piece
+    COLUMN_GROUP  PAX row group (v2 tables, SEAL ... COLUMNAR):
+                    [varint header length][header][compressed chunks]
+                    header: [rows][chunk count][raw size, compressed size per chunk]
+                            [known, min, max per column] (FLOAT min/max as bits)
+                    chunk 0: record offsets (varint delta), chunk 1: record headers,
+                    chunk 2 + c: stored bytes of column c for its non NULL rows
+                  A column scan reads and decompresses only the chunks it needs.
+*/
+struct SegmentBlock{
+    uint64_t layout = 0;
+    uint64_t start = 0;       //offset of the first byte, same space as .data offsets
+    uint64_t rawSize = 0;
+    uint64_t filePos = 0;
+    uint64_t packedSize = 0;
+};
+
+struct SealResult{
+    uint64_t records = 0;
+    uint64_t blocks = 0;
+    uint64_t rawBytes = 0;
+    uint64_t packedBytes = 0;
+};
+
+class SegmentStore{
+    private:
+        std::string segPath;
+        uint64_t base = 0;
+        std::vector<SegmentBlock> blocks;
+        std::unordered_set<uint64_t> dead;
+        uint64_t sealedRecords = 0;
+        bool recordsKnown = false;
+        IndexFileStamp directoryStamp;
+        IndexFileStamp deadStamp;
+
+        bool load(const std::string &table);
+        bool readBlock(const SegmentBlock &block, std::vector<uint8_t> &raw) const;
+        void scanColumnGroup(const SegmentBlock &block, const RecordCodec::Schema &schema, const std::vector<bool> &wanted,
+                             const std::function<void(uint64_t, const std::vector<uint8_t>&, const std::vector<RecordCodec::Field>&)> &visit,
+                             const std::function<bool(const std::vector<RecordCodec::ColumnRange>&)> &blockFilter) const;
+
+    public:
+        static const uint64_t ROW_BLOCK = 0;
+        static const uint64_t COLUMN_GROUP = 1;
+        static const size_t BLOCK_SIZE = 64 * 1024;
+
+        //records below this offset are sealed
+        uint64_t tailBase() const { return base; }
+
+        //sealed records not deleted since, false when the directory does not keep the count
+        bool liveRecords(uint64_t &count) const;
+
+        //record at a sealed offset, empty when it was deleted
+        std::vector<uint8_t> readRecord(uint64_t offset) const;
+
+        //every live sealed record in offset order
+        void scan(const std::function<void(uint64_t offset, const std::vector<uint8_t> &record)> &visit) const;
+
+        //same order, decoding only the wanted columns (others stay NULL); fields point into bytes,
+        //which is the column data of a group, not a record. With no column wanted bytes is always
+        //the stored record (groups are rebuilt). Column groups whose min/max fail blockFilter are skipped
+        void scanColumns(const RecordCodec::Schema &schema, const std::vector<bool> &wanted,
+                         const std::function<void(uint64_t offset, const std::vector<uint8_t> &bytes, const std::vector<RecordCodec::Field> &fields)> &visit,
+                         const std::function<bool(const std::vector<RecordCodec::ColumnRange> &ranges)> &blockFilter = nullptr) const;
+
+        //this thread's copy of the table's directory, nullptr if the table was never sealed
+        static const SegmentStore* forTable(const std::string &table);
+        //after a command: drop this thread's copies once there are more than IndexFileStamp::CACHED_TABLES
+        static void trimThreadCache();
+
+        static void markDeleted(const std::string &table, uint64_t offset);
+
+        //move the complete records of .data into new compressed blocks, false on a file error.
+        //columnar (v2 schema) writes COLUMN_GROUP blocks, nullptr writes ROW_BLOCK
+        static bool seal(const std::string &table, SealResult &result, const RecordCodec::Schema *columnar = nullptr);
+};
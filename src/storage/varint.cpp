@@ -1,4 +1,5 @@
 #include "varint.h"
+#include <cstring>
 
 namespace Varint{
 
@@ -30,4 +31,81 @@ namespace Varint{
 
         return value;
     }
-}
\ No newline at end of file
+
+    size_t encodeTo(uint8_t *out, uint64_t value){
+        if(value < 0x80){
+            out[0] = static_cast<uint8_t>(value);
+            return 1;
+        }
+
+        size_t n = 0;
+        while(value >= 0x80){
+            out[n++] = static_cast<uint8_t>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out[n++] = static_cast<uint8_t>(value);
+        return n;
+    }
+
+    void append(std::vector<uint8_t> &out, uint64_t value){
+        uint8_t temp[MAX_BYTES];
+        size_t n = encodeTo(temp, value);
+        out.insert(out.end(), temp, temp + n);
+    }
+
+    size_t encodedSize(uint64_t value){
+        size_t n = 1;
+        while(value >= 0x80){
+            value >>= 7;
+            n++;
+        }
+        return n;
+    }
+
+    uint64_t decodeSlow(const uint8_t *ptr, const uint8_t *end, size_t &readByte){
+        uint64_t value = 0;
+        size_t shift = 0;
+
+        for(size_t i = 0; i < MAX_BYTES && ptr + i < end; ++i){
+            uint8_t byte = ptr[i];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if((byte & 0x80) == 0){
+                readByte = i + 1;
+                return value;
+            }
+            shift += 7;
+        }
+
+        readByte = 0;   //ran out of input before the last byte
+        return value;
+    }
+
+    size_t decodeBatch(const uint8_t *ptr, const uint8_t *end, uint64_t *values, size_t count){
+        const uint8_t *start = ptr;
+        size_t i = 0;
+
+        while(i < count){
+            //8 single byte values in a row: no high bit set in the whole word
+            if(count - i >= 8 && end - ptr >= 8){
+                uint64_t word;
+                memcpy(&word, ptr, 8);
+                if((word & 0x8080808080808080ULL) == 0){
+                    for(int k = 0; k < 8; k++){
+                        values[i + k] = ptr[k];
+                    }
+                    i += 8;
+                    ptr += 8;
+                    continue;
+                }
+            }
+
+            size_t readByte = 0;
+            values[i] = decode(ptr, end, readByte);
+            if(readByte == 0) return 0;
+            ptr += readByte;
+            i++;
+        }
+
+        return ptr - start;
+    }
+}
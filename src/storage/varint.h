@@ -4,9 +4,49 @@
 #include<cstdint>
 #include<cstddef>
 
+/*
+  LEB128 style varint: 7 bits per byte, high bit set on every byte but the last.
+
+  The pointer functions write into / read from caller memory, so hot paths
+  (record lengths, INT fields, result payloads) never allocate. The 1 and 2
+  byte cases cover every record length under 16KB and most INT values, so
+  decode() checks those inline and only calls decodeSlow() for longer ones.
+*/
 namespace Varint{
+    const size_t MAX_BYTES = 10;   //64 bit value needs at most 10 groups of 7 bits
+
     std::vector<uint8_t> encode(uint64_t value);  //Encode 64 bit to smaller 8 bit vector array
 
     //Decode 8 bit vector to original value
     uint64_t decode(const std::vector<uint8_t> &bufer, size_t startIndex, size_t &readByte);
-}
\ No newline at end of file
+
+    //write value at out (needs MAX_BYTES room), returns bytes written
+    size_t encodeTo(uint8_t *out, uint64_t value);
+
+    //append value to the end of out
+    void append(std::vector<uint8_t> &out, uint64_t value);
+
+    size_t encodedSize(uint64_t value);
+
+    uint64_t decodeSlow(const uint8_t *ptr, const uint8_t *end, size_t &readByte);
+
+    //decode from [ptr, end); readByte is 0 when the varint is cut off by end
+    inline uint64_t decode(const uint8_t *ptr, const uint8_t *end, size_t &readByte){
+        if(end - ptr >= 2){
+            uint64_t b0 = ptr[0];
+            if(b0 < 0x80){
+                readByte = 1;
+                return b0;
+            }
+            uint64_t b1 = ptr[1];
+            if(b1 < 0x80){
+                readByte = 2;
+                return (b0 & 0x7F) | (b1 << 7);
+            }
+        }
+        return decodeSlow(ptr, end, readByte);
+    }
+
+    //decode count varints stored back to back, returns bytes used or 0 if input ends early
+    size_t decodeBatch(const uint8_t *ptr, const uint8_t *end, uint64_t *values, size_t count);
+}
@@ -0,0 +1,350 @@
+#include "zone_map.h"
+#include "file_manager.h"
+#include "varint.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+#include <cstring>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const char ZONE_MAGIC[4] = {'P', 'Z', 'M', '1'};
+static const size_t HEADER_SIZE = 4 + 4 + 8 + 8 + 4;
+
+static size_t entrySize(size_t columns){
+    return 8 + 4 + columns * (1 + 8 + 8);
+}
+
+template<typename T>
+static void putValue(vector<uint8_t> &out, T value){
+    uint8_t bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static T getValue(const uint8_t *&pos){
+    T value;
+    memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+static void appendEntry(vector<uint8_t> &out, const ZoneBlock &block, const RecordCodec::Schema &schema){
+    putValue<uint64_t>(out, block.firstRecord);
+    putValue<uint32_t>(out, block.live);
+
+    for(size_t c = 0; c < block.ranges.size(); c++){
+        const RecordCodec::ColumnRange &range = block.ranges[c];
+        putValue<uint8_t>(out, range.known ? 1 : 0);
+        if(schema.types[c] == RecordCodec::ColumnType::FLOAT){
+            uint32_t low = 0, high = 0;
+            memcpy(&low, &range.minFloat, 4);
+            memcpy(&high, &range.maxFloat, 4);
+            putValue<uint64_t>(out, low);
+            putValue<uint64_t>(out, high);
+        }else{
+            putValue<uint64_t>(out, range.minInt);
+            putValue<uint64_t>(out, range.maxInt);
+        }
+    }
+}
+
+//per thread like the SELECT indexes, the file stamp keeps the copies in step
+static thread_local unordered_map<string, ZoneMap> maps;
+
+ZoneMap& ZoneMap::forTable(const string &table){
+    ZoneMap &zones = maps[table];
+    if(zones.table.empty()){
+        zones.table = table;
+        zones.path = "data/" + table + "/" + table + ".zone";
+    }
+    return zones;
+}
+
+void ZoneMap::trimThreadCache(){
+    if(maps.size() > IndexFileStamp::CACHED_TABLES) maps.clear();
+}
+
+bool ZoneMap::loadSchema(){
+    string metaPath = "data/" + table + "/" + table + ".meta";
+    if(metaStamp.matches(metaPath)) return true;
+
+    vector<pair<string,string>> metaInfo;
+    string primaryCol;
+    int format = RecordCodec::FORMAT_TAGGED;
+    if(!FileManager::readMeta(table, metaInfo, primaryCol, format)){
+        metaStamp.forget();
+        return false;
+    }
+
+    //DICT codes are compared as codes, no dictionary needed
+    schema = RecordCodec::makeSchema(metaInfo, format);
+    metaStamp.remember(metaPath);
+    stamp.forget();
+    return true;
+}
+
+void ZoneMap::load(){
+    if(stamp.matches(path)) return;
+
+    tailBase = 0;
+    covered = 0;
+    blocks.clear();
+    stamp.forget();
+
+    if(!fs::exists(path)) return;
+
+    ifstream in(path, ios::binary);
+    vector<uint8_t> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    //anything unreadable leaves a map that covers nothing, the next write rebuilds it
+    const uint8_t *pos = bytes.data();
+    size_t columns = schema.types.size();
+    if(bytes.size() < HEADER_SIZE || memcmp(pos, ZONE_MAGIC, 4) != 0){
+        covered = UINT64_MAX;
+        return;
+    }
+    pos += 4;
+    uint32_t storedColumns = getValue<uint32_t>(pos);
+    uint64_t base = getValue<uint64_t>(pos);
+    uint64_t coveredBytes = getValue<uint64_t>(pos);
+    uint32_t count = getValue<uint32_t>(pos);
+    if(storedColumns != columns || bytes.size() != HEADER_SIZE + count * entrySize(columns)){
+        covered = UINT64_MAX;
+        return;
+    }
+
+    blocks.resize(count);
+    for(auto &block : blocks){
+        block.firstRecord = getValue<uint64_t>(pos);
+        block.live = getValue<uint32_t>(pos);
+        block.ranges.assign(columns, RecordCodec::ColumnRange());
+
+        for(size_t c = 0; c < columns; c++){
+            RecordCodec::ColumnRange &range = block.ranges[c];
+            range.known = getValue<uint8_t>(pos) != 0;
+            uint64_t low = getValue<uint64_t>(pos);
+            uint64_t high = getValue<uint64_t>(pos);
+            if(schema.types[c] == RecordCodec::ColumnType::FLOAT){
+                uint32_t lowBits = static_cast<uint32_t>(low), highBits = static_cast<uint32_t>(high);
+                memcpy(&range.minFloat, &lowBits, 4);
+                memcpy(&range.maxFloat, &highBits, 4);
+            }else{
+                range.minInt = low;
+                range.maxInt = high;
+            }
+        }
+    }
+
+    tailBase = base;
+    covered = coveredBytes;
+    stamp.remember(path);
+}
+
+bool ZoneMap::covers(uint64_t base, uint64_t dataSize) const{
+    return tailBase == base && covered == dataSize;
+}
+
+//record (or tombstone, when record is null) starting at position
+void ZoneMap::addRecord(uint64_t position, const vector<uint8_t> *record, bool isNew){
+    size_t index = position / BLOCK_SIZE;
+    while(blocks.size() <= index){
+        ZoneBlock block;
+        block.ranges.assign(schema.types.size(), RecordCodec::ColumnRange());
+        blocks.push_back(block);
+    }
+
+    ZoneBlock &block = blocks[index];
+    if(block.firstRecord == ZoneBlock::NO_RECORD || position < block.firstRecord){
+        block.firstRecord = position;
+    }
+    if(!record) return;
+    if(isNew) block.live++;
+
+    static thread_local vector<RecordCodec::Field> fields;
+    RecordCodec::decode(schema, *record, fields);
+    for(size_t c = 0; c < fields.size(); c++){
+        block.ranges[c].add(schema.types[c], fields[c]);
+    }
+}
+
+//reads .data a chunk at a time, only the chunk and a record running past it are held
+void ZoneMap::rebuild(uint64_t base){
+    tailBase = base;
+    covered = 0;
+    blocks.clear();
+
+    string dataPath = "data/" + table + "/" + table + ".data";
+    ifstream in(dataPath, ios::binary);
+    const size_t CHUNK_SIZE = 64 * 1024;
+    vector<uint8_t> bytes;
+    uint64_t bytesStart = 0;     //.data position of bytes[0]
+    bool dataEnd = !in;
+    auto readMore = [&](){
+        if(dataEnd) return false;
+        size_t old = bytes.size();
+        bytes.resize(old + CHUNK_SIZE);
+        in.read(reinterpret_cast<char*>(bytes.data() + old), CHUNK_SIZE);
+        size_t got = in.gcount();
+        bytes.resize(old + got);
+        covered += got;
+        if(got < CHUNK_SIZE) dataEnd = true;
+        return got > 0;
+    };
+
+    size_t pos = 0;
+    vector<uint8_t> record;
+    while(pos < bytes.size() || readMore()){
+        //drop what is behind pos before the window grows
+        if(pos >= CHUNK_SIZE){
+            bytes.erase(bytes.begin(), bytes.begin() + pos);
+            bytesStart += pos;
+            pos = 0;
+        }
+        const uint8_t *start = bytes.data() + pos;
+        const uint8_t *end = bytes.data() + bytes.size();
+        uint64_t position = bytesStart + pos;
+        size_t readBytes = 0;
+        uint64_t length = Varint::decode(start, end, readBytes);
+        const uint8_t *next = start + readBytes;
+        bool complete = readBytes != 0;
+
+        if(complete && length == 0){
+            uint64_t bytesToSkip = Varint::decode(next, end, readBytes);
+            complete = readBytes != 0 && bytesToSkip <= static_cast<uint64_t>(end - next - readBytes);
+            if(complete){
+                pos = next + readBytes + bytesToSkip - bytes.data();
+                addRecord(position, nullptr, false);
+                continue;
+            }
+        }else if(complete){
+            complete = length <= static_cast<uint64_t>(end - next);
+            if(complete){
+                record.assign(next, next + length);
+                pos = next + length - bytes.data();
+                addRecord(position, &record, true);
+                continue;
+            }
+        }
+        //the record runs past the window, at the end of .data it is cut short
+        if(!readMore()) break;
+    }
+
+    save();
+}
+
+void ZoneMap::save(){
+    vector<uint8_t> bytes(ZONE_MAGIC, ZONE_MAGIC + 4);
+    putValue<uint32_t>(bytes, schema.types.size());
+    putValue<uint64_t>(bytes, tailBase);
+    putValue<uint64_t>(bytes, covered);
+    putValue<uint32_t>(bytes, blocks.size());
+    for(auto &block : blocks){
+        appendEntry(bytes, block, schema);
+    }
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if(!out){
+        cerr << "Error to write zone map " << path << "\n";
+        stamp.forget();
+        return;
+    }
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    out.close();
+
+    IndexFileStamp::fileChanged(path);
+    stamp.remember(path);
+}
+
+//header and one entry, the rest of the file is already right
+void ZoneMap::saveBlock(size_t block){
+    fstream file(path, ios::binary | ios::in | ios::out);
+    if(!file){
+        save();
+        return;
+    }
+
+    vector<uint8_t> header(ZONE_MAGIC, ZONE_MAGIC + 4);
+    putValue<uint32_t>(header, schema.types.size());
+    putValue<uint64_t>(header, tailBase);
+    putValue<uint64_t>(header, covered);
+    putValue<uint32_t>(header, blocks.size());
+
+    vector<uint8_t> entry;
+    appendEntry(entry, blocks[block], schema);
+
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.seekp(HEADER_SIZE + block * entrySize(schema.types.size()));
+    file.write(reinterpret_cast<const char*>(entry.data()), entry.size());
+    file.close();
+
+    IndexFileStamp::fileChanged(path);
+    stamp.remember(path);
+}
+
+const ZoneMap* ZoneMap::forScan(const string &table, uint64_t tailBase, uint64_t dataSize){
+    ZoneMap &zones = forTable(table);
+    if(!zones.loadSchema()) return nullptr;
+    zones.load();
+    return zones.covers(tailBase, dataSize) ? &zones : nullptr;
+}
+
+void ZoneMap::recordAdded(const string &table, uint64_t tailBase, uint64_t position,
+                          const vector<uint8_t> &record, uint64_t dataSize){
+    ZoneMap &zones = forTable(table);
+    if(!zones.loadSchema()) return;
+    zones.load();
+
+    //the file already holds the new record, a rebuild picks it up
+    if(!zones.covers(tailBase, dataSize)){
+        zones.rebuild(tailBase);
+        return;
+    }
+
+    size_t oldCount = zones.blocks.size();
+    zones.addRecord(position, &record, true);
+    zones.covered = position + Varint::encodedSize(record.size()) + record.size();
+
+    //a record longer than a block leaves empty entries behind it
+    if(zones.blocks.size() > oldCount + 1) zones.save();
+    else zones.saveBlock(position / BLOCK_SIZE);
+}
+
+void ZoneMap::recordChanged(const string &table, uint64_t tailBase, uint64_t position,
+                            const vector<uint8_t> &record, uint64_t dataSize){
+    ZoneMap &zones = forTable(table);
+    if(!zones.loadSchema()) return;
+    zones.load();
+
+    if(!zones.covers(tailBase, dataSize)){
+        zones.rebuild(tailBase);
+        return;
+    }
+
+    zones.addRecord(position, &record, false);
+    zones.saveBlock(position / BLOCK_SIZE);
+}
+
+void ZoneMap::recordRemoved(const string &table, uint64_t tailBase, uint64_t position, uint64_t dataSize){
+    ZoneMap &zones = forTable(table);
+    if(!zones.loadSchema()) return;
+    zones.load();
+
+    if(!zones.covers(tailBase, dataSize) || position / BLOCK_SIZE >= zones.blocks.size()){
+        zones.rebuild(tailBase);
+        return;
+    }
+
+    ZoneBlock &block = zones.blocks[position / BLOCK_SIZE];
+    if(block.live > 0) block.live--;
+    zones.saveBlock(position / BLOCK_SIZE);
+}
+
+void ZoneMap::rebuild(const string &table, uint64_t tailBase){
+    ZoneMap &zones = forTable(table);
+    if(!zones.loadSchema()) return;
+    zones.rebuild(tailBase);
+}
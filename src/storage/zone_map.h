@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "index_cache.h"
+#include "record_codec.h"
+
+/*
+  Zone map of a table's .data tail, kept in <table>.zone.
+
+  The tail is cut into fixed blocks of BLOCK_SIZE bytes. Per block the file
+  keeps the position of the first record that starts in it, the live record
+  count and min/max of every INT and FLOAT column:
+      header  [magic "PZM1"][columns u32][tail base u64][covered bytes u64][blocks u32]
+      block   [first record u64][live u32], per column [known u8][min u64][max u64]
+  (little endian, FLOAT min/max as bits). Entries are fixed width, so a
+  write only touches one entry and the header. Ranges only grow, a delete
+  just lowers the count, so skipping by them never loses a row.
+
+  FileManager keeps the map in step with every append, overwrite and delete.
+  A map that does not cover the whole file (tables from older builds, a
+  SEAL) is ignored by scans and rebuilt by the next write.
+*/
+struct ZoneBlock{
+    static const uint64_t NO_RECORD = UINT64_MAX;
+
+    uint64_t firstRecord = NO_RECORD;   //tail position, a safe place to start parsing
+    uint32_t live = 0;
+    std::vector<RecordCodec::ColumnRange> ranges;
+};
+
+class ZoneMap{
+    private:
+        std::string path;
+        std::string table;
+        uint64_t tailBase = 0;
+        uint64_t covered = 0;
+        std::vector<ZoneBlock> blocks;
+        RecordCodec::Schema schema;
+        IndexFileStamp stamp;
+        IndexFileStamp metaStamp;
+
+        static ZoneMap& forTable(const std::string &table);
+        bool loadSchema();
+        void load();
+        bool covers(uint64_t base, uint64_t dataSize) const;
+        void addRecord(uint64_t position, const std::vector<uint8_t> *record, bool isNew);
+        void rebuild(uint64_t base);
+        void save();
+        void saveBlock(size_t block);
+
+    public:
+        static const uint64_t BLOCK_SIZE = 8 * 1024;
+
+        const std::vector<ZoneBlock>& zones() const { return blocks; }
+
+        //this thread's copy when it covers the whole tail, nullptr otherwise
+        static const ZoneMap* forScan(const std::string &table, uint64_t tailBase, uint64_t dataSize);
+
+        //FileManager hooks, position is the place in .data, dataSize the file size before the change
+        static void recordAdded(const std::string &table, uint64_t tailBase, uint64_t position,
+                                const std::vector<uint8_t> &record, uint64_t dataSize);
+        static void recordChanged(const std::string &table, uint64_t tailBase, uint64_t position,
+                                  const std::vector<uint8_t> &record, uint64_t dataSize);
+        static void recordRemoved(const std::string &table, uint64_t tailBase, uint64_t position, uint64_t dataSize);
+
+        //build the map from .data again, e.g. after SEAL moved the tail
+        static void rebuild(const std::string &table, uint64_t tailBase);
+
+        //after a command: drop this thread's copies once there are more than IndexFileStamp::CACHED_TABLES
+        static void trimThreadCache();
+};